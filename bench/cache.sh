@@ -0,0 +1,28 @@
+# start-up of a 10k-line script: without the cache, when the cache is written (cold) and when it's read (warm),
+# the commands are cheap builtins, so parsing or loading the cache is a large part of the time
+
+awk 'BEGIN {
+	for (i = 0; i < 1430; i++)
+	{
+		print "x" i "=value" i
+		print "if [ $x" i " = a ]; then echo no; else y=$x" i "; fi"
+		print "for w in a b c\ndo\nz=$w\ndone"
+		print ": line " i
+	}
+}' > script.sh
+
+export XDG_CACHE_HOME="$PWD/cache"
+
+cold()
+{
+	rm -rf "$XDG_CACHE_HOME"
+	"$shell" script.sh
+}
+
+echo "script cache, 10k lines:"
+: > empty.sh
+measure "smsh, empty script" 100 "$shell" --no-cache empty.sh
+measure "smsh --no-cache" 100 "$shell" --no-cache script.sh
+measure "smsh, cold cache" 100 cold
+measure "smsh, warm cache" 100 "$shell" script.sh
+measure "bash" 100 bash script.sh
@@ -0,0 +1,21 @@
+# pathname expansion in a directory of 1M empty files, all of them and the 100k that match *7.txt
+
+mkdir dir
+(cd dir && seq -f %.0f.txt 1000000 | xargs touch)
+
+echo 'echo dir/* > /dev/null' > echo.sh
+echo "printf '%s\n' dir/* > /dev/null" > printf.sh
+printf 'for f in dir/*7.txt\ndo\n:\ndone\n' > for.sh
+
+echo "pathname expansion, 1M directory entries:"
+measure "ls -f dir" 3 ls -f dir
+measure "smsh, echo dir/*" 3 "$shell" --no-cache echo.sh
+measure "smsh, printf '%s\n' dir/*" 3 "$shell" --no-cache printf.sh
+measure "bash, printf '%s\n' dir/*" 3 env LC_ALL=C bash printf.sh
+measure "smsh, for f in dir/*7.txt" 3 "$shell" --no-cache for.sh
+measure "bash, for f in dir/*7.txt" 3 env LC_ALL=C bash for.sh
+
+echo "printf '%s\n' dir/*" > list.sh
+"$shell" --no-cache list.sh > smsh.out
+LC_ALL=C bash list.sh > bash.out
+cmp -s smsh.out bash.out && echo "  the sorted list is the same as bash's" || echo "  the sorted list differs from bash's"
@@ -0,0 +1,87 @@
+/*
+	Hashtable benchmark: inserts 10k keys, looks each of them up (hits) and
+	looks up as many keys that aren't in the table (misses), 100 rounds of lookups.
+	Prints the average time of one operation, the best of 5 runs.
+*/
+#include "hashtable.h"
+#include <stdio.h>
+#include <time.h>
+
+#define KEYS 10000
+#define ROUNDS 100
+#define RUNS 5
+
+static char keys[KEYS][16];
+static char missing[KEYS][16];
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(void)
+{
+	double best_insert = 0, best_hit = 0, best_miss = 0;
+	size_t found = 0;
+
+	for (size_t i = 0; i < KEYS; i++)
+	{
+		snprintf(keys[i], sizeof(keys[i]), "VAR_%zu", i);
+		snprintf(missing[i], sizeof(missing[i]), "NONE_%zu", i);
+	}
+
+	for (int run = 0; run < RUNS; run++)
+	{
+		struct Hashtable* hashtable = create_hashtable(128); // the starting size of the shell's variables
+		double start = now();
+
+		for (size_t i = 0; i < KEYS; i++)
+		{
+			insert(hashtable, keys[i], keys[i]);
+		}
+
+		double insert_time = (now() - start) / KEYS;
+
+		start = now();
+
+		for (size_t round = 0; round < ROUNDS; round++)
+		{
+			for (size_t i = 0; i < KEYS; i++)
+			{
+				found += get(hashtable, keys[i]) != NULL;
+			}
+		}
+
+		double hit_time = (now() - start) / (KEYS * ROUNDS);
+
+		start = now();
+
+		for (size_t round = 0; round < ROUNDS; round++)
+		{
+			for (size_t i = 0; i < KEYS; i++)
+			{
+				found += get(hashtable, missing[i]) != NULL;
+			}
+		}
+
+		double miss_time = (now() - start) / (KEYS * ROUNDS);
+
+		destroy_hashtable(&hashtable);
+
+		best_insert = !run || insert_time < best_insert ? insert_time : best_insert;
+		best_hit = !run || hit_time < best_hit ? hit_time : best_hit;
+		best_miss = !run || miss_time < best_miss ? miss_time : best_miss;
+	}
+
+	if (found != (size_t)KEYS * ROUNDS * RUNS)
+	{
+		fprintf(stderr, "hashtable: %zu keys found, expected %zu\n", found, (size_t)KEYS * ROUNDS * RUNS);
+		return 1;
+	}
+
+	printf("hashtable, %d keys: insert %.0f ns, hit %.0f ns, miss %.0f ns\n", KEYS, best_insert, best_hit, best_miss);
+
+	return 0;
+}
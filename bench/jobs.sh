@@ -0,0 +1,7 @@
+# 10k background jobs alive at once: each line of the script starts a job, the table holds all of them until they finish
+
+awk 'BEGIN { for (i = 0; i < 10000; i++) print "/bin/sleep 1 &"; print "wait" }' > script.sh
+
+echo "background jobs, 10k:"
+measure "smsh" 1 "$shell" --no-cache script.sh
+measure "bash" 1 bash script.sh
@@ -0,0 +1,45 @@
+#!/bin/sh
+# usage: bench/run.sh path/to/smsh.exe [benchmark...]
+# runs the benchmark programs built next to the shell (build/bench_*.exe) and the benchmark scripts bench/*.sh,
+# or only the named ones; a script is run in an empty directory with $shell set to the shell's path
+
+shell=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+dir=$(cd "$(dirname "$0")" && pwd)
+bin=$(dirname "$shell")
+shift
+
+# measure label runs command [argument...] prints the average wall time of the command's runs
+measure()
+{
+	label=$1
+	runs=$2
+	shift 2
+	start=$(date +%s%N)
+
+	for i in $(seq $runs)
+	do
+		if ! "$@" < /dev/null > /dev/null 2>&1
+		then
+			echo "  $label: failed"
+			return
+		fi
+	done
+
+	time=$((($(date +%s%N) - start) / 1000 / runs))
+	printf '  %-40s %d.%03d ms\n' "$label" $((time / 1000)) $((time % 1000))
+}
+
+for name in ${@:-$(cd "$dir" && ls *.c *.sh | sed 's/\.[a-z]*$//' | sort -u)}
+do
+	[ "$name" = run ] && continue
+
+	if [ -x "$bin/bench_$name.exe" ]
+	then
+		"$bin/bench_$name.exe"
+	elif [ -f "$dir/$name.sh" ]
+	then
+		work=$(mktemp -d)
+		(cd "$work" && . "$dir/$name.sh")
+		rm -rf "$work"
+	fi
+done
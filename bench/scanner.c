@@ -0,0 +1,124 @@
+/*
+	Scanner benchmark: splits a generated script into tokens with get_next_token() until END.
+	One script has short words, the other one has words of 30-200 characters.
+	Prints the throughput, the best of 5 runs; SMSH_SCANNER=scalar measures the scalar scanner.
+*/
+#include "scanner.h"
+#include "arena.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define SCRIPT_SIZE (8 << 20)
+#define RUNS 5
+
+static const char* short_lines[] =
+{
+	"echo hello world > out.txt\n",
+	"ls -l /usr/bin | grep sh; cat file.c\n",
+	"if test -f $file; then rm -f $file; fi\n",
+	"for i in a b c d; do echo $i & done\n",
+	"name=value; export name\n",
+	"cp 'quoted name' \"$dir/other name\" < in\n",
+};
+
+static unsigned random_state = 12345;
+
+static unsigned next_random(void)
+{
+	random_state = random_state * 1103515245 + 12345;
+	return random_state >> 16;
+}
+
+static char* generate_short(size_t* size)
+{
+	char* script = malloc(SCRIPT_SIZE + 64);
+	size_t length = 0;
+
+	for (size_t i = 0; length < SCRIPT_SIZE; i++)
+	{
+		const char* line = short_lines[i % (sizeof(short_lines) / sizeof(*short_lines))];
+		size_t line_length = strlen(line);
+		memcpy(script + length, line, line_length);
+		length += line_length;
+	}
+
+	script[length] = '\0';
+	*size = length;
+
+	return script;
+}
+
+static char* generate_long(size_t* size)
+{
+	static const char letters[] = "abcdefghijklmnopqrstuvwxyz0123456789_/.-";
+	char* script = malloc(SCRIPT_SIZE + 256);
+	size_t length = 0;
+
+	while (length < SCRIPT_SIZE)
+	{
+		size_t word_length = 30 + next_random() % 171;
+
+		for (size_t i = 0; i < word_length; i++)
+		{
+			script[length++] = letters[next_random() % (sizeof(letters) - 1)];
+		}
+
+		script[length++] = next_random() % 8 ? ' ' : '\n';
+	}
+
+	script[length] = '\0';
+	*size = length;
+
+	return script;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void measure(const char* name, char* script, size_t size)
+{
+	struct Scanner scanner = { .buffer = script, .arena = create_arena() };
+	double best = 0;
+	size_t tokens = 0;
+
+	for (int run = 0; run < RUNS; run++)
+	{
+		int arithm_expr_beginning = 0;
+		double start = now();
+
+		scanner.position = 0;
+		tokens = 0;
+
+		while (get_next_token(&scanner, &arithm_expr_beginning).type != END)
+		{
+			tokens++;
+		}
+
+		double time = now() - start;
+		best = !run || time < best ? time : best;
+		reset_arena(scanner.arena);
+	}
+
+	printf("scanner, %s: %.1f MB, %zu tokens, %.0f MB/s\n", name, size / 1e6, tokens, size / 1e6 / best);
+
+	destroy_arena(&scanner.arena);
+}
+
+int main(void)
+{
+	size_t size = 0;
+	char* script = generate_short(&size);
+	measure("short words", script, size);
+	free(script);
+
+	script = generate_long(&size);
+	measure("30-200 byte words", script, size);
+	free(script);
+
+	return 0;
+}
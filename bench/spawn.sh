@@ -0,0 +1,23 @@
+# 1000 short external commands, started with posix_spawn() (the default build) and with fork() and exec()
+# (build/smsh_fork.exe, built with -DNO_POSIX_SPAWN by make bench)
+
+cat > script.sh <<'EOF'
+i=0
+while [ $i -lt 1000 ]
+do
+/bin/true
+i=$(($i + 1))
+done
+EOF
+
+echo "external commands, 1000 runs of /bin/true:"
+measure "smsh, posix_spawn()" 10 "$shell" --no-cache script.sh
+
+if [ -x "$bin/smsh_fork.exe" ]
+then
+	measure "smsh, fork() and exec()" 10 "$bin/smsh_fork.exe" --no-cache script.sh
+else
+	echo "  smsh, fork() and exec(): $bin/smsh_fork.exe isn't built"
+fi
+
+measure "bash" 10 bash script.sh
@@ -0,0 +1,14 @@
+# a while loop whose condition is test: the builtin [ for 100k iterations, /usr/bin/[ for 2000 (a process each)
+
+loop()
+{
+	printf 'i=0\nwhile %s $i -lt %d ]\ndo\ni=$(($i+1))\ndone\n' "$1" "$2"
+}
+
+loop [ 100000 > builtin.sh
+loop /usr/bin/[ 2000 > external.sh
+
+echo "test in a loop condition:"
+measure "smsh, builtin [, 100k iterations" 3 "$shell" --no-cache builtin.sh
+measure "bash, builtin [, 100k iterations" 3 bash builtin.sh
+measure "smsh, /usr/bin/[, 2000 iterations" 3 "$shell" --no-cache external.sh
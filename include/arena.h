@@ -0,0 +1,31 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdlib.h>
+#include <stddef.h>
+
+#define ARENA_CHUNK_SIZE 65536
+
+struct ArenaChunk
+{
+	struct ArenaChunk* next;
+	size_t capacity;
+	size_t size;
+	_Alignas(max_align_t) char data[];
+};
+
+// bump-pointer allocator, everything allocated from it is released at once by reset_arena()
+struct Arena
+{
+	struct ArenaChunk* chunks; // the current chunk is the first one
+	void* last; // the most recent allocation, it can grow in place
+};
+
+struct Arena* create_arena();
+void destroy_arena(struct Arena** arena);
+void* arena_alloc(struct Arena* arena, size_t size); // returned memory is zeroed
+void* arena_realloc(struct Arena* arena, void* ptr, size_t old_size, size_t new_size);
+char* arena_copy_string(struct Arena* arena, const char* string);
+void reset_arena(struct Arena* arena); // keeps only the first chunk
+
+#endif
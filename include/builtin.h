@@ -3,10 +3,18 @@
 
 #include "shell.h"
 
+enum BuiltinInput
+{
+	BUILTIN_NO_INPUT, // doesn't read the standard input
+	BUILTIN_READS_INPUT, // reads the standard input itself, the shell's read-ahead is given back first
+	BUILTIN_BUFFERED_INPUT // reads the standard input through shell->input
+};
+
 struct Builtin
 {
 	const char* name;
 	int (*exec)(struct Shell* shell, char** args); // last *args is NULL
+	enum BuiltinInput input;
 }; 
 
 const struct Builtin* const is_builtin(const char* name);
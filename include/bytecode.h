@@ -0,0 +1,53 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stdlib.h>
+#include "parser.h"
+
+/*
+	CommandsList is lowered to a linear instruction stream:
+
+	while:       [REDIRECT s;] SET_RC 0; SAVE_RC s; L: <condition>; JUMP_IF_FAILED E; <body>; SAVE_RC s; JUMP L; E: LOAD_RC s [; RESTORE_IO s]
+	if:          <condition>; JUMP_IF_FAILED E; <if_part>; JUMP F; E: <else_part> | SET_RC 0; F:
+	for:         FOR_BEGIN s; L: FOR_NEXT s E; <body>; JUMP L; E: FOR_END s
+	case:        CASE; JUMP I0; ... JUMP In-1; JUMP N; I0: <body0> | SET_RC 0; JUMP F; ... N: SET_RC 0; F:
+	pipeline:    PIPELINE, or ASSIGN if the pipeline is a single simple command without a command name
+*/
+enum OpCode
+{
+	OP_PIPELINE, // data is AstPipeline
+	OP_ASSIGN, // data is AssignmentsList
+	OP_JUMP,
+	OP_JUMP_IF_FAILED, // jumps if the exit status of the last command isn't zero
+	OP_SET_RC,
+	OP_SAVE_RC,
+	OP_LOAD_RC,
+	OP_FOR_BEGIN, // data is AstFor
+	OP_FOR_NEXT, // data is AstFor, jumps when the wordlist is exhausted
+	OP_FOR_END, // data is AstFor
+	OP_REDIRECT, // data is AstWhile, replaces the standard input and output until RESTORE_IO
+	OP_RESTORE_IO,
+	OP_CASE, // data is AstCase, skips as many instructions as the index of the matching item (the number of items if none matches)
+	OP_HALT
+};
+
+struct Instruction
+{
+	enum OpCode op;
+	size_t operand; // jump target or exit status
+	size_t slot; // loop state index
+	void* data;
+};
+
+struct Bytecode
+{
+	struct Instruction* code;
+	size_t size;
+	size_t capacity;
+	size_t slots; // number of loop states needed to run the code
+};
+
+struct Bytecode* compile(CommandsList* program);
+void destroy_bytecode(struct Bytecode** bytecode);
+
+#endif
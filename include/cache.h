@@ -0,0 +1,69 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include "parser.h"
+
+#define CACHE_MAGIC "smshast"
+#define CACHE_VERSION 7 // must be changed with the AST or with the serialization format
+
+/*
+	Parsed scripts are kept in $XDG_CACHE_HOME/smsh (~/.cache/smsh by default), one file per script path.
+	A cache file is valid while the script has the same path, device, inode, size and mtime.
+
+	Layout: CacheHeader, the script's path, then a record per top-level command: its size (uint64_t)
+	and the serialized CommandsList. A record of size 0 ends the file. Serialized data has no pointers,
+	strings are stored NUL-terminated, so loaded tokens point into the mapped cache file.
+	The checksum covers everything after the path, a cache file that doesn't match it isn't used.
+*/
+struct CacheHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t path_size; // including '\0'
+	uint64_t device;
+	uint64_t inode;
+	uint64_t size;
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	uint64_t checksum; // written when the cache is committed
+};
+
+struct ScriptCache
+{
+	// reading
+	char* mapping;
+	size_t mapping_size;
+	size_t position;
+	int failed; // a record couldn't be loaded
+
+	// writing, the file is renamed to path when complete
+	FILE* file;
+	char* path;
+	char* temp_path;
+	char* record; // serialized command
+	size_t record_size;
+	size_t record_capacity;
+};
+
+// returns 1 if a valid cache was mapped, otherwise prepares a new cache file, if possible
+int open_script_cache(struct ScriptCache* cache, const char* script_path, const struct stat* st);
+
+// returns the next command from the mapped cache, NULL after the last one or if the record is malformed (cache->failed is set)
+CommandsList* load_command(struct ScriptCache* cache, struct Arena* arena);
+
+// appends the command to the new cache file, does nothing if the cache isn't being written
+void save_command(struct ScriptCache* cache, CommandsList* program);
+
+// the new cache file becomes visible only after the whole script was saved
+void commit_script_cache(struct ScriptCache* cache);
+
+// unmaps the cache, an uncommitted cache file is removed
+void close_script_cache(struct ScriptCache* cache);
+
+// closes the cache and removes its file, the script is parsed the next time
+void remove_script_cache(struct ScriptCache* cache);
+
+#endif
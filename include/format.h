@@ -0,0 +1,38 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include "arena.h"
+#include "output.h"
+
+#define FORMAT_DIRECTIVE_SIZE 32
+
+// literal text (escapes resolved) followed by a conversion
+struct FormatSpec
+{
+	const char* text;
+	size_t text_size;
+	char conversion; // d i o u x X c s b e E f F g G a A, '\0' - the spec is only text
+	char directive[FORMAT_DIRECTIVE_SIZE]; // snprintf() format of the conversion, "" - plain %s or %b
+};
+
+/*
+	printf format parsed once: a literal format (a word without expansions) is compiled into
+	the AST's arena and kept in its simple command, other formats are compiled for each call
+*/
+struct Format
+{
+	struct FormatSpec* specs;
+	size_t size;
+	size_t conversions; // specs that consume arguments
+};
+
+// returns NULL and prints an error if the format is invalid
+struct Format* compile_format(struct Arena* arena, const char* format);
+
+// the format is reused while arguments remain, returns 1 if an argument wasn't a valid number
+int print_format(struct Output* output, struct Format* format, char** args);
+
+// handles the escapes of echo -e and %b (\0nnn is octal), returns 1 if \c stopped the output
+int print_escaped(struct Output* output, const char* string);
+
+#endif
@@ -2,25 +2,47 @@
 #define HASHTABLE_H
 
 #include <stdlib.h>
-#include "list.h"
+
+/*
+	Open addressing with linear probing and Robin Hood insertion: an entry that is
+	farther from its home slot takes the place of a closer one, so lookups stop as soon as
+	they reach an entry closer to its home slot than the key they look for would be
+*/
+/*
+	Indexed array: items[0] is the entry's value, so $name is the first item, the other items point into
+	storage that is shared by the whole array (e.g. a file mapped by mapfile)
+*/
+struct Array
+{
+	char** items;
+	size_t size;
+	char* storage;
+	size_t storage_size;
+	int mapped; // storage was mapped with mmap(), otherwise it was allocated with malloc()
+};
 
 struct Entry
 {
-	char* key;
+	char* key; // NULL if the slot is empty
 	char* value;
+	struct Array* array; // NULL if the value is a string
+	size_t hash;
+	size_t distance; // distance from the home slot
 };
 
-struct Bucket
+struct Hashtable
 {
-	struct List* entries;
-	size_t size;
+	struct Entry* table;
+	size_t size; // number of entries
+	size_t capacity; // power of two
+	size_t generation; // changes whenever pointers returned by get() may become invalid
 };
 
-struct Hashtable
+// remembers the result of get() for one key
+struct LookupCache
 {
-	struct Bucket** table;
-	size_t size;
-	size_t capacity;
+	char** value;
+	size_t generation;
 };
 
 struct Hashtable* create_hashtable(size_t capacity);
@@ -28,5 +50,10 @@ void destroy_hashtable(struct Hashtable** hashtable);
 void insert(struct Hashtable* hashtable, const char* key, const char* value); 
 void erase(struct Hashtable* hashtable, const char* key);
 char** get(struct Hashtable* hashtable, const char* key);
+char** cached_get(struct Hashtable* hashtable, const char* key, struct LookupCache* cache); // hashes key only if cache is out of date
+void insert_array(struct Hashtable* hashtable, const char* key, struct Array* array); // takes array, replaces the key's value
+struct Array* value_array(char** value); // the array whose first item is value returned by get(), NULL for a string
+void destroy_array(struct Array* array);
+void traverse(struct Hashtable* hashtable, void (*visit)(const char* key, const char* value, void* arg), void* arg); // calls visit() for every entry
 
 #endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdlib.h>
+#include "hashtable.h"
+
+#define INPUT_BLOCK_SIZE 65536
+
+enum InputMode
+{
+	INPUT_UNKNOWN, // the descriptor wasn't examined since the last release_input()
+	INPUT_SEEKABLE, // a regular file, unread data is given back with lseek()
+	INPUT_OWNED, // opened by a loop's redirection, nothing else reads it
+	INPUT_UNBUFFERED // a pipe or a terminal shared with other commands, read a byte at a time
+};
+
+/*
+	Read-ahead of the standard input for the read builtin. Data read beyond a record stays in the buffer
+	for the next read and is given back (or dropped) by release_input() before any other command can
+	read the descriptor or the descriptor is replaced.
+*/
+struct Input
+{
+	char* buffer;
+	size_t start; // first unread byte
+	size_t end;
+	size_t capacity;
+	enum InputMode mode;
+	int owned; // the standard input was opened by a loop's redirection
+};
+
+/*
+	Reads a record up to delim, which is replaced with '\0'. Unless raw is set, a delimiter preceded by
+	an odd number of backslashes doesn't end the record. The record stays valid until the next call.
+	Returns 1 if the delimiter was found, 0 at the end of file and -1 on a read error.
+*/
+int read_record(struct Input* input, int fd, char delim, int raw, char** record, size_t* size);
+
+// gives back read-ahead data of a seekable descriptor, the descriptor is examined again by the next read_record()
+void release_input(struct Input* input, int fd);
+
+// forgets read-ahead data, another process may share the descriptor's offset
+void drop_input(struct Input* input);
+
+/*
+	Makes the rest of the input (starting with the read-ahead data) lines of array. A regular file is mapped,
+	other files are read in large blocks. Lines are terminated in place when strip is set, otherwise they are
+	copied with their newlines to a single buffer. Returns -1 on error.
+*/
+int load_lines(struct Input* input, int fd, int strip, struct Array* array);
+
+void free_input(struct Input* input);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "list.h"
 #include <sys/types.h>
+#include <signal.h>
 
 struct Process
 {
@@ -20,22 +21,91 @@ struct Job
 {
 	pid_t pgid;
 	Processes* processes; 
+	size_t id; // job number, 0 if the job isn't in the job table
 	char notified;
+	char changed; // is queued for do_job_notification()
 };
 
-typedef struct List Jobs; // list contains Job structures
+// job numbers are indexes in slots plus one, the numbers of removed jobs are reused from the free list
+struct JobTable
+{
+	struct Job** slots; // NULL marks a free slot
+	size_t size; // slots in use, free or not
+	size_t capacity;
+	size_t* free_ids; // stack of free job numbers below size
+	size_t free_count;
+	size_t count; // jobs in the table
+	size_t current; // job number of %+, 0 if unknown
+	size_t previous; // job number of %-, 0 if unknown
+};
+
+// open addressing with linear probing, pid == 0 marks an empty slot
+struct ProcessSlot
+{
+	pid_t pid;
+	struct Process* process;
+	struct Job* job;
+};
+
+struct ProcessIndex
+{
+	struct ProcessSlot* slots;
+	size_t size;
+	size_t capacity; // power of two
+};
+
+// exit status of a background job that was freed before wait was called for it
+struct SavedStatus
+{
+	pid_t pid; // pid of the job's last process, 0 if the status was taken
+	size_t id; // the job's number, wait %id finds the status after the number was freed
+	int rc;
+};
+
+/*
+	SIGCHLD is blocked and read from a signalfd, children are reaped with waitpid(WNOHANG)
+	whenever the shell isn't busy and each reaped pid is found in the index in O(1)
+*/
+struct JobControl
+{
+	struct JobTable jobs;
+	struct ProcessIndex index; // pid -> Process, for the processes that haven't completed yet
+	size_t* changed; // numbers of the jobs whose processes changed their state since the last notification
+	size_t changed_count;
+	size_t changed_capacity;
+	struct SavedStatus* saved; // ring buffer, the oldest statuses are overwritten
+	size_t saved_first;
+	size_t saved_count;
+	int sigchld_fd; // -1 if signalfd isn't available, then the shell blocks in waitpid()
+	int notify; // report completed and stopped jobs (interactive mode), otherwise completed jobs are just freed
+};
+
+struct JobControl* create_job_control();
+void destroy_job_control(struct JobControl** job_control);
+void add_job(struct JobControl* job_control, struct Job* job); // assigns the job number
+void add_process(struct JobControl* job_control, struct Job* job, struct Process* process); // the process must be started, it's reaped from now on
+void remove_job(struct JobControl* job_control, struct Job* job); // frees the job, which may not be added
+size_t reap_children(struct JobControl* job_control); // doesn't block, returns the number of status changes
+void child_sigmask(sigset_t* mask); // signal mask for new child processes
+int wait_for_children(struct JobControl* job_control); // blocks until a child changes its state, returns 0 if there are no children
+int take_saved_status(struct JobControl* job_control, pid_t pid, int* rc); // pid 0 - the oldest status, returns 0 if there is no status
+int take_saved_job_status(struct JobControl* job_control, size_t id, int* rc); // the newest status of a job with that number, returns 0 if there is none
+void forget_saved_statuses(struct JobControl* job_control);
 
-struct Job* find_job(Jobs* jobs, pid_t pgid);
+struct Job* find_job(struct JobControl* job_control, size_t id); // returns NULL if there is no job with that number
+struct Job* current_job(struct JobControl* job_control, int previous); // %+ or %-, NULL if there are no jobs
+struct Job* find_process(struct JobControl* job_control, pid_t pid, struct Process** process); // NULL if the pid doesn't belong to a job
+int process_status(struct Process* process); // exit status, or 128 + signal number for a stopped process
 int is_job_stopped(struct Job* job);
 int is_job_completed(struct Job* job);
 void destroy_job(void* job);
 void destroy_process(void* process);
-void wait_for_job(Jobs* jobs, struct Job* job);
-void do_job_notification(Jobs* jobs);
+void wait_for_job(struct JobControl* job_control, struct Job* job);
+void do_job_notification(struct JobControl* job_control);
 
 void mark_job_as_running(struct Job* job);
-void continue_job(pid_t init_pgid, Jobs* jobs, struct Job* job, int foreground);
-void put_job_in_foreground(pid_t init_pgid, Jobs* jobs, struct Job* job);
+int continue_job(pid_t init_pgid, struct JobControl* job_control, struct Job* job, int foreground);
+int put_job_in_foreground(pid_t init_pgid, struct JobControl* job_control, struct Job* job); // returns the exit status of the job's last process
 void put_job_in_background(struct Job* job);
 
 void free_cmd_args(char** argv);
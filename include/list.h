@@ -1,6 +1,8 @@
 #ifndef LIST_H
 #define LIST_H
 
+#include "arena.h"
+
 struct Node
 {
 	void* data;
@@ -13,9 +15,11 @@ struct List
 	struct Node* head;
 	struct Node* tail;
 	void (*free_data)(void*);
+	struct Arena* arena; // if isn't NULL the list, its nodes and its data are allocated from arena and released with it
 };
 
 struct List* create_list(void (*free_data)(void*));
+struct List* create_arena_list(struct Arena* arena);
 void remove_node(struct List* list, void* data); 
 void push_back(struct List* list, void* data);
 void push_forward(struct List* list, void* data);
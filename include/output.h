@@ -0,0 +1,39 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdlib.h>
+
+#define OUTPUT_FLUSH_SIZE 65536 // collected output is written early when it grows bigger
+
+// data == NULL - the part was copied to the buffer at offset
+struct OutputPart
+{
+	const char* data;
+	size_t offset;
+	size_t size;
+};
+
+/*
+	Standard output of the echo and printf builtins. A command's output is collected as parts, which either
+	reference the caller's strings (valid until the flush) or were copied to the buffer, and is written with
+	a single writev() call when the command completes.
+*/
+struct Output
+{
+	struct OutputPart* parts;
+	size_t parts_count;
+	size_t parts_capacity;
+	char* buffer;
+	size_t size;
+	size_t capacity;
+	size_t total; // bytes in all parts
+	int error; // an early flush failed
+};
+
+void output_reference(struct Output* output, const char* data, size_t size); // data isn't copied
+void output_write(struct Output* output, const char* data, size_t size);
+void output_char(struct Output* output, char c);
+int flush_output(struct Output* output); // writes to the standard output, returns -1 on error, the output is discarded anyway
+void free_output(struct Output* output);
+
+#endif
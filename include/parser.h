@@ -2,7 +2,14 @@
 #define PARSER_H
 
 #include <stdlib.h>
+#include <stdint.h>
 #include "scanner.h"
+#include "hashtable.h"
+#include "arena.h"
+#include "pattern.h"
+#include "pathname.h"
+
+struct Format; // format.h
 
 struct Parser
 {
@@ -10,6 +17,7 @@ struct Parser
 	struct Scanner* scanner;
 	struct Error* error;
 	int parsing_arithm_expr;
+	struct Arena* arena; // owns every AST node of the parsed program
 };
 
 enum AstNodeType
@@ -19,6 +27,7 @@ enum AstNodeType
 	AST_IF,
 	AST_FOR,
 	AST_WHILE,
+	AST_CASE,
 	AST_PIPELINE_LIST,
 	AST_COMPOUND_COMMANDS_LIST
 };
@@ -29,9 +38,74 @@ struct AstNode
 	void* actual_data;
 };
 
+enum Subscript
+{
+	SUBSCRIPT_NONE,
+	SUBSCRIPT_INDEX, // ${name[index]}
+	SUBSCRIPT_ALL // ${name[@]} or ${name[*]}, every item of the array
+};
+
+enum ParamOp
+{
+	PARAM_VALUE, // ${name}
+	PARAM_LENGTH, // ${#name}, ${#name[@]} is the number of items
+	PARAM_REMOVE_SHORT_PREFIX, // ${name#pattern}
+	PARAM_REMOVE_LONG_PREFIX, // ${name##pattern}
+	PARAM_REMOVE_SHORT_SUFFIX, // ${name%pattern}
+	PARAM_REMOVE_LONG_SUFFIX, // ${name%%pattern}
+	PARAM_REPLACE, // ${name/pattern/replacement}, ${name/#pattern/...} and ${name/%pattern/...} are anchored
+	PARAM_REPLACE_ALL, // ${name//pattern/replacement}
+	PARAM_SUBSTRING, // ${name:offset:length}, ${name[@]:offset:length} selects items
+	PARAM_DEFAULT // ${name:-word}
+};
+
+// an operand of a parameter expansion operator is literal text or the value of a variable ($name or ${name})
+struct ParamOperand
+{
+	char* text;
+	char* name; // NULL if the operand is literal
+	struct Pattern* pattern; // a literal pattern is compiled once, a variable's value when it's expanded
+};
+
+// a braced parameter expansion, compiled when its word is parsed or loaded from the script cache
+struct ParamExp
+{
+	char* name;
+	enum Subscript subscript;
+	long index; // a constant index, negative indexes count from the end
+	char* index_name; // the index is the value of the variable, NULL if it's constant
+	enum ParamOp op;
+	char anchor; // '#' or '%' for the anchored replacements, '\0' otherwise
+	struct ParamOperand pattern; // the pattern or the word of ${name:-word}
+	struct ParamOperand replacement;
+	struct ParamOperand offset; // offset and length are numbers or variables' names
+	struct ParamOperand length; // length.text is NULL if it's omitted
+};
+
+#define BRACE_WIDTH_MAX 32 // zero padded numbers are at most as wide
+
+// prefix{first..last..step}suffix or prefix{a,b,c}suffix, the words are produced one at a time when they're needed
+struct BraceExp
+{
+	const char* prefix;
+	size_t prefix_size;
+	const char* suffix;
+	size_t suffix_size;
+	const char** items; // {a,b,c}, NULL for a range
+	size_t* sizes;
+	size_t count; // the number of words
+	long long first;
+	long long step; // negative if the range goes down
+	int width; // numbers are padded with zeros to width characters
+};
+
 struct AstWord
 {
 	struct Token word; // word.type is WORD or PARAMETER_EXPANSION
+	struct LookupCache cache; // variable's entry, if word.type == PARAMETER_EXPANSION
+	struct ParamExp* expansion; // ${...}, word.word is the text in the braces, NULL for $name
+	struct Glob* glob; // pathname expansion of a WORD with unquoted pattern characters, NULL if there's none
+	struct BraceExp* brace; // brace expansion of a WORD, NULL if it has no braces of a supported form
 };
 
 /*
@@ -40,15 +114,17 @@ struct AstWord
 	PipelinesList        contains AstPipelineStructures ,
 	SimpleCommndsList    contains AstSimpleCommandStructures,
 	CompoundCommandsList contains AstNode structures,
-	CommandsList         contains AstNode structures
+	CommandsList         contains AstNode structures,
+	CaseItemsList        contains AstCaseItem structures
 	See create_list() and destroy_list() functions in list.h
 */
-typedef struct List Wordlist, AssignmentsList, PipelinesList, SimpleCommandsList, CompoundCommandsList, CommandsList;
+typedef struct List Wordlist, AssignmentsList, PipelinesList, SimpleCommandsList, CompoundCommandsList, CommandsList, CaseItemsList;
 
 struct AstAssignment
 {
 	struct Token* variable; // variable->type == NAME
-	struct AstNode* expression; // expresision->node_type is AST_WORD or AST_ARITHM_EXPR
+	struct AstNode* expression; // expresision->node_type is AST_WORD or AST_ARITHM_EXPR (actual_data is ArithmProgram)
+	struct LookupCache cache; // variable's entry
 };
 
 struct AstIORedirect
@@ -62,6 +138,7 @@ struct CmdArgs
 	Wordlist* command_args;
 	struct AstIORedirect* input_redirect;
 	struct AstIORedirect* output_redirect;
+	struct Format* format; // compiled format of printf, isn't serialized
 };
 
 struct AstSimpleCommand
@@ -71,6 +148,7 @@ struct AstSimpleCommand
 	struct AstWord* command_name;
 	struct AstIORedirect* input_redirect;
 	struct AstIORedirect* output_redirect;
+	struct Format* format; // compiled format of printf, isn't serialized
 };
 
 enum RunningMode // temp
@@ -89,10 +167,38 @@ struct AstPipeline
 struct AstArithmExpr
 {
 	struct Token token;
+	int64_t value; // token.type == INTEGER
 	struct AstArithmExpr* left;
 	struct AstArithmExpr* right;
 };
 
+enum ArithmOpType
+{
+	ARITHM_INTEGER, // pushes value
+	ARITHM_PARAMETER, // pushes value of the parameter
+	ARITHM_ADD,
+	ARITHM_SUBTRACT,
+	ARITHM_MULTIPLY,
+	ARITHM_DIVIDE,
+	ARITHM_NEGATE
+};
+
+struct ArithmOp
+{
+	enum ArithmOpType type;
+	int64_t value; // type == ARITHM_INTEGER
+	char* parameter; // type == ARITHM_PARAMETER
+	struct LookupCache cache; // parameter's entry
+};
+
+// AstArithmExpr tree compiled to reverse polish notation, constant subexpressions are folded
+struct ArithmProgram
+{
+	struct ArithmOp* ops;
+	size_t size;
+	size_t depth; // maximum size of the evaluation stack
+};
+
 struct AstIf
 {
 	CommandsList* condition;
@@ -104,6 +210,8 @@ struct AstWhile
 {
 	CommandsList* condition;
 	CommandsList* body;
+	struct AstIORedirect* input_redirect; // the loop's standard input, read builtins may buffer it
+	struct AstIORedirect* output_redirect;
 };
 
 struct AstFor
@@ -113,6 +221,29 @@ struct AstFor
 	CommandsList* body;
 };
 
+struct AstCaseItem
+{
+	Wordlist* patterns; // contains AstNode structures with AST_WORD
+	CommandsList* body; // can be NULL
+};
+
+// a pattern of a case statement, patterns of all items are in the order they're tried
+struct CasePattern
+{
+	struct Pattern* pattern; // NULL if the pattern is a parameter expansion, it's compiled when the statement is executed
+	struct AstWord* word;
+	size_t item;
+};
+
+struct AstCase
+{
+	struct AstWord* word;
+	CaseItemsList* items;
+	struct CasePattern* patterns; // built by compile_case_patterns()
+	size_t pattern_count;
+	struct PatternSet* automaton; // literal patterns, NULL if it would be too large to build
+};
+
 /*
 io_redirect : INPUT_REDIRECT  filename
             | OUTPUT_REDIRECT filename
@@ -251,6 +382,7 @@ CompoundCommandsList* cc_list(struct Parser* parser);
 compound_command: for_clause
                 | if_clause
                 | while_clause
+                | case_clause
 */
 struct AstNode* compound_command(struct Parser* parser);
 
@@ -272,6 +404,30 @@ CommandsList* do_group(struct Parser* parser);
 //for_clause : For WORD linebreak In wordlist newline_list do_group
 struct AstNode* for_clause(struct Parser* parser);
 
+/*
+case_clause : Case WORD linebreak In linebreak case_list Esac
+            | Case WORD linebreak In linebreak           Esac
+*/
+struct AstNode* case_clause(struct Parser* parser);
+
+/*
+case_item : pattern ')' linebreak     DSEMI linebreak
+          | pattern ')' compound_list DSEMI linebreak
+          | pattern ')' compound_list
+*/
+struct AstCaseItem* case_item(struct Parser* parser);
+
+/*
+pattern :             WORD
+        |             PARAMETER_EXPANSION
+        | pattern '|' WORD
+        | pattern '|' PARAMETER_EXPANSION
+*/
+Wordlist* pattern(struct Parser* parser);
+
+// collects the patterns of the items and compiles the literal ones into the automaton
+void compile_case_patterns(struct Arena* arena, struct AstCase* ast_case);
+
 /*
 wordlist : wordlist WORD
          | wordlist PARAMETER_EXPANSION
@@ -284,23 +440,25 @@ Wordlist* wordlist(struct Parser* parser);
 
 
 CommandsList* parse(struct Parser* parser);
+
+/*
+complete_command : linebreak compound_command
+                 | linebreak pipeline (separator_op pipeline)* [separator_op]
+*/
+// parses the next top-level command only, returns NULL at the end of the input or on error
+CommandsList* complete_command(struct Parser* parser);
 struct AstWord* ast_word(struct Parser* parser);
 
-// returns result of arithm_expression and calls get_next_token()
+// text is "{...}" of a braced parameter expansion, returns NULL if its form isn't supported
+struct ParamExp* compile_param_exp(struct Arena* arena, const char* text);
+
+// the first {...} of text is a range or a list of two or more items, returns NULL otherwise
+struct BraceExp* compile_brace_exp(struct Arena* arena, const char* text);
+
+// returns result of arithm_expression compiled to ArithmProgram and calls get_next_token()
 struct AstNode* parse_arithm_expr(struct Parser* parser);
 
 // get_token function is get_next_token or arithm_get_next_token
 int eat(struct Parser* parser, enum TokenType expected, struct Token(*get_token)(struct Scanner*, int*));
 
-void free_ast_simple_command(void* ast_scommand);
-void free_ast_io_redirect(void* io_redir);
-void free_ast_word(void* word);
-void free_ast_assignment(void* assignment);
-void free_ast_node(void* node);
-void free_ast_arithm_expr(void* arithm_expr);
-void free_ast_pipeline(void* ast_pipeline);
-void free_ast_if(void* ast_if);
-void free_ast_while(void* ast_while);
-void free_ast_for(void* ast_for);
-
 #endif
\ No newline at end of file
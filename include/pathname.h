@@ -0,0 +1,78 @@
+#ifndef PATHNAME_H
+#define PATHNAME_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "arena.h"
+#include "pattern.h"
+
+#define DIRENT_BATCH_SIZE (1 << 20) // bytes of directory entries requested by a getdents64 call
+
+// the record returned by getdents64, glibc doesn't declare it
+struct LinuxDirent64
+{
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+struct GlobSegment
+{
+	struct Pattern* pattern; // pattern->literal if the segment has no pattern characters, NULL if recursive
+	int recursive; // '**' matches the directory and all directories below it
+};
+
+// a word with pattern characters split at '/', compiled once when the word is parsed
+struct Glob
+{
+	struct GlobSegment* segments;
+	size_t size;
+	int absolute; // the word begins with '/'
+	int directory; // the word ends with '/', only directories match
+	int recursive; // a segment is '**', see walker.h
+};
+
+// entries of a directory, read once for all the patterns of a command
+struct Directory
+{
+	char* path;
+	char* names; // NUL-terminated names one after another, without "." and ".."
+	size_t* offsets; // count + 1 offsets, the last one is the size of names
+	unsigned char* types; // d_type of the entries
+	size_t count;
+	struct Directory* next;
+};
+
+struct DirectoryCache
+{
+	struct Directory* directories;
+};
+
+struct PathList
+{
+	char** paths; // allocated with malloc(), the paths are given to the caller or released by free_paths()
+	size_t size;
+	size_t capacity;
+};
+
+// returns NULL if the text has no pattern characters outside of escapes and brackets that aren't closed
+struct Glob* compile_glob(struct Arena* arena, const char* text);
+
+// adds the sorted matching paths to the list, returns the number of matches (0 if nothing matches); threads walk the trees of '**'
+size_t expand_glob(struct DirectoryCache* cache, const struct Glob* glob, size_t threads, struct PathList* list);
+
+// appends a path allocated with malloc() to the list
+void add_path(struct PathList* list, char* path);
+
+// base and name separated by '/', the separator is omitted if base is empty or ends with '/'
+char* join_path(const char* base, const char* name, size_t name_size);
+
+// forgets the directories read by the command, the next command sees the changes
+void clear_directory_cache(struct DirectoryCache* cache);
+
+// frees the paths that weren't given away and the list itself
+void free_paths(struct PathList* list);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "arena.h"
+
+#define PATTERN_SET_MAX_STATES 4096
+
+enum PatternOp
+{
+	PATTERN_LITERAL, // text of size characters
+	PATTERN_ANY, // ?
+	PATTERN_STAR, // *
+	PATTERN_CLASS // [...], a bitmap of the matching bytes ([!...] is inverted when it's compiled)
+};
+
+struct PatternElement
+{
+	enum PatternOp op;
+	const char* text;
+	size_t size;
+	const unsigned char* set; // 32 bytes, PATTERN_CLASS only
+};
+
+/*
+	Glob pattern (* ? [...] and \ escapes) compiled once. Consecutive literal characters are a single element,
+	literal characters that begin and end the pattern are compared before the pattern is matched
+*/
+struct Pattern
+{
+	struct PatternElement* elements;
+	size_t size;
+	size_t min_length; // the length of the shortest matching string
+	int stars; // the number of PATTERN_STAR elements
+	const char* prefix; // literal text the matching strings begin with
+	size_t prefix_size;
+	const char* suffix; // literal text the matching strings end with
+	size_t suffix_size;
+	int literal; // no wildcards, only the prefix matches
+	int affixes; // a single star between the prefix and the suffix, strings with both of them match
+};
+
+struct Pattern* compile_pattern(struct Arena* arena, const char* text, size_t size);
+
+// returns 1 if the whole string matches
+int match_pattern(const struct Pattern* pattern, const char* string, size_t length);
+
+/*
+	Patterns combined into a deterministic automaton, a string is matched against all of them in a single pass.
+	Bytes that no pattern tells apart share a class, so a state has a transition for each class only.
+*/
+struct PatternSet
+{
+	unsigned char classes[256];
+	size_t class_count;
+	size_t state_count;
+	int32_t* transitions; // state * class_count + class, -1 if no pattern can match anymore
+	int32_t* matches; // the first pattern matching the strings that end in the state, -1 if none
+};
+
+// NULL patterns never match, returns NULL if the automaton would have more than PATTERN_SET_MAX_STATES states
+struct PatternSet* compile_pattern_set(struct Arena* arena, struct Pattern** patterns, size_t count);
+
+// returns the index of the first matching pattern, -1 if none matches
+long match_pattern_set(const struct PatternSet* set, const char* string, size_t length);
+
+#endif
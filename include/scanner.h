@@ -2,6 +2,7 @@
 #define SCANNER_H
 
 #include <stdlib.h>
+#include "arena.h"
 
 #define BUF_CAP 32
 
@@ -16,6 +17,7 @@ enum TokenType
 	PIPE, // '|'
 	ASYNC_LIST, // '&'
 	SEQ_LIST, // ';'
+	DSEMI, // ';;', ends an item of a case statement
 	IF,
 	ELSE,
 	FI,
@@ -25,6 +27,8 @@ enum TokenType
 	DO,
 	DONE,
 	IN,
+	CASE,
+	ESAC,
 
 	/*these are used while reading an arithmetic expression*/
 	INTEGER,
@@ -33,7 +37,7 @@ enum TokenType
 	MULTIPLY,
 	DIVIDE,
 	LPAR,
-	RPAR,
+	RPAR, // also ends the patterns of a case statement's item
 	/****************************************************/
 
 	END
@@ -43,8 +47,11 @@ struct Scanner
 {
 	char* buffer;
 	size_t position;
+	struct Arena* arena; // buffers of quoted and concatenated words are allocated from it
 };
 
+// a buffer with zero capacity is a slice of the scanned text (not NUL-terminated),
+// otherwise it owns NUL-terminated storage in the scanner's arena
 struct Buffer
 {
 	char* buffer;
@@ -56,11 +63,15 @@ struct Token
 {
 	struct Buffer word;
 	enum TokenType type;
+	int glob; // a WORD with an unquoted '*', '?' or '[', pathname expansion applies to it
+	int brace; // a WORD with an unquoted '{', brace expansion may apply to it
+	const char* pattern; // the WORD with its quoted '*', '?', '[' and '\\' escaped, NULL if it has none of them
 };
 
 void init_buffer(struct Buffer* buffer);
 
-void append_char(struct Buffer* buffer, char c);
+// c points into the scanned text, the buffer is copied to the arena only when c doesn't follow its end
+void append_char(struct Arena* arena, struct Buffer* buffer, const char* c);
 
 struct Token get_next_token(struct Scanner* scanner, int* arithm_expr_beginning);
 
@@ -68,13 +79,17 @@ struct Token arithm_get_next_token(struct Scanner* scanner, int* arithm_expr_end
 
 void arithm_read_integer(struct Scanner* scanner, struct Token* token);
 
-void copy_token(struct Token* dest, struct Token* src);
+// the text compiled when a WORD is used as a pattern, its quoted characters match literally
+const char* pattern_text(const struct Token* token);
+
+// a slice is copied to the arena as a NUL-terminated string
+void copy_token(struct Arena* arena, struct Token* dest, struct Token* src);
 
 int skip_delim(struct Scanner* scanner);
 
 // reads symbols from buffer from position until encountered terminating quote(returns 1 in that case) or '\0'(returns 0)
-int handle_quotes(char quote, size_t* position, const char* buffer, struct Token* token, int* contains_quotes);
+int handle_quotes(struct Arena* arena, char quote, size_t* position, const char* buffer, struct Token* token, int* contains_quotes);
 
-int handle_io_redirect(char redirect, const char* buffer, size_t* position, int contains_quotes, struct Token* token);
+int handle_io_redirect(struct Arena* arena, char redirect, const char* buffer, size_t* position, int contains_quotes, struct Token* token);
 
 #endif
\ No newline at end of file
@@ -4,16 +4,37 @@
 #include "hashtable.h"
 #include "parser.h"
 #include "job.h"
+#include "output.h"
+#include "input.h"
+
+struct CommandsStats
+{
+	size_t lookups; // find_executable() calls for names without '/'
+	size_t hits; // lookups answered from the commands table
+	size_t probes; // access() calls made while searching PATH
+};
 
 struct Shell
 {
 	struct Parser* parser;
 	struct Scanner* scanner;
 	struct Hashtable* variables;
+	struct Hashtable* commands; // command name -> full path, "" if the command wasn't found in PATH
+	struct CommandsStats commands_stats;
 	struct Error* execution_error;
 	CommandsList* program;
-	Jobs* jobs;
+	struct JobControl* job_control;
+	struct AstSimpleCommand* command; // the simple command being executed, builtins may cache data in it
+	struct Output output; // standard output of echo and printf
+	struct Input input; // read-ahead of the standard input, see input.h
+	struct Arena* scratch; // temporary allocations of builtins, reset after each builtin
 	pid_t pgid;
+	int use_script_cache; // scripts are run from their parsed copies in ~/.cache/smsh, see cache.h
+	char arithm_result[24]; // reusable buffer for the results of arithmetic expansions
+	char* expansion; // reusable buffer for the results of ${...} expansions
+	size_t expansion_capacity;
+	struct DirectoryCache directories; // directories read by pathname expansions of the command being expanded
+	struct PathList paths; // matches of a pathname expansion, moved to the arguments
 };
 
 struct Shell* create();
@@ -21,6 +42,11 @@ int shell_init(struct Shell* shell);
 void destroy(struct Shell* shell);
 void init_parser(struct Shell* shell, char* buffer);
 int set_variable(struct Shell* shell, const char* var_name, const char* var_value); // returns 1 if the variable already exists
+void set_array(struct Shell* shell, const char* var_name, struct Array* array); // takes array, replaces the variable's value
+void unset_variable(struct Shell* shell, const char* var_name);
+void rehash_commands(struct Shell* shell); // forgets all remembered command locations
+const char* find_executable(struct Shell* shell, const char* exec_name); // returns NULL if exec_name isn't found
+struct Job* start_background_job(struct Shell* shell, char** argv, int outfd); // takes argv, returns NULL if argv[0] can't be started
 int shell_execute(struct Shell* shell, char* buffer);
 int shell_execute_from_file(struct Shell* shell, const char* filename);
 int execute(struct Shell* shell, CommandsList* program);
@@ -2,6 +2,7 @@
 #define UTILITY_H
 
 #include <stdlib.h>
+#include "list.h"
 
 struct Error
 {
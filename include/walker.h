@@ -0,0 +1,21 @@
+#ifndef WALKER_H
+#define WALKER_H
+
+#include <stdlib.h>
+#include "pattern.h"
+#include "pathname.h"
+
+#define WALKER_MAX_THREADS 64
+#define DEQUE_CAP 64
+
+/*
+	Recursive expansion of '**'. The directories are read by a pool of threads, each thread takes
+	directories from its own deque and steals from the other deques when its own is empty.
+	Names beginning with '.' aren't descended into, symbolic links to directories aren't followed.
+*/
+
+// adds the entries in and below the bases that match pattern, only directories if directories_only; if pattern is NULL,
+// all the entries and the bases themselves ending with '/' (except the current directory) match; the paths aren't sorted
+void walk_trees(const char** bases, size_t count, const struct Pattern* pattern, int directories_only, size_t threads, struct PathList* matches);
+
+#endif
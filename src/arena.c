@@ -0,0 +1,100 @@
+#include "arena.h"
+#include <string.h>
+
+#define ARENA_ALIGNMENT (_Alignof(max_align_t))
+
+static size_t align(size_t size)
+{
+	return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+static struct ArenaChunk* create_chunk(size_t capacity)
+{
+	struct ArenaChunk* chunk = malloc(sizeof(struct ArenaChunk) + capacity);
+	chunk->next = NULL;
+	chunk->capacity = capacity;
+	chunk->size = 0;
+
+	return chunk;
+}
+
+struct Arena* create_arena()
+{
+	struct Arena* arena = calloc(1, sizeof(struct Arena));
+	arena->chunks = create_chunk(ARENA_CHUNK_SIZE);
+
+	return arena;
+}
+
+void destroy_arena(struct Arena** arena)
+{
+	if (*arena)
+	{
+		reset_arena(*arena);
+		free((*arena)->chunks);
+		free(*arena);
+		*arena = NULL;
+	}
+}
+
+void* arena_alloc(struct Arena* arena, size_t size)
+{
+	size = align(size);
+
+	struct ArenaChunk* chunk = arena->chunks;
+
+	if (chunk->size + size > chunk->capacity)
+	{
+		chunk = create_chunk(size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE);
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+	}
+
+	void* ptr = chunk->data + chunk->size;
+	chunk->size += size;
+	arena->last = ptr;
+
+	return memset(ptr, 0, size);
+}
+
+void* arena_realloc(struct Arena* arena, void* ptr, size_t old_size, size_t new_size)
+{
+	struct ArenaChunk* chunk = arena->chunks;
+
+	if (ptr && ptr == arena->last && (char*)ptr + align(new_size) <= chunk->data + chunk->capacity)
+	{
+		chunk->size = (size_t)((char*)ptr - chunk->data) + align(new_size);
+		return ptr;
+	}
+
+	void* new_ptr = arena_alloc(arena, new_size);
+
+	if (ptr)
+	{
+		memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+	}
+
+	return new_ptr;
+}
+
+char* arena_copy_string(struct Arena* arena, const char* string)
+{
+	size_t size = strlen(string) + 1;
+	return memcpy(arena_alloc(arena, size), string, size);
+}
+
+void reset_arena(struct Arena* arena)
+{
+	struct ArenaChunk* chunk = arena->chunks;
+
+	while (chunk->next)
+	{
+		struct ArenaChunk* next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+
+	chunk->size = 0;
+	arena->chunks = chunk;
+	arena->last = NULL;
+}
@@ -1,11 +1,18 @@
 #include "builtin.h"
 #include "utility.h"
 #include "job.h"
+#include "format.h"
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
 
 extern char** environ;
 
@@ -21,12 +28,54 @@ static int unset(struct Shell* shell, char** argv);
 // help [bulitin_name]
 static int help(struct Shell* shell, char** argv);
 
-// bg
+// bg [job_spec]
 static int bg(struct Shell* shell, char** argv);
 
-// fg
+// fg [job_spec]
 static int fg(struct Shell* shell, char** argv);
 
+// jobs [-l | -p] [job_spec...]
+static int jobs(struct Shell* shell, char** argv);
+
+// kill [-s signal_name | -n signal_number | -signal] pid | job_spec... or kill -l [exit_status]
+static int kill_builtin(struct Shell* shell, char** argv);
+
+// wait [-n] [pid | job_spec...]
+static int wait_builtin(struct Shell* shell, char** argv);
+
+// parallel [-j jobs] [-g] command [arg...] [::: word...]
+static int parallel(struct Shell* shell, char** argv);
+
+// test [expression]
+static int test(struct Shell* shell, char** argv);
+
+// [ [expression] ]
+static int bracket(struct Shell* shell, char** argv);
+
+// true
+static int true_builtin(struct Shell* shell, char** argv);
+
+// false
+static int false_builtin(struct Shell* shell, char** argv);
+
+// : [argument...]
+static int colon(struct Shell* shell, char** argv);
+
+// echo [-neE] [string...]
+static int echo(struct Shell* shell, char** argv);
+
+// printf format [argument...]
+static int printf_builtin(struct Shell* shell, char** argv);
+
+// read [-r] [-d delim] [name...]
+static int read_builtin(struct Shell* shell, char** argv);
+
+// mapfile [-t] [array], readarray [-t] [array]
+static int mapfile(struct Shell* shell, char** argv);
+
+// hash [-r] [-d name...] [-t name...] [name...]
+static int hash(struct Shell* shell, char** argv);
+
 static const struct Builtin Builtins[] = 
 {
 	{ "cd", cd }, 
@@ -34,6 +83,21 @@ static const struct Builtin Builtins[] =
 	{ "unset", unset }, // remove environment variable
 	{ "fg", fg }, // put job in foreground
 	{ "bg", bg }, // put job in background
+	{ "jobs", jobs }, // display status of jobs
+	{ "kill", kill_builtin }, // send a signal to processes or jobs
+	{ "wait", wait_builtin }, // wait for jobs to complete
+	{ "parallel", parallel, BUILTIN_READS_INPUT }, // run a command for each word, a limited number of jobs at once
+	{ "test", test }, // evaluate expression
+	{ "[", bracket }, // evaluate expression
+	{ "true", true_builtin }, // return true value
+	{ "false", false_builtin }, // return false value
+	{ ":", colon }, // null utility
+	{ "echo", echo }, // write arguments to standard output
+	{ "printf", printf_builtin }, // write formatted output
+	{ "read", read_builtin, BUILTIN_BUFFERED_INPUT }, // read a line into variables
+	{ "mapfile", mapfile, BUILTIN_BUFFERED_INPUT }, // read lines into an array
+	{ "readarray", mapfile, BUILTIN_BUFFERED_INPUT }, // read lines into an array
+	{ "hash", hash }, // remember or display command locations
 	{ "help", help }
 };
 
@@ -357,97 +421,1695 @@ static int unset(struct Shell* shell, char** argv)
 	}
 
 	environ = new_environ;
-	erase(shell->variables, name);
+	unset_variable(shell, name);
 
 	return 0;
 }
 
-// bg
+// job_spec is %n, %%, %+ or %- (the leading '%' may be omitted), NULL means the current job
+static struct Job* get_job(struct Shell* shell, const char* builtin_name, const char* job_spec)
+{
+	struct Job* job = NULL;
+	const char* spec = job_spec;
+
+	if (spec && *spec == '%')
+	{
+		spec++;
+	}
+
+	if (!spec || !*spec || !strcmp(spec, "%") || !strcmp(spec, "+"))
+	{
+		job = current_job(shell->job_control, 0);
+	}
+	else if (!strcmp(spec, "-"))
+	{
+		job = current_job(shell->job_control, 1);
+	}
+	else if (isdigit((unsigned char)*spec))
+	{
+		char* end = NULL;
+		unsigned long id = strtoul(spec, &end, 10);
+
+		if (!*end)
+		{
+			job = find_job(shell->job_control, (size_t)id);
+		}
+	}
+
+	if (!job)
+	{
+		job_spec ? fprintf(stderr, "%s: %s: no such job\n", builtin_name, job_spec) : fprintf(stderr, "%s: no current job\n", builtin_name);
+	}
+
+	return job;
+}
+
+// bg [job_spec]
 static int bg(struct Shell* shell, char** argv)
 {
-	if (*argv)
+	if (*argv && *(argv + 1))
 	{
 		fprintf(stderr, "bg: too many arguments\n");
 		return 1;
 	}
 
-	if (!shell->jobs->head)
+	struct Job* job = get_job(shell, "bg", *argv);
+	if (!job)
 	{
-		fprintf(stderr, "bg: no suitable job\n");
 		return 1;
 	}
 
-	continue_job(shell->pgid, shell->jobs, (struct Job*)shell->jobs->head->data, 0);
-
-	return 0;
+	return continue_job(shell->pgid, shell->job_control, job, 0);
 }
 
-// fg
+// fg [job_spec]
 static int fg(struct Shell* shell, char** argv)
 {
-	if (*argv)
+	if (*argv && *(argv + 1))
 	{
 		fprintf(stderr, "fg: too many arguments\n");
 		return 1;
 	}
 
-	if (!shell->jobs->head)
+	struct Job* job = get_job(shell, "fg", *argv);
+	if (!job)
 	{
-		fprintf(stderr, "fg: no suitable job\n");
 		return 1;
 	}
 
-	continue_job(shell->pgid, shell->jobs, (struct Job*)shell->jobs->head->data, 1);
+	return continue_job(shell->pgid, shell->job_control, job, 1);
+}
 
-	return 0;
+static void print_job(struct JobControl* job_control, struct Job* job, int option)
+{
+	if (option == 'p')
+	{
+		fprintf(stdout, "%ld\n", (long)job->pgid);
+		return;
+	}
+
+	const char* status = is_job_completed(job) ? "Done" : is_job_stopped(job) ? "Stopped" : "Running";
+	char mark = job == current_job(job_control, 0) ? '+' : job == current_job(job_control, 1) ? '-' : ' ';
+
+	fprintf(stdout, "[%zu]%c  ", job->id, mark);
+
+	if (option == 'l')
+	{
+		fprintf(stdout, "%ld ", (long)job->pgid);
+	}
+
+	fprintf(stdout, "%-24s", status);
+
+	for (struct Node* node = job->processes->head; node; node = node->next)
+	{
+		struct Process* process = (struct Process*)node->data;
+
+		for (char** arg = process->argv; arg && *arg; arg++)
+		{
+			fprintf(stdout, arg == process->argv ? "%s" : " %s", *arg);
+		}
+
+		if (node->next)
+		{
+			fprintf(stdout, " | ");
+		}
+	}
+
+	fprintf(stdout, "\n");
 }
 
-// help [bulitin_name]
-static int help(struct Shell* shell, char** argv)
+// jobs [-l | -p] [job_spec...]
+static int jobs(struct Shell* shell, char** argv)
 {
-	if (*argv)
+	struct JobControl* job_control = shell->job_control;
+	int option = 0;
+
+	if (*argv && (!strcmp(*argv, "-l") || !strcmp(*argv, "-p")))
 	{
-		const char* builtin_name = *argv;
+		option = (*argv)[1];
+		argv++;
+	}
 
-		if (*(++argv))
+	reap_children(job_control);
+
+	if (!*argv)
+	{
+		for (size_t id = 1; id <= job_control->jobs.size; id++) // completed jobs are reported once and removed
 		{
-			fprintf(stderr, "help: too many arguments\n");
+			struct Job* job = find_job(job_control, id);
+
+			if (job)
+			{
+				print_job(job_control, job, option);
+
+				if (is_job_completed(job))
+				{
+					remove_job(job_control, job);
+				}
+			}
+		}
+
+		return 0;
+	}
+
+	int rc = 0;
+
+	for (; *argv; argv++)
+	{
+		struct Job* job = get_job(shell, "jobs", *argv);
+
+		if (!job)
+		{
+			rc = 1;
+			continue;
+		}
+
+		print_job(job_control, job, option);
+
+		if (is_job_completed(job))
+		{
+			remove_job(job_control, job);
+		}
+	}
+
+	return rc;
+}
+
+struct Signal
+{
+	const char* name;
+	int number;
+};
+
+static const struct Signal Signals[] =
+{
+	{ "HUP", SIGHUP }, { "INT", SIGINT }, { "QUIT", SIGQUIT }, { "ILL", SIGILL }, { "TRAP", SIGTRAP },
+	{ "ABRT", SIGABRT }, { "BUS", SIGBUS }, { "FPE", SIGFPE }, { "KILL", SIGKILL }, { "USR1", SIGUSR1 },
+	{ "SEGV", SIGSEGV }, { "USR2", SIGUSR2 }, { "PIPE", SIGPIPE }, { "ALRM", SIGALRM }, { "TERM", SIGTERM },
+	{ "CHLD", SIGCHLD }, { "CONT", SIGCONT }, { "STOP", SIGSTOP }, { "TSTP", SIGTSTP }, { "TTIN", SIGTTIN },
+	{ "TTOU", SIGTTOU }, { "URG", SIGURG }, { "XCPU", SIGXCPU }, { "XFSZ", SIGXFSZ }, { "VTALRM", SIGVTALRM },
+	{ "PROF", SIGPROF }, { "WINCH", SIGWINCH }, { "SYS", SIGSYS }
+};
+
+static const size_t SignalsCount = sizeof(Signals) / sizeof(struct Signal);
+
+// accepts a signal number or a name with or without the SIG prefix, returns -1 for unknown signals
+static int get_signal(const char* spec)
+{
+	if (isdigit((unsigned char)*spec))
+	{
+		char* end = NULL;
+		long number = strtol(spec, &end, 10);
+
+		return !*end && number < NSIG ? (int)number : -1;
+	}
+
+	if (!strncasecmp(spec, "SIG", 3))
+	{
+		spec += 3;
+	}
+
+	for (size_t i = 0; i < SignalsCount; i++)
+	{
+		if (!strcasecmp(spec, Signals[i].name))
+		{
+			return Signals[i].number;
+		}
+	}
+
+	return -1;
+}
+
+static int list_signals(char** argv)
+{
+	if (!*argv)
+	{
+		for (size_t i = 0; i < SignalsCount; i++)
+		{
+			fprintf(stdout, i + 1 < SignalsCount ? "%s " : "%s\n", Signals[i].name);
+		}
+
+		return 0;
+	}
+
+	int rc = 0;
+
+	for (; *argv; argv++)
+	{
+		int number = isdigit((unsigned char)**argv) ? atoi(*argv) : get_signal(*argv);
+
+		if (number == -1)
+		{
+			fprintf(stderr, "kill: %s: invalid signal specification\n", *argv);
+			rc = 1;
+		}
+		else if (!isdigit((unsigned char)**argv))
+		{
+			fprintf(stdout, "%d\n", number);
+		}
+		else
+		{
+			const char* name = NULL;
+
+			for (size_t i = 0; i < SignalsCount && !name; i++)
+			{
+				if (Signals[i].number == number || Signals[i].number + 128 == number) // exit status of a process terminated by a signal
+				{
+					name = Signals[i].name;
+				}
+			}
+
+			name ? fprintf(stdout, "%s\n", name) : fprintf(stdout, "%d\n", number);
+		}
+	}
+
+	return rc;
+}
+
+// kill [-s signal_name | -n signal_number | -signal] pid | job_spec... or kill -l [exit_status]
+static int kill_builtin(struct Shell* shell, char** argv)
+{
+	int signal_number = SIGTERM;
+
+	if (*argv && !strcmp(*argv, "-l"))
+	{
+		return list_signals(argv + 1);
+	}
+
+	if (*argv && (!strcmp(*argv, "-s") || !strcmp(*argv, "-n")))
+	{
+		if (!*(++argv))
+		{
+			fprintf(stderr, "kill: option requires an argument\n");
 			return 1;
 		}
 
-		if (!strcmp(builtin_name, "cd"))
+		signal_number = get_signal(*argv++);
+	}
+	else if (*argv && **argv == '-' && strcmp(*argv, "--"))
+	{
+		signal_number = get_signal(*argv++ + 1);
+	}
+
+	if (signal_number == -1)
+	{
+		fprintf(stderr, "kill: %s: invalid signal specification\n", *(argv - 1));
+		return 1;
+	}
+
+	if (*argv && !strcmp(*argv, "--"))
+	{
+		argv++;
+	}
+
+	if (!*argv)
+	{
+		fprintf(stderr, "kill: usage: kill [-s signal_name | -n signal_number | -signal] pid | job_spec... or kill -l [exit_status]\n");
+		return 1;
+	}
+
+	int rc = 0;
+
+	for (; *argv; argv++)
+	{
+		pid_t pid = 0;
+
+		if (**argv == '%')
 		{
-			fprintf(stdout, "cd: cd [-L |-P] [directory]\nChanges current directory\n");
-			return 0;
+			struct Job* job = get_job(shell, "kill", *argv);
+
+			if (!job)
+			{
+				rc = 1;
+				continue;
+			}
+
+			if (!job->pgid) // only builtins, nothing to signal
+			{
+				continue;
+			}
+
+			pid = -job->pgid;
+
+			if (is_job_stopped(job) && (signal_number == SIGTERM || signal_number == SIGHUP)) // a stopped job wouldn't handle it until continued
+			{
+				kill(pid, SIGCONT);
+			}
 		}
+		else
+		{
+			char* end = NULL;
+			long number = strtol(*argv, &end, 10);
 
-		if (!strcmp(builtin_name, "export"))
+			if (*end || end == *argv)
+			{
+				fprintf(stderr, "kill: %s: arguments must be process or job IDs\n", *argv);
+				rc = 1;
+				continue;
+			}
+
+			pid = (pid_t)number;
+		}
+
+		if (kill(pid, signal_number) == -1)
 		{
-			fprintf(stdout, "export: export [name] [value]\nCreates [name] environment variable for current shell session\n");
-			return 0;
+			fprintf(stderr, "kill: (%s) - %s\n", *argv, strerror(errno));
+			rc = 1;
 		}
+	}
 
-		if (!strcmp(builtin_name, "unset"))
+	return rc;
+}
+
+// pid or job_spec, returns NULL if the job isn't known, then the pid or the job's number is stored for the saved statuses lookup
+static struct Job* get_waited_job(struct Shell* shell, const char* operand, pid_t* pid, size_t* id, struct Process** process)
+{
+	*pid = 0;
+	*id = 0;
+	*process = NULL;
+
+	if (*operand == '%')
+	{
+		char* end = NULL;
+		unsigned long number = isdigit((unsigned char)operand[1]) ? strtoul(operand + 1, &end, 10) : 0;
+
+		if (number && !*end && !find_job(shell->job_control, (size_t)number)) // a completed job is freed before it's waited for
 		{
-			fprintf(stdout, "unset: unset [name]\nRemoves [name] environment variable for current shell session\n");
-			return 0;
+			*id = (size_t)number;
+			return NULL;
 		}
 
-		if (!strcmp(builtin_name, "help"))
+		return get_job(shell, "wait", operand);
+	}
+
+	char* end = NULL;
+	long number = strtol(operand, &end, 10);
+
+	if (*end || end == operand || number <= 0)
+	{
+		fprintf(stderr, "wait: %s: not a pid or valid job spec\n", operand);
+		return NULL;
+	}
+
+	*pid = (pid_t)number;
+
+	return find_process(shell->job_control, *pid, process);
+}
+
+// returns the status of the waited process or job, the job is freed if it completed
+static int finish_wait(struct JobControl* job_control, struct Job* job, struct Process* process)
+{
+	int rc = process_status(process ? process : (struct Process*)job->processes->tail->data);
+
+	if (is_job_completed(job))
+	{
+		remove_job(job_control, job);
+	}
+
+	return rc;
+}
+
+// wait -n [pid | job_spec...], returns the status of the first job (of the listed ones) that completes
+static int wait_next(struct Shell* shell, char** argv)
+{
+	struct JobControl* job_control = shell->job_control;
+	int rc = 127;
+
+	if (!*argv && take_saved_status(job_control, 0, &rc)) // completed earlier, but wasn't waited for
+	{
+		return rc;
+	}
+
+	// operands are resolved once, jobs aren't freed while wait_next() runs
+	size_t count = 0;
+	struct Job** jobs = NULL;
+	struct Process** processes = NULL;
+
+	for (char** operand = argv; *operand; operand++)
+	{
+		jobs = realloc(jobs, (count + 1) * sizeof(struct Job*));
+		processes = realloc(processes, (count + 1) * sizeof(struct Process*));
+
+		pid_t pid;
+		size_t id;
+		jobs[count] = get_waited_job(shell, *operand, &pid, &id, processes + count);
+
+		if (!jobs[count] && (pid ? take_saved_status(job_control, pid, &rc) : id && take_saved_job_status(job_control, id, &rc)))
 		{
-			fprintf(stdout, "help: help [builtin_name]\nPrints info about [builtin_name] builtin command\n");
-			return 0;
+			free(jobs);
+			free(processes);
+			return rc;
 		}
 
-		if (!strcmp(builtin_name, "bg"))
+		count++;
+	}
+
+	while (1)
+	{
+		reap_children(job_control);
+
+		if (!*argv)
 		{
-			fprintf(stdout, "bg: bg\nPuts last job in background\n");
-			return 0;
+			for (size_t i = 0; i < job_control->changed_count; i++) // only the jobs that changed can have completed
+			{
+				struct Job* job = find_job(job_control, job_control->changed[i]);
+
+				if (job && job->changed && is_job_completed(job))
+				{
+					return finish_wait(job_control, job, NULL);
+				}
+			}
+
+			if (!job_control->index.size)
+			{
+				return 127; // nothing is running
+			}
 		}
+		else
+		{
+			int running = 0;
 
-		if (!strcmp(builtin_name, "fg"))
+			for (size_t i = 0; i < count; i++)
+			{
+				if (jobs[i] && is_job_completed(jobs[i]))
+				{
+					rc = finish_wait(job_control, jobs[i], processes[i]);
+					running = 0;
+					break;
+				}
+
+				running |= jobs[i] != NULL;
+			}
+
+			if (!running)
+			{
+				break;
+			}
+		}
+
+		wait_for_children(job_control);
+	}
+
+	free(jobs);
+	free(processes);
+
+	return rc;
+}
+
+// wait [-n] [pid | job_spec...]
+static int wait_builtin(struct Shell* shell, char** argv)
+{
+	struct JobControl* job_control = shell->job_control;
+
+	if (*argv && !strcmp(*argv, "-n"))
+	{
+		return wait_next(shell, argv + 1);
+	}
+
+	if (!*argv) // all jobs, stopped jobs aren't waited for
+	{
+		for (size_t id = 1; id <= job_control->jobs.size; id++)
+		{
+			struct Job* job = find_job(job_control, id);
+
+			if (job)
+			{
+				wait_for_job(job_control, job);
+			}
+		}
+
+		do_job_notification(job_control);
+		forget_saved_statuses(job_control);
+
+		return 0;
+	}
+
+	int rc = 127;
+
+	for (; *argv; argv++)
+	{
+		pid_t pid;
+		size_t id;
+		struct Process* process;
+		struct Job* job = get_waited_job(shell, *argv, &pid, &id, &process);
+
+		if (job)
+		{
+			if (process)
+			{
+				while (!process->completed && !process->stopped && wait_for_children(job_control))
+				{
+				}
+			}
+			else
+			{
+				wait_for_job(job_control, job);
+			}
+
+			rc = finish_wait(job_control, job, process);
+		}
+		else if (id)
+		{
+			if (!take_saved_job_status(job_control, id, &rc))
+			{
+				fprintf(stderr, "wait: %s: no such job\n", *argv);
+				rc = 127;
+			}
+		}
+		else if (!pid || !take_saved_status(job_control, pid, &rc))
+		{
+			if (pid)
+			{
+				fprintf(stderr, "wait: pid %ld is not a child of this shell\n", (long)pid);
+			}
+
+			rc = 127;
+		}
+	}
+
+	return rc; // the exit status of the last operand
+}
+
+struct Worker
+{
+	struct Job* job; // NULL if the worker is free
+	FILE* output; // -g, the job's standard output, copied to the shell's one when the job completes
+};
+
+// copies arg with every "{}" replaced by word, sets *replaced if arg contains "{}"
+static char* replace_placeholder(const char* arg, const char* word, int* replaced)
+{
+	const char* placeholder = strstr(arg, "{}");
+
+	if (!placeholder)
+	{
+		return copy_string(arg);
+	}
+
+	size_t count = 0;
+
+	for (const char* p = placeholder; p; p = strstr(p + 2, "{}"))
+	{
+		count++;
+	}
+
+	size_t word_len = strlen(word);
+	char* result = malloc(strlen(arg) + count * word_len - count * 2 + 1);
+	char* dest = result;
+
+	for (const char* p = arg; placeholder; p = placeholder + 2, placeholder = strstr(p, "{}"))
+	{
+		memcpy(dest, p, (size_t)(placeholder - p));
+		dest += placeholder - p;
+		memcpy(dest, word, word_len);
+		dest += word_len;
+		arg = placeholder + 2;
+	}
+
+	strcpy(dest, arg);
+	*replaced = 1;
+
+	return result;
+}
+
+// the word replaces "{}" in the command's arguments or is appended to them
+static char** create_job_args(char** command, size_t size, const char* word)
+{
+	char** args = calloc(size + 2, sizeof(char*));
+	int replaced = 0;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		args[i] = replace_placeholder(command[i], word, &replaced);
+	}
+
+	if (!replaced)
+	{
+		args[size] = copy_string(word);
+	}
+
+	return args;
+}
+
+static void copy_output(FILE* output)
+{
+	char buffer[BUFSIZ];
+	size_t size;
+
+	rewind(output);
+
+	while ((size = fread(buffer, 1, sizeof(buffer), output)) > 0)
+	{
+		fwrite(buffer, 1, size, stdout);
+	}
+
+	fflush(stdout);
+	fclose(output);
+}
+
+// parallel [-j jobs] [-g] command [arg...] [::: word...]
+static int parallel(struct Shell* shell, char** argv)
+{
+	long max_jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	int group = 0;
+
+	for (; *argv && **argv == '-'; argv++)
+	{
+		if (!strcmp(*argv, "-g"))
+		{
+			group = 1;
+		}
+		else if (!strncmp(*argv, "-j", 2))
+		{
+			const char* number = (*argv)[2] ? *argv + 2 : *(++argv);
+			char* end = NULL;
+
+			max_jobs = number ? strtol(number, &end, 10) : 0;
+
+			if (!number || *end || max_jobs < 1)
+			{
+				fprintf(stderr, "parallel: -j: a positive number is expected\n");
+				return 1;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "parallel: %s: invalid option\n", *argv);
+			return 1;
+		}
+	}
+
+	if (!*argv)
+	{
+		fprintf(stderr, "parallel: usage: parallel [-j jobs] [-g] command [arg...] [::: word...]\n");
+		return 1;
+	}
+
+	char** command = argv;
+	char** words = NULL; // NULL - words are read from the standard input, one per line
+	size_t command_size = 0;
+
+	for (; command[command_size] && strcmp(command[command_size], ":::"); command_size++)
+	{
+	}
+
+	if (command[command_size])
+	{
+		words = command + command_size + 1;
+	}
+
+	struct JobControl* job_control = shell->job_control;
+	struct Worker* workers = calloc((size_t)max_jobs, sizeof(struct Worker));
+	size_t running = 0;
+	size_t failed = 0;
+	char* line = NULL;
+	size_t line_capacity = 0;
+	int more = 1;
+
+	fflush(stdout);
+
+	while (more || running)
+	{
+		for (long i = 0; i < max_jobs && more; i++) // free workers take the next words
+		{
+			if (workers[i].job)
+			{
+				continue;
+			}
+
+			const char* word = NULL;
+
+			if (words)
+			{
+				word = *words ? *words++ : NULL;
+			}
+			else
+			{
+				ssize_t size = getline(&line, &line_capacity, stdin);
+
+				if (size > 0 && line[size - 1] == '\n')
+				{
+					line[size - 1] = '\0';
+				}
+
+				word = size == -1 ? NULL : line;
+			}
+
+			if (!word)
+			{
+				more = 0;
+				break;
+			}
+
+			int outfd = 1;
+
+			if (group && (workers[i].output = tmpfile()))
+			{
+				outfd = fileno(workers[i].output);
+				fcntl(outfd, F_SETFD, FD_CLOEXEC); // other workers don't inherit it, the job gets a copy as its standard output
+			}
+
+			workers[i].job = start_background_job(shell, create_job_args(command, command_size, word), outfd);
+
+			if (workers[i].job)
+			{
+				running++;
+			}
+			else
+			{
+				fprintf(stderr, "parallel: %s: command not found\n", command[0]);
+				failed++;
+
+				if (workers[i].output)
+				{
+					fclose(workers[i].output);
+					workers[i].output = NULL;
+				}
+			}
+		}
+
+		if (!running)
+		{
+			continue;
+		}
+
+		wait_for_children(job_control); // a completed job frees its worker right away
+
+		for (long i = 0; i < max_jobs; i++)
+		{
+			struct Job* job = workers[i].job;
+
+			if (job && is_job_completed(job))
+			{
+				if (process_status((struct Process*)job->processes->tail->data))
+				{
+					failed++;
+				}
+
+				if (workers[i].output)
+				{
+					copy_output(workers[i].output);
+					workers[i].output = NULL;
+				}
+
+				remove_job(job_control, job);
+				workers[i].job = NULL;
+				running--;
+			}
+		}
+	}
+
+	free(line);
+	free(workers);
+
+	return failed > 101 ? 101 : (int)failed; // the number of failed jobs, like GNU parallel
+}
+
+/*
+	test evaluates its arguments in the shell process, loop conditions don't fork. Up to 4 arguments
+	are evaluated as POSIX specifies it by their number, longer expressions are parsed by precedence:
+
+	expression: and_expr ['-o' expression]
+	and_expr: not_expr ['-a' and_expr]
+	not_expr: '!' not_expr | primary
+	primary: '(' expression ')' | unary_operator operand | operand binary_operator operand | operand
+*/
+struct TestParser
+{
+	const char* name; // "test" or "["
+	char** args;
+	size_t size;
+	size_t position;
+	int error;
+};
+
+static int test_error(struct TestParser* parser, const char* arg, const char* message)
+{
+	if (!parser->error)
+	{
+		arg ? fprintf(stderr, "%s: %s: %s\n", parser->name, arg, message) : fprintf(stderr, "%s: %s\n", parser->name, message);
+		parser->error = 1;
+	}
+
+	return 0;
+}
+
+static int is_unary_operator(const char* arg)
+{
+	return arg[0] == '-' && arg[1] && !arg[2] && strchr("bcdefghkLnprsStuwxz", arg[1]);
+}
+
+static int is_binary_operator(const char* arg)
+{
+	static const char* const operators[] = { "=", "==", "!=", "-eq", "-ne", "-gt", "-ge", "-lt", "-le", "-nt", "-ot", "-ef" };
+
+	for (size_t i = 0; i < sizeof(operators) / sizeof(operators[0]); i++)
+	{
+		if (!strcmp(arg, operators[i]))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int test_integer(struct TestParser* parser, const char* arg, long long* value)
+{
+	const char* p = arg;
+
+	while (*p == ' ' || *p == '\t')
+	{
+		p++;
+	}
+
+	char* end = NULL;
+	errno = 0;
+	*value = strtoll(p, &end, 10);
+
+	while (end != p && (*end == ' ' || *end == '\t'))
+	{
+		end++;
+	}
+
+	if (end == p || *end || errno == ERANGE)
+	{
+		return test_error(parser, arg, "integer expression expected");
+	}
+
+	return 1;
+}
+
+static int test_unary(struct TestParser* parser, const char* operator, const char* operand)
+{
+	struct stat st;
+	char op = operator[1];
+
+	switch (op)
+	{
+		case 'n': return *operand != '\0';
+		case 'z': return *operand == '\0';
+		case 't':
+		{
+			long long fd;
+			return test_integer(parser, operand, &fd) && fd >= 0 && fd <= 1024 && isatty((int)fd);
+		}
+		case 'r': return access(operand, R_OK) == 0;
+		case 'w': return access(operand, W_OK) == 0;
+		case 'x': return access(operand, X_OK) == 0;
+		case 'h':
+		case 'L': return lstat(operand, &st) == 0 && S_ISLNK(st.st_mode);
+		default: break;
+	}
+
+	if (stat(operand, &st) == -1)
+	{
+		return 0;
+	}
+
+	switch (op)
+	{
+		case 'e': return 1;
+		case 'f': return S_ISREG(st.st_mode);
+		case 'd': return S_ISDIR(st.st_mode);
+		case 'b': return S_ISBLK(st.st_mode);
+		case 'c': return S_ISCHR(st.st_mode);
+		case 'p': return S_ISFIFO(st.st_mode);
+		case 'S': return S_ISSOCK(st.st_mode);
+		case 's': return st.st_size > 0;
+		case 'g': return (st.st_mode & S_ISGID) != 0;
+		case 'u': return (st.st_mode & S_ISUID) != 0;
+		case 'k': return (st.st_mode & S_ISVTX) != 0;
+		default: return 0;
+	}
+}
+
+static int compare_mtime(const char* left, const char* right, int newer)
+{
+	struct stat l;
+	struct stat r;
+	int has_left = stat(left, &l) == 0;
+	int has_right = stat(right, &r) == 0;
+
+	if (!has_left || !has_right) // an existing file is newer than a missing one
+	{
+		return newer ? has_left && !has_right : !has_left && has_right;
+	}
+
+	if (l.st_mtim.tv_sec != r.st_mtim.tv_sec)
+	{
+		return newer ? l.st_mtim.tv_sec > r.st_mtim.tv_sec : l.st_mtim.tv_sec < r.st_mtim.tv_sec;
+	}
+
+	return newer ? l.st_mtim.tv_nsec > r.st_mtim.tv_nsec : l.st_mtim.tv_nsec < r.st_mtim.tv_nsec;
+}
+
+static int test_binary(struct TestParser* parser, const char* left, const char* operator, const char* right)
+{
+	if (operator[0] != '-')
+	{
+		int equal = !strcmp(left, right);
+		return operator[0] == '!' ? !equal : equal;
+	}
+
+	if (!strcmp(operator, "-nt") || !strcmp(operator, "-ot"))
+	{
+		return compare_mtime(left, right, operator[1] == 'n');
+	}
+
+	if (!strcmp(operator, "-ef"))
+	{
+		struct stat l;
+		struct stat r;
+		return stat(left, &l) == 0 && stat(right, &r) == 0 && l.st_dev == r.st_dev && l.st_ino == r.st_ino;
+	}
+
+	long long a;
+	long long b;
+
+	if (!test_integer(parser, left, &a) || !test_integer(parser, right, &b))
+	{
+		return 0;
+	}
+
+	switch (operator[1] << 8 | operator[2])
+	{
+		case 'e' << 8 | 'q': return a == b;
+		case 'n' << 8 | 'e': return a != b;
+		case 'g' << 8 | 't': return a > b;
+		case 'g' << 8 | 'e': return a >= b;
+		case 'l' << 8 | 't': return a < b;
+		default: return a <= b; // -le
+	}
+}
+
+static const char* test_peek(struct TestParser* parser, size_t offset)
+{
+	return parser->position + offset < parser->size ? parser->args[parser->position + offset] : NULL;
+}
+
+static int test_or(struct TestParser* parser);
+
+static int test_primary(struct TestParser* parser)
+{
+	const char* arg = test_peek(parser, 0);
+
+	if (!arg)
+	{
+		return test_error(parser, NULL, "argument expected");
+	}
+
+	const char* next = test_peek(parser, 1);
+
+	if (next && test_peek(parser, 2) && is_binary_operator(next))
+	{
+		parser->position += 3;
+		return test_binary(parser, arg, next, parser->args[parser->position - 1]);
+	}
+
+	if (!strcmp(arg, "(") && next)
+	{
+		parser->position++;
+		int result = test_or(parser);
+
+		if (!test_peek(parser, 0) || strcmp(test_peek(parser, 0), ")"))
+		{
+			return test_error(parser, NULL, "')' expected");
+		}
+
+		parser->position++;
+		return result;
+	}
+
+	if (is_unary_operator(arg) && next)
+	{
+		parser->position += 2;
+		return test_unary(parser, arg, next);
+	}
+
+	parser->position++;
+
+	return *arg != '\0';
+}
+
+static int test_not(struct TestParser* parser)
+{
+	const char* arg = test_peek(parser, 0);
+
+	if (arg && !strcmp(arg, "!") && test_peek(parser, 1))
+	{
+		parser->position++;
+		return !test_not(parser);
+	}
+
+	return test_primary(parser);
+}
+
+static int test_and(struct TestParser* parser)
+{
+	int result = test_not(parser);
+
+	while (test_peek(parser, 0) && !strcmp(test_peek(parser, 0), "-a"))
+	{
+		parser->position++;
+		result = test_not(parser) && result; // both sides are parsed
+	}
+
+	return result;
+}
+
+static int test_or(struct TestParser* parser)
+{
+	int result = test_and(parser);
+
+	while (test_peek(parser, 0) && !strcmp(test_peek(parser, 0), "-o"))
+	{
+		parser->position++;
+		result = test_and(parser) || result;
+	}
+
+	return result;
+}
+
+// the POSIX rules for 0 to 4 arguments, -1 if they don't apply
+static int test_by_count(struct TestParser* parser, char** args, size_t size)
+{
+	switch (size)
+	{
+		case 0: return 0;
+		case 1: return *args[0] != '\0';
+		case 2:
+		{
+			if (!strcmp(args[0], "!"))
+			{
+				return *args[1] == '\0';
+			}
+
+			if (is_unary_operator(args[0]))
+			{
+				return test_unary(parser, args[0], args[1]);
+			}
+		} break;
+		case 3:
+		{
+			if (is_binary_operator(args[1]))
+			{
+				return test_binary(parser, args[0], args[1], args[2]);
+			}
+
+			if (!strcmp(args[0], "!"))
+			{
+				int result = test_by_count(parser, args + 1, 2);
+				return result == -1 ? -1 : !result;
+			}
+
+			if (!strcmp(args[0], "(") && !strcmp(args[2], ")"))
+			{
+				return *args[1] != '\0';
+			}
+		} break;
+		case 4:
+		{
+			if (!strcmp(args[0], "!"))
+			{
+				int result = test_by_count(parser, args + 1, 3);
+				return result == -1 ? -1 : !result;
+			}
+
+			if (!strcmp(args[0], "(") && !strcmp(args[3], ")"))
+			{
+				return test_by_count(parser, args + 1, 2);
+			}
+		} break;
+		default: break;
+	}
+
+	return -1;
+}
+
+static int evaluate_test(const char* name, char** args, size_t size)
+{
+	struct TestParser parser = { name, args, size, 0, 0 };
+	int result = test_by_count(&parser, args, size);
+
+	if (result == -1)
+	{
+		result = test_or(&parser);
+
+		if (parser.position < size)
+		{
+			test_error(&parser, args[parser.position], "unexpected argument");
+		}
+	}
+
+	return parser.error ? 2 : !result;
+}
+
+// test [expression]
+static int test(struct Shell* shell, char** argv)
+{
+	size_t size = 0;
+
+	while (argv[size])
+	{
+		size++;
+	}
+
+	return evaluate_test("test", argv, size);
+}
+
+// [ [expression] ]
+static int bracket(struct Shell* shell, char** argv)
+{
+	size_t size = 0;
+
+	while (argv[size])
+	{
+		size++;
+	}
+
+	if (!size || strcmp(argv[size - 1], "]"))
+	{
+		fprintf(stderr, "[: missing ']'\n");
+		return 2;
+	}
+
+	return evaluate_test("[", argv, size - 1);
+}
+
+// true
+static int true_builtin(struct Shell* shell, char** argv)
+{
+	return 0;
+}
+
+// false
+static int false_builtin(struct Shell* shell, char** argv)
+{
+	return 1;
+}
+
+// : [argument...]
+static int colon(struct Shell* shell, char** argv)
+{
+	return 0;
+}
+
+// echo [-neE] [string...]
+static int echo(struct Shell* shell, char** argv)
+{
+	struct Output* output = &shell->output;
+	int newline = 1;
+	int escapes = 0;
+
+	for (; *argv && (*argv)[0] == '-' && (*argv)[1] && strspn(*argv + 1, "neE") == strlen(*argv + 1); argv++)
+	{
+		for (const char* option = *argv + 1; *option; option++)
+		{
+			if (*option == 'n')
+			{
+				newline = 0;
+			}
+			else
+			{
+				escapes = *option == 'e';
+			}
+		}
+	}
+
+	for (char** arg = argv; *arg; arg++)
+	{
+		if (arg != argv)
+		{
+			output_reference(output, " ", 1);
+		}
+
+		if (!escapes)
+		{
+			output_reference(output, *arg, strlen(*arg)); // written straight from argv by writev()
+		}
+		else if (print_escaped(output, *arg)) // \c
+		{
+			newline = 0;
+			break;
+		}
+	}
+
+	if (newline)
+	{
+		output_reference(output, "\n", 1);
+	}
+
+	return flush_output(output) == -1 ? 1 : 0;
+}
+
+// a format that is a word without expansions is compiled once and kept in the AST
+static struct Format* get_format(struct Shell* shell, const char* text)
+{
+	struct AstSimpleCommand* command = shell->command;
+	struct AstNode* node = command && command->command_args ? (struct AstNode*)command->command_args->head->data : NULL;
+
+	if (node && node->node_type == AST_WORD && ((struct AstWord*)node->actual_data)->word.type != PARAMETER_EXPANSION)
+	{
+		if (!command->format)
+		{
+			command->format = compile_format(shell->parser->arena, ((struct AstWord*)node->actual_data)->word.word.buffer);
+		}
+
+		return command->format;
+	}
+
+	return compile_format(shell->scratch, text);
+}
+
+// printf format [argument...]
+static int printf_builtin(struct Shell* shell, char** argv)
+{
+	if (!*argv)
+	{
+		fprintf(stderr, "printf: usage: printf format [argument...]\n");
+		return 2;
+	}
+
+	struct Format* format = get_format(shell, *argv);
+
+	if (!format)
+	{
+		return 1;
+	}
+
+	int rc = print_format(&shell->output, format, argv + 1);
+
+	return flush_output(&shell->output) == -1 ? 1 : rc;
+}
+
+static int is_name(const char* name)
+{
+	if (!isalpha((unsigned char)*name) && *name != '_')
+	{
+		return 0;
+	}
+
+	while (*(++name))
+	{
+		if (!isalnum((unsigned char)*name) && *name != '_')
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int is_ifs_space(const char* ifs, char c)
+{
+	return (c == ' ' || c == '\t' || c == '\n') && strchr(ifs, c);
+}
+
+/*
+	Splits the record by IFS in place: fields are unescaped (unless raw) and terminated inside the record,
+	the last name gets the rest of the record without trailing IFS white space
+*/
+static void assign_fields(struct Shell* shell, char* record, const char* ifs, int raw, char** names)
+{
+	char* r = record; // next character to split
+
+	for (; *names; names++)
+	{
+		int last = !names[1];
+
+		while (is_ifs_space(ifs, *r))
+		{
+			r++;
+		}
+
+		char* field = r;
+		char* w = r; // unescaping only shortens the field
+		char* end = r; // end of the field without trailing IFS white space
+
+		while (*r && (last || !strchr(ifs, *r)))
+		{
+			if (!raw && *r == '\\' && r[1])
+			{
+				if (r[1] == '\n') // line continuation
+				{
+					r += 2;
+					continue;
+				}
+
+				r++;
+				*w++ = *r++;
+				end = w;
+				continue;
+			}
+
+			int space = is_ifs_space(ifs, *r);
+			*w++ = *r++;
+
+			if (!space)
+			{
+				end = w;
+			}
+		}
+
+		if (*r) // a field delimiter: IFS white space with at most one other IFS character
+		{
+			while (is_ifs_space(ifs, *r))
+			{
+				r++;
+			}
+
+			if (*r && strchr(ifs, *r))
+			{
+				r++;
+
+				while (is_ifs_space(ifs, *r))
+				{
+					r++;
+				}
+			}
+		}
+
+		*end = '\0';
+		set_variable(shell, *names, field);
+	}
+}
+
+// read [-r] [-d delim] [name...]
+static int read_builtin(struct Shell* shell, char** argv)
+{
+	static char* reply[] = { "REPLY", NULL };
+	int raw = 0;
+	char delim = '\n';
+
+	for (; *argv && (*argv)[0] == '-' && (*argv)[1]; argv++)
+	{
+		if (!strcmp(*argv, "--"))
+		{
+			argv++;
+			break;
+		}
+
+		if (!strcmp(*argv, "-r"))
+		{
+			raw = 1;
+		}
+		else if (!strcmp(*argv, "-d") && argv[1])
+		{
+			delim = *(++argv)[0]; // -d '' reads up to '\0'
+		}
+		else
+		{
+			fprintf(stderr, "read: usage: read [-r] [-d delim] [name...]\n");
+			return 2;
+		}
+	}
+
+	for (char** name = argv; *name; name++)
+	{
+		if (!is_name(*name))
+		{
+			fprintf(stderr, "read: '%s': not a valid identifier\n", *name);
+			return 2;
+		}
+	}
+
+	const char* ifs = get_variable(shell, "IFS");
+	char* record = NULL;
+	size_t size = 0;
+	int rc = read_record(&shell->input, STDIN_FILENO, delim, raw, &record, &size);
+
+	if (rc == -1)
+	{
+		fprintf(stderr, "read: %s\n", strerror(errno));
+		return 2;
+	}
+
+	if (!*argv) // REPLY gets the whole record
+	{
+		argv = reply;
+		ifs = "";
+	}
+
+	assign_fields(shell, record, ifs ? ifs : " \t\n", raw, argv);
+
+	return rc ? 0 : 1;
+}
+
+// mapfile [-t] [array], readarray [-t] [array]
+static int mapfile(struct Shell* shell, char** argv)
+{
+	int strip = 0;
+
+	if (*argv && !strcmp(*argv, "-t"))
+	{
+		strip = 1;
+		argv++;
+	}
+
+	const char* name = *argv ? *argv++ : "MAPFILE";
+
+	if (*argv || *name == '-')
+	{
+		fprintf(stderr, "mapfile: usage: mapfile [-t] [array]\n");
+		return 2;
+	}
+
+	if (!is_name(name))
+	{
+		fprintf(stderr, "mapfile: '%s': not a valid identifier\n", name);
+		return 2;
+	}
+
+	struct Array* array = calloc(1, sizeof(struct Array));
+
+	if (load_lines(&shell->input, STDIN_FILENO, strip, array) == -1)
+	{
+		fprintf(stderr, "mapfile: %s\n", strerror(errno));
+		destroy_array(array);
+		return 1;
+	}
+
+	set_array(shell, name, array);
+
+	return 0;
+}
+
+static void print_command_location(const char* name, const char* path, void* count)
+{
+	if (*path) // negative entries aren't shown
+	{
+		fprintf(stdout, "%s\t%s\n", name, path);
+		(*(size_t*)count)++;
+	}
+}
+
+// hash [-r] [-d name...] [-t name...] [name...]
+static int hash(struct Shell* shell, char** argv)
+{
+	if (!*argv)
+	{
+		struct CommandsStats* stats = &shell->commands_stats;
+		size_t misses = stats->lookups - stats->hits;
+		size_t count = 0;
+
+		traverse(shell->commands, print_command_location, &count);
+
+		if (!count)
+		{
+			fprintf(stdout, "hash: hash table empty\n");
+		}
+
+		// every hit would have repeated the PATH search of the first lookup
+		fprintf(stdout, "hash: %zu lookups, %zu hits, %zu access() calls, about %zu avoided\n",
+			stats->lookups, stats->hits, stats->probes, misses ? stats->hits * stats->probes / misses : (size_t)0);
+
+		return 0;
+	}
+
+	if (!strcmp(*argv, "-r"))
+	{
+		if (*(++argv))
+		{
+			fprintf(stderr, "hash: too many arguments\n");
+			return 1;
+		}
+
+		rehash_commands(shell);
+		return 0;
+	}
+
+	int rc = 0;
+
+	if (!strcmp(*argv, "-d"))
+	{
+		for (argv++; *argv; argv++)
+		{
+			if (!get(shell->commands, *argv))
+			{
+				fprintf(stderr, "hash: %s: not found\n", *argv);
+				rc = 1;
+			}
+
+			erase(shell->commands, *argv);
+		}
+
+		return rc;
+	}
+
+	if (!strcmp(*argv, "-t"))
+	{
+		int print_names = argv[1] && argv[2];
+
+		for (argv++; *argv; argv++)
+		{
+			char** path = get(shell->commands, *argv);
+
+			if (!path || !**path)
+			{
+				fprintf(stderr, "hash: %s: not found\n", *argv);
+				rc = 1;
+			}
+			else
+			{
+				print_names ? fprintf(stdout, "%s\t%s\n", *argv, *path) : fprintf(stdout, "%s\n", *path);
+			}
+		}
+
+		return rc;
+	}
+
+	for (; *argv; argv++)
+	{
+		if (is_builtin(*argv))
+		{
+			continue;
+		}
+
+		erase(shell->commands, *argv); // search PATH again
+
+		if (!find_executable(shell, *argv))
+		{
+			fprintf(stderr, "hash: %s: not found\n", *argv);
+			rc = 1;
+		}
+	}
+
+	return rc;
+}
+
+// help [bulitin_name]
+static int help(struct Shell* shell, char** argv)
+{
+	if (*argv)
+	{
+		const char* builtin_name = *argv;
+
+		if (*(++argv))
+		{
+			fprintf(stderr, "help: too many arguments\n");
+			return 1;
+		}
+
+		if (!strcmp(builtin_name, "cd"))
+		{
+			fprintf(stdout, "cd: cd [-L |-P] [directory]\nChanges current directory\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "export"))
+		{
+			fprintf(stdout, "export: export [name] [value]\nCreates [name] environment variable for current shell session\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "unset"))
+		{
+			fprintf(stdout, "unset: unset [name]\nRemoves [name] environment variable for current shell session\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "help"))
+		{
+			fprintf(stdout, "help: help [builtin_name]\nPrints info about [builtin_name] builtin command\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "bg"))
+		{
+			fprintf(stdout, "bg: bg [job_spec]\nPuts job in background, the current job by default\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "fg"))
+		{
+			fprintf(stdout, "fg: fg [job_spec]\nPuts job in foreground, the current job by default\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "jobs"))
+		{
+			fprintf(stdout, "jobs: jobs [-l | -p] [job_spec...]\nDisplays status of jobs, job_spec is %%n, %%%%, %%+ or %%-\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "kill"))
+		{
+			fprintf(stdout, "kill: kill [-s signal_name | -n signal_number | -signal] pid | job_spec... or kill -l [exit_status]\nSends a signal (TERM by default) to processes or jobs\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "wait"))
+		{
+			fprintf(stdout, "wait: wait [-n] [pid | job_spec...]\nWaits for jobs to complete and returns the exit status of the last one, -n waits for the next job\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "parallel"))
+		{
+			fprintf(stdout, "parallel: parallel [-j jobs] [-g] command [arg...] [::: word...]\nRuns command for each word (or line of the standard input) with at most jobs (the number of CPUs by default) running at once, {} in args is replaced by the word, -g groups the output of each job\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "test") || !strcmp(builtin_name, "["))
+		{
+			fprintf(stdout, "test: test [expression], [ [expression] ]\nEvaluates string (-n -z = != ==), integer (-eq -ne -gt -ge -lt -le) and file (-e -f -d -r -w -x -s -L -nt -ot -ef ...) tests combined with ! -a -o ( )\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "true") || !strcmp(builtin_name, "false") || !strcmp(builtin_name, ":"))
+		{
+			fprintf(stdout, "true, false, :\nReturn 0, 1 and 0, the arguments of : are expanded and ignored\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "echo"))
+		{
+			fprintf(stdout, "echo: echo [-neE] [string...]\nWrites arguments to the standard output, -n omits the newline, -e interprets backslash escapes\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "printf"))
+		{
+			fprintf(stdout, "printf: printf format [argument...]\nWrites arguments formatted by %%d %%i %%o %%u %%x %%X %%c %%s %%b %%e %%f %%g conversions, the format is reused while arguments remain\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "read"))
+		{
+			fprintf(stdout, "read: read [-r] [-d delim] [name...]\nReads a line (up to delim with -d) and splits it by IFS into the names, the last name gets the rest of the line, REPLY by default. Backslashes escape characters unless -r is given, returns 1 at the end of file\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "mapfile") || !strcmp(builtin_name, "readarray"))
+		{
+			fprintf(stdout, "mapfile: mapfile [-t] [array], readarray [-t] [array]\nReads the lines of the standard input into the array (MAPFILE by default), -t removes the newlines. The items are ${array[n]}, ${array[@]} and their number is ${#array[@]}\n");
+			return 0;
+		}
+
+		if (!strcmp(builtin_name, "hash"))
 		{
-			fprintf(stdout, "fg: fg\nPuts last job in foreground\n");
+			fprintf(stdout, "hash: hash [-r] [-d name...] [-t name...] [name...]\nRemembers or displays full paths of commands\n");
 			return 0;
 		}
 
@@ -456,7 +2118,7 @@ static int help(struct Shell* shell, char** argv)
 	}
 	else
 	{
-		fprintf(stdout, "Shell commands defined internally:\nhelp [builtin_name]\ncd: cd [-L |-P] [directory]\nexport [name] [value]\nunset [name]\nbg\nfg\n");
+		fprintf(stdout, "Shell commands defined internally:\nhelp [builtin_name]\ncd: cd [-L |-P] [directory]\nexport [name] [value]\nunset [name]\nbg [job_spec]\nfg [job_spec]\njobs [-l | -p] [job_spec...]\nkill [-s signal_name | -n signal_number | -signal] pid | job_spec...\nwait [-n] [pid | job_spec...]\nparallel [-j jobs] [-g] command [arg...] [::: word...]\ntest [expression]\n[ [expression] ]\ntrue\nfalse\n: [argument...]\necho [-neE] [string...]\nprintf format [argument...]\nread [-r] [-d delim] [name...]\nmapfile [-t] [array]\nreadarray [-t] [array]\nhash [-r] [-d name...] [-t name...] [name...]\n");
 		return 0;
 	}
 }
@@ -0,0 +1,235 @@
+#include "bytecode.h"
+#include "list.h"
+#include "utility.h"
+
+#define BYTECODE_CAP 32
+
+static void compile_commands(struct Bytecode* bytecode, CommandsList* commands);
+
+static size_t emit(struct Bytecode* bytecode, enum OpCode op, size_t operand, size_t slot, void* data)
+{
+	if (bytecode->size >= bytecode->capacity)
+	{
+		bytecode->capacity <<= 1;
+		bytecode->code = realloc(bytecode->code, bytecode->capacity * sizeof(struct Instruction));
+	}
+
+	struct Instruction* instruction = bytecode->code + bytecode->size;
+	instruction->op = op;
+	instruction->operand = operand;
+	instruction->slot = slot;
+	instruction->data = data;
+
+	return bytecode->size++;
+}
+
+// sets the jump target of the instruction at indx to the next emitted instruction
+static void patch(struct Bytecode* bytecode, size_t indx)
+{
+	bytecode->code[indx].operand = bytecode->size;
+}
+
+static int is_assignment(struct AstPipeline* pipeline)
+{
+	struct AstSimpleCommand* command = (struct AstSimpleCommand*)pipeline->pipeline->head->data;
+	return !pipeline->pipeline->head->next && !command->command_name;
+}
+
+static void compile_pipeline_list(struct Bytecode* bytecode, PipelinesList* pipe_list)
+{
+	for (struct Node* node = pipe_list->head; node; node = node->next)
+	{
+		struct AstPipeline* pipeline = (struct AstPipeline*)node->data;
+
+		if (is_assignment(pipeline))
+		{
+			struct AstSimpleCommand* command = (struct AstSimpleCommand*)pipeline->pipeline->head->data;
+			emit(bytecode, OP_ASSIGN, 0, 0, command->assignment_list);
+		}
+		else
+		{
+			emit(bytecode, OP_PIPELINE, 0, 0, pipeline);
+		}
+	}
+}
+
+static void compile_while(struct Bytecode* bytecode, struct AstWhile* ast_while)
+{
+	size_t slot = bytecode->slots++;
+	int redirected = ast_while->input_redirect || ast_while->output_redirect;
+
+	if (redirected)
+	{
+		emit(bytecode, OP_REDIRECT, 0, slot, ast_while);
+	}
+
+	emit(bytecode, OP_SET_RC, 0, 0, NULL);
+	emit(bytecode, OP_SAVE_RC, 0, slot, NULL);
+
+	size_t condition = bytecode->size;
+	compile_commands(bytecode, ast_while->condition);
+	size_t exit_jump = emit(bytecode, OP_JUMP_IF_FAILED, 0, 0, NULL);
+
+	compile_commands(bytecode, ast_while->body);
+	emit(bytecode, OP_SAVE_RC, 0, slot, NULL);
+	emit(bytecode, OP_JUMP, condition, 0, NULL);
+
+	patch(bytecode, exit_jump);
+	emit(bytecode, OP_LOAD_RC, 0, slot, NULL);
+
+	if (redirected)
+	{
+		emit(bytecode, OP_RESTORE_IO, 0, slot, NULL);
+	}
+}
+
+static void compile_if(struct Bytecode* bytecode, struct AstIf* ast_if)
+{
+	compile_commands(bytecode, ast_if->condition);
+	size_t else_jump = emit(bytecode, OP_JUMP_IF_FAILED, 0, 0, NULL);
+
+	compile_commands(bytecode, ast_if->if_part);
+	size_t end_jump = emit(bytecode, OP_JUMP, 0, 0, NULL);
+
+	patch(bytecode, else_jump);
+
+	if (ast_if->else_part)
+	{
+		compile_commands(bytecode, ast_if->else_part);
+	}
+	else
+	{
+		emit(bytecode, OP_SET_RC, 0, 0, NULL);
+	}
+
+	patch(bytecode, end_jump);
+}
+
+static void compile_for(struct Bytecode* bytecode, struct AstFor* ast_for)
+{
+	size_t slot = bytecode->slots++;
+
+	emit(bytecode, OP_FOR_BEGIN, 0, slot, ast_for);
+	size_t next = emit(bytecode, OP_FOR_NEXT, 0, slot, ast_for);
+
+	compile_commands(bytecode, ast_for->body);
+	emit(bytecode, OP_JUMP, next, 0, NULL);
+
+	patch(bytecode, next);
+	emit(bytecode, OP_FOR_END, 0, slot, ast_for);
+}
+
+// the jump table after CASE has an entry for each item and one for no match
+static void compile_case(struct Bytecode* bytecode, struct AstCase* ast_case)
+{
+	size_t items = get_list_size(ast_case->items);
+	size_t table = emit(bytecode, OP_CASE, items, 0, ast_case) + 1;
+
+	for (size_t i = 0; i <= items; i++)
+	{
+		emit(bytecode, OP_JUMP, 0, 0, NULL);
+	}
+
+	size_t* end_jumps = malloc((items + 1) * sizeof(size_t));
+	size_t i = 0;
+
+	for (struct Node* node = ast_case->items->head; node; node = node->next, i++)
+	{
+		struct AstCaseItem* item = (struct AstCaseItem*)node->data;
+
+		patch(bytecode, table + i);
+
+		if (item->body)
+		{
+			compile_commands(bytecode, item->body);
+		}
+		else
+		{
+			emit(bytecode, OP_SET_RC, 0, 0, NULL);
+		}
+
+		end_jumps[i] = emit(bytecode, OP_JUMP, 0, 0, NULL);
+	}
+
+	patch(bytecode, table + items);
+	emit(bytecode, OP_SET_RC, 0, 0, NULL);
+
+	for (i = 0; i < items; i++)
+	{
+		patch(bytecode, end_jumps[i]);
+	}
+
+	free(end_jumps);
+}
+
+static void compile_compound_cmd_list(struct Bytecode* bytecode, CompoundCommandsList* cmd_list)
+{
+	for (struct Node* node = cmd_list->head; node; node = node->next)
+	{
+		struct AstNode* ast_node = (struct AstNode*)node->data;
+
+		switch (ast_node->node_type)
+		{
+			case AST_WHILE:
+			{
+				compile_while(bytecode, (struct AstWhile*)ast_node->actual_data);
+			} break;
+			case AST_IF:
+			{
+				compile_if(bytecode, (struct AstIf*)ast_node->actual_data);
+			} break;
+			case AST_FOR:
+			{
+				compile_for(bytecode, (struct AstFor*)ast_node->actual_data);
+			} break;
+			case AST_CASE:
+			{
+				compile_case(bytecode, (struct AstCase*)ast_node->actual_data);
+			} break;
+			default: break; // never executed
+		}
+	}
+}
+
+// an empty commands list leaves the exit status of the last command unchanged, the callers take care of it
+static void compile_commands(struct Bytecode* bytecode, CommandsList* commands)
+{
+	if (commands)
+	{
+		for (struct Node* node = commands->head; node; node = node->next)
+		{
+			struct AstNode* ast_node = (struct AstNode*)node->data;
+
+			if (ast_node->node_type == AST_PIPELINE_LIST)
+			{
+				compile_pipeline_list(bytecode, (PipelinesList*)ast_node->actual_data);
+			}
+			else // ast_node->node_type == AST_COMPOUND_COMMANDS_LIST
+			{
+				compile_compound_cmd_list(bytecode, (CompoundCommandsList*)ast_node->actual_data);
+			}
+		}
+	}
+}
+
+struct Bytecode* compile(CommandsList* program)
+{
+	struct Bytecode* bytecode = calloc(1, sizeof(struct Bytecode));
+	bytecode->capacity = BYTECODE_CAP;
+	bytecode->code = malloc(BYTECODE_CAP * sizeof(struct Instruction));
+
+	compile_commands(bytecode, program);
+	emit(bytecode, OP_HALT, 0, 0, NULL);
+
+	return bytecode;
+}
+
+void destroy_bytecode(struct Bytecode** bytecode)
+{
+	if (*bytecode)
+	{
+		free((*bytecode)->code);
+		free(*bytecode);
+		*bytecode = NULL;
+	}
+}
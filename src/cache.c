@@ -0,0 +1,1011 @@
+#include "cache.h"
+#include "list.h"
+#include "utility.h"
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <stddef.h>
+
+#define RECORD_CAP 4096
+#define NONE UINT32_MAX // NULL pointer or NULL list
+
+/*
+	serialization
+*/
+
+static void put(struct ScriptCache* cache, const void* data, size_t size)
+{
+	if (cache->record_size + size > cache->record_capacity)
+	{
+		while (cache->record_size + size > cache->record_capacity)
+		{
+			cache->record_capacity <<= 1;
+		}
+
+		cache->record = realloc(cache->record, cache->record_capacity);
+	}
+
+	memcpy(cache->record + cache->record_size, data, size);
+	cache->record_size += size;
+}
+
+static void put_u32(struct ScriptCache* cache, uint32_t value)
+{
+	put(cache, &value, sizeof(value));
+}
+
+static void put_u64(struct ScriptCache* cache, uint64_t value)
+{
+	put(cache, &value, sizeof(value));
+}
+
+static void put_string(struct ScriptCache* cache, const char* string)
+{
+	if (!string)
+	{
+		put_u32(cache, NONE);
+		return;
+	}
+
+	uint32_t size = (uint32_t)strlen(string);
+	put_u32(cache, size);
+	put(cache, string, size + 1);
+}
+
+static void put_token(struct ScriptCache* cache, struct Token* token)
+{
+	put_u32(cache, token->type);
+	put_string(cache, token->word.buffer);
+}
+
+static void put_word(struct ScriptCache* cache, struct AstWord* word)
+{
+	if (!word)
+	{
+		put_u32(cache, NONE);
+		return;
+	}
+
+	put_token(cache, &word->word);
+	put_u32(cache, (word->glob != NULL) | (word->brace != NULL) << 1);
+	put_string(cache, word->word.pattern);
+}
+
+static void put_redirect(struct ScriptCache* cache, struct AstIORedirect* redirect)
+{
+	if (!redirect)
+	{
+		put_u32(cache, NONE);
+		return;
+	}
+
+	put_u32(cache, redirect->token->type);
+	put_word(cache, redirect->file_name);
+}
+
+static void put_arithm_program(struct ScriptCache* cache, struct ArithmProgram* program)
+{
+	put_u64(cache, program->size);
+	put_u64(cache, program->depth);
+
+	for (size_t i = 0; i < program->size; i++)
+	{
+		put_u32(cache, program->ops[i].type);
+		put_u64(cache, (uint64_t)program->ops[i].value);
+		put_string(cache, program->ops[i].parameter);
+	}
+}
+
+static void put_nodes(struct ScriptCache* cache, struct List* nodes);
+
+static void put_simple_command(struct ScriptCache* cache, struct AstSimpleCommand* command)
+{
+	if (!command->assignment_list)
+	{
+		put_u32(cache, NONE);
+	}
+	else
+	{
+		put_u32(cache, (uint32_t)get_list_size(command->assignment_list));
+
+		for (struct Node* node = command->assignment_list->head; node; node = node->next)
+		{
+			struct AstAssignment* assignment = (struct AstAssignment*)node->data;
+			put_token(cache, assignment->variable);
+			put_u32(cache, assignment->expression->node_type);
+
+			if (assignment->expression->node_type == AST_WORD)
+			{
+				put_word(cache, (struct AstWord*)assignment->expression->actual_data);
+			}
+			else
+			{
+				put_arithm_program(cache, (struct ArithmProgram*)assignment->expression->actual_data);
+			}
+		}
+	}
+
+	put_word(cache, command->command_name);
+	put_nodes(cache, command->command_args);
+	put_redirect(cache, command->input_redirect);
+	put_redirect(cache, command->output_redirect);
+}
+
+static void put_pipelines(struct ScriptCache* cache, PipelinesList* pipelines)
+{
+	put_u32(cache, (uint32_t)get_list_size(pipelines));
+
+	for (struct Node* node = pipelines->head; node; node = node->next)
+	{
+		struct AstPipeline* pipeline = (struct AstPipeline*)node->data;
+		put_u32(cache, pipeline->mode);
+		put_u32(cache, (uint32_t)get_list_size(pipeline->pipeline));
+
+		for (struct Node* command = pipeline->pipeline->head; command; command = command->next)
+		{
+			put_simple_command(cache, (struct AstSimpleCommand*)command->data);
+		}
+	}
+}
+
+static void put_node(struct ScriptCache* cache, struct AstNode* node)
+{
+	put_u32(cache, node->node_type);
+
+	switch (node->node_type)
+	{
+		case AST_WORD:
+		{
+			put_word(cache, (struct AstWord*)node->actual_data);
+		} break;
+		case AST_ARITHM_EXPR:
+		{
+			put_arithm_program(cache, (struct ArithmProgram*)node->actual_data);
+		} break;
+		case AST_IF:
+		{
+			struct AstIf* ast_if = (struct AstIf*)node->actual_data;
+			put_nodes(cache, ast_if->condition);
+			put_nodes(cache, ast_if->if_part);
+			put_nodes(cache, ast_if->else_part);
+		} break;
+		case AST_WHILE:
+		{
+			struct AstWhile* ast_while = (struct AstWhile*)node->actual_data;
+			put_nodes(cache, ast_while->condition);
+			put_nodes(cache, ast_while->body);
+			put_redirect(cache, ast_while->input_redirect);
+			put_redirect(cache, ast_while->output_redirect);
+		} break;
+		case AST_FOR:
+		{
+			struct AstFor* ast_for = (struct AstFor*)node->actual_data;
+			put_word(cache, ast_for->variable);
+			put_nodes(cache, ast_for->wordlist);
+			put_nodes(cache, ast_for->body);
+		} break;
+		case AST_CASE:
+		{
+			struct AstCase* ast_case = (struct AstCase*)node->actual_data;
+			put_word(cache, ast_case->word);
+			put_u32(cache, (uint32_t)get_list_size(ast_case->items));
+
+			for (struct Node* item = ast_case->items->head; item; item = item->next)
+			{
+				put_nodes(cache, ((struct AstCaseItem*)item->data)->patterns);
+				put_nodes(cache, ((struct AstCaseItem*)item->data)->body);
+			}
+		} break;
+		case AST_PIPELINE_LIST:
+		{
+			put_pipelines(cache, (PipelinesList*)node->actual_data);
+		} break;
+		case AST_COMPOUND_COMMANDS_LIST:
+		{
+			put_nodes(cache, (CompoundCommandsList*)node->actual_data);
+		} break;
+	}
+}
+
+// Wordlist, CompoundCommandsList and CommandsList contain AstNode structures
+static void put_nodes(struct ScriptCache* cache, struct List* nodes)
+{
+	if (!nodes)
+	{
+		put_u32(cache, NONE);
+		return;
+	}
+
+	put_u32(cache, (uint32_t)get_list_size(nodes));
+
+	for (struct Node* node = nodes->head; node; node = node->next)
+	{
+		put_node(cache, (struct AstNode*)node->data);
+	}
+}
+
+/*
+	deserialization, every read is checked against the end of the record, so a damaged cache file
+	makes the load fail instead of reading past the record or building an AST the executor can't run
+*/
+
+#define COMMAND_NODES (1 << AST_PIPELINE_LIST | 1 << AST_COMPOUND_COMMANDS_LIST) // CommandsList
+#define COMPOUND_NODES (1 << AST_IF | 1 << AST_WHILE | 1 << AST_FOR | 1 << AST_CASE) // CompoundCommandsList
+#define WORD_NODES (1 << AST_WORD | 1 << AST_ARITHM_EXPR) // Wordlist
+
+struct Reader
+{
+	const char* data;
+	size_t position;
+	size_t end; // the end of the record
+	int failed; // once set, every read returns zero or NULL
+	struct Arena* arena;
+};
+
+static int fail(struct Reader* reader)
+{
+	reader->failed = 1;
+	return 0;
+}
+
+static int has_bytes(struct Reader* reader, size_t size)
+{
+	return !reader->failed && reader->end - reader->position >= size ? 1 : fail(reader);
+}
+
+static uint32_t get_u32(struct Reader* reader)
+{
+	uint32_t value = 0;
+
+	if (has_bytes(reader, sizeof(value)))
+	{
+		memcpy(&value, reader->data + reader->position, sizeof(value));
+		reader->position += sizeof(value);
+	}
+
+	return value;
+}
+
+static uint64_t get_u64(struct Reader* reader)
+{
+	uint64_t value = 0;
+
+	if (has_bytes(reader, sizeof(value)))
+	{
+		memcpy(&value, reader->data + reader->position, sizeof(value));
+		reader->position += sizeof(value);
+	}
+
+	return value;
+}
+
+// a count of items that take at least item_size bytes each, NONE is returned as it is
+static uint32_t get_count(struct Reader* reader, size_t item_size)
+{
+	uint32_t count = get_u32(reader);
+
+	if (count != NONE && count > (reader->end - reader->position) / item_size)
+	{
+		fail(reader);
+		return 0;
+	}
+
+	return count;
+}
+
+static uint32_t get_enum(struct Reader* reader, uint32_t last)
+{
+	uint32_t value = get_u32(reader);
+	return value <= last ? value : fail(reader);
+}
+
+// the string isn't copied, it stays in the mapped cache
+static char* get_string(struct Reader* reader, size_t* size)
+{
+	uint32_t length = get_u32(reader);
+	*size = 0;
+
+	if (length == NONE || !has_bytes(reader, (size_t)length + 1))
+	{
+		return NULL;
+	}
+
+	char* string = (char*)reader->data + reader->position;
+
+	if (string[length] != '\0')
+	{
+		fail(reader);
+		return NULL;
+	}
+
+	reader->position += (size_t)length + 1;
+	*size = length;
+
+	return string;
+}
+
+// returns 0 if the token has no text
+static int get_token(struct Reader* reader, struct Token* token)
+{
+	token->type = (enum TokenType)get_enum(reader, END);
+	token->word.buffer = get_string(reader, &token->word.size);
+	token->word.capacity = token->word.size + 1;
+
+	return token->word.buffer ? 1 : fail(reader);
+}
+
+static struct AstWord* get_word(struct Reader* reader)
+{
+	uint32_t type = get_u32(reader);
+
+	if (type == NONE || reader->failed)
+	{
+		return NULL;
+	}
+
+	if (type != WORD && type != NAME && type != PARAMETER_EXPANSION)
+	{
+		fail(reader);
+		return NULL;
+	}
+
+	struct AstWord* word = arena_alloc(reader->arena, sizeof(struct AstWord));
+	word->word.type = (enum TokenType)type;
+
+	if (!(word->word.word.buffer = get_string(reader, &word->word.word.size)))
+	{
+		fail(reader);
+		return NULL;
+	}
+
+	word->word.word.capacity = word->word.word.size + 1;
+
+	if (word->word.type == PARAMETER_EXPANSION && word->word.word.buffer[0] == '{'
+		&& !(word->expansion = compile_param_exp(reader->arena, word->word.word.buffer)))
+	{
+		fail(reader);
+		return NULL;
+	}
+
+	uint32_t expansions = get_enum(reader, 3);
+	size_t pattern_size;
+	word->word.pattern = get_string(reader, &pattern_size); // NONE if the word has no quoted pattern characters
+
+	if (expansions & 1)
+	{
+		word->glob = compile_glob(reader->arena, pattern_text(&word->word));
+	}
+
+	if ((expansions & 2) && !(word->brace = compile_brace_exp(reader->arena, word->word.word.buffer)))
+	{
+		fail(reader);
+		return NULL;
+	}
+
+	return word;
+}
+
+static struct AstIORedirect* get_redirect(struct Reader* reader)
+{
+	uint32_t type = get_u32(reader);
+
+	if (type == NONE || reader->failed)
+	{
+		return NULL;
+	}
+
+	struct AstIORedirect* redirect = arena_alloc(reader->arena, sizeof(struct AstIORedirect));
+	redirect->token = arena_alloc(reader->arena, sizeof(struct Token));
+	redirect->token->type = (enum TokenType)type;
+	redirect->file_name = get_word(reader);
+
+	if ((type != INPUT_REDIRECT && type != OUTPUT_REDIRECT) || !redirect->file_name)
+	{
+		fail(reader);
+		return NULL;
+	}
+
+	return redirect;
+}
+
+// the program is also checked to fit in its evaluation stack and to leave one value on it
+static struct ArithmProgram* get_arithm_program(struct Reader* reader)
+{
+	struct ArithmProgram* program = arena_alloc(reader->arena, sizeof(struct ArithmProgram));
+	uint64_t size = get_u64(reader);
+	program->depth = get_u64(reader);
+
+	if (size > (reader->end - reader->position) / (2 * sizeof(uint32_t) + sizeof(uint64_t)) || program->depth > size)
+	{
+		fail(reader);
+		return NULL;
+	}
+
+	program->size = (size_t)size;
+	program->ops = arena_alloc(reader->arena, program->size * sizeof(struct ArithmOp));
+	size_t top = 0;
+
+	for (size_t i = 0; i < program->size && !reader->failed; i++)
+	{
+		size_t length;
+		struct ArithmOp* op = program->ops + i;
+		op->type = (enum ArithmOpType)get_enum(reader, ARITHM_NEGATE);
+		op->value = (int64_t)get_u64(reader);
+		op->parameter = get_string(reader, &length);
+
+		if (op->type == ARITHM_INTEGER || op->type == ARITHM_PARAMETER)
+		{
+			top++;
+		}
+		else if (op->type != ARITHM_NEGATE && top > 1)
+		{
+			top--;
+		}
+		else if (op->type != ARITHM_NEGATE || !top)
+		{
+			fail(reader);
+		}
+
+		if (top > program->depth || (op->type == ARITHM_PARAMETER && !op->parameter))
+		{
+			fail(reader);
+		}
+	}
+
+	if (top != 1 || reader->failed)
+	{
+		fail(reader);
+		return NULL;
+	}
+
+	return program;
+}
+
+static struct AstNode* create_node(struct Reader* reader, void* actual_data, enum AstNodeType node_type)
+{
+	struct AstNode* node = arena_alloc(reader->arena, sizeof(struct AstNode));
+	node->actual_data = actual_data;
+	node->node_type = node_type;
+	return node;
+}
+
+static struct List* get_nodes(struct Reader* reader, unsigned types);
+
+static struct AstSimpleCommand* get_simple_command(struct Reader* reader)
+{
+	struct AstSimpleCommand* command = arena_alloc(reader->arena, sizeof(struct AstSimpleCommand));
+	uint32_t count = get_count(reader, 3 * sizeof(uint32_t));
+
+	if (count != NONE)
+	{
+		command->assignment_list = create_arena_list(reader->arena);
+
+		for (uint32_t i = 0; i < count && !reader->failed; i++)
+		{
+			struct AstAssignment* assignment = arena_alloc(reader->arena, sizeof(struct AstAssignment));
+			assignment->variable = arena_alloc(reader->arena, sizeof(struct Token));
+			get_token(reader, assignment->variable);
+
+			if (get_enum(reader, AST_ARITHM_EXPR) == AST_WORD)
+			{
+				struct AstWord* word = get_word(reader);
+				assignment->expression = create_node(reader, word, AST_WORD);
+
+				if (!word)
+				{
+					fail(reader);
+				}
+			}
+			else
+			{
+				assignment->expression = create_node(reader, get_arithm_program(reader), AST_ARITHM_EXPR);
+			}
+
+			push_back(command->assignment_list, assignment);
+		}
+	}
+
+	command->command_name = get_word(reader);
+	command->command_args = get_nodes(reader, WORD_NODES);
+	command->input_redirect = get_redirect(reader);
+	command->output_redirect = get_redirect(reader);
+
+	return command;
+}
+
+static PipelinesList* get_pipelines(struct Reader* reader)
+{
+	PipelinesList* pipelines = create_arena_list(reader->arena);
+	uint32_t count = get_count(reader, 2 * sizeof(uint32_t));
+
+	if (!count || count == NONE)
+	{
+		fail(reader);
+	}
+
+	for (; count && !reader->failed; count--)
+	{
+		struct AstPipeline* pipeline = arena_alloc(reader->arena, sizeof(struct AstPipeline));
+		pipeline->mode = (enum RunningMode)get_enum(reader, BACKGROUND);
+		pipeline->pipeline = create_arena_list(reader->arena);
+		uint32_t commands = get_count(reader, 5 * sizeof(uint32_t));
+
+		if (!commands || commands == NONE)
+		{
+			fail(reader);
+		}
+
+		for (; commands && !reader->failed; commands--)
+		{
+			push_back(pipeline->pipeline, get_simple_command(reader));
+		}
+
+		push_back(pipelines, pipeline);
+	}
+
+	return pipelines;
+}
+
+// a list the parser never leaves NULL
+static struct List* get_required_nodes(struct Reader* reader, unsigned types)
+{
+	struct List* nodes = get_nodes(reader, types);
+
+	if (!nodes)
+	{
+		fail(reader);
+	}
+
+	return nodes;
+}
+
+static struct AstNode* get_node(struct Reader* reader, unsigned types)
+{
+	enum AstNodeType type = (enum AstNodeType)get_enum(reader, AST_COMPOUND_COMMANDS_LIST);
+	void* data = NULL;
+
+	if (!(types & 1 << type))
+	{
+		fail(reader);
+	}
+
+	if (reader->failed)
+	{
+		return NULL;
+	}
+
+	switch (type)
+	{
+		case AST_WORD:
+		{
+			if (!(data = get_word(reader)))
+			{
+				fail(reader);
+			}
+		} break;
+		case AST_ARITHM_EXPR:
+		{
+			data = get_arithm_program(reader);
+		} break;
+		case AST_IF:
+		{
+			struct AstIf* ast_if = arena_alloc(reader->arena, sizeof(struct AstIf));
+			ast_if->condition = get_required_nodes(reader, COMMAND_NODES);
+			ast_if->if_part = get_nodes(reader, COMMAND_NODES);
+			ast_if->else_part = get_nodes(reader, COMMAND_NODES);
+			data = ast_if;
+		} break;
+		case AST_WHILE:
+		{
+			struct AstWhile* ast_while = arena_alloc(reader->arena, sizeof(struct AstWhile));
+			ast_while->condition = get_required_nodes(reader, COMMAND_NODES);
+			ast_while->body = get_nodes(reader, COMMAND_NODES);
+			ast_while->input_redirect = get_redirect(reader);
+			ast_while->output_redirect = get_redirect(reader);
+			data = ast_while;
+		} break;
+		case AST_FOR:
+		{
+			struct AstFor* ast_for = arena_alloc(reader->arena, sizeof(struct AstFor));
+
+			if (!(ast_for->variable = get_word(reader)))
+			{
+				fail(reader);
+			}
+
+			ast_for->wordlist = get_nodes(reader, WORD_NODES);
+			ast_for->body = get_nodes(reader, COMMAND_NODES);
+			data = ast_for;
+		} break;
+		case AST_CASE:
+		{
+			struct AstCase* ast_case = arena_alloc(reader->arena, sizeof(struct AstCase));
+			ast_case->items = create_arena_list(reader->arena);
+
+			if (!(ast_case->word = get_word(reader)))
+			{
+				fail(reader);
+			}
+
+			uint32_t count = get_count(reader, 2 * sizeof(uint32_t));
+
+			if (count == NONE)
+			{
+				fail(reader);
+			}
+
+			for (; count && !reader->failed; count--)
+			{
+				struct AstCaseItem* item = arena_alloc(reader->arena, sizeof(struct AstCaseItem));
+				item->patterns = get_required_nodes(reader, 1 << AST_WORD);
+				item->body = get_nodes(reader, COMMAND_NODES);
+				push_back(ast_case->items, item);
+			}
+
+			if (!reader->failed)
+			{
+				compile_case_patterns(reader->arena, ast_case); // the automaton isn't serialized
+			}
+
+			data = ast_case;
+		} break;
+		case AST_PIPELINE_LIST:
+		{
+			data = get_pipelines(reader);
+		} break;
+		case AST_COMPOUND_COMMANDS_LIST:
+		{
+			data = get_required_nodes(reader, COMPOUND_NODES);
+		} break;
+	}
+
+	return reader->failed ? NULL : create_node(reader, data, type);
+}
+
+// the nodes must have one of the types, a bit for each AstNodeType
+static struct List* get_nodes(struct Reader* reader, unsigned types)
+{
+	uint32_t count = get_count(reader, sizeof(uint32_t));
+
+	if (count == NONE || reader->failed)
+	{
+		return NULL;
+	}
+
+	struct List* nodes = create_arena_list(reader->arena);
+
+	for (; count && !reader->failed; count--)
+	{
+		push_back(nodes, get_node(reader, types));
+	}
+
+	return reader->failed ? NULL : nodes;
+}
+
+/*
+	cache files
+*/
+
+// $XDG_CACHE_HOME/smsh/<hash of the path>, the directories are created if needed
+static char* cache_file_path(const char* script_path)
+{
+	const char* base = getenv("XDG_CACHE_HOME");
+	char directory[PATH_MAX];
+
+	if (base && *base)
+	{
+		snprintf(directory, sizeof(directory), "%s", base);
+	}
+	else
+	{
+		const char* home = getenv("HOME");
+
+		if (!home || !*home)
+		{
+			return NULL;
+		}
+
+		snprintf(directory, sizeof(directory), "%s/.cache", home);
+	}
+
+	mkdir(directory, 0700);
+
+	size_t length = strlen(directory);
+	snprintf(directory + length, sizeof(directory) - length, "/smsh");
+
+	if (mkdir(directory, 0700) == -1 && errno != EEXIST)
+	{
+		return NULL;
+	}
+
+	uint64_t hash = 14695981039346656037ULL; // FNV-1a
+
+	for (const char* c = script_path; *c; c++)
+	{
+		hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+	}
+
+	char* path = malloc(strlen(directory) + 18);
+	sprintf(path, "%s/%016llx", directory, (unsigned long long)hash);
+
+	return path;
+}
+
+static void fill_header(struct CacheHeader* header, const char* script_path, const struct stat* st)
+{
+	memset(header, 0, sizeof(struct CacheHeader));
+	memcpy(header->magic, CACHE_MAGIC, sizeof(header->magic));
+	header->version = CACHE_VERSION;
+	header->path_size = (uint32_t)strlen(script_path) + 1;
+	header->device = (uint64_t)st->st_dev;
+	header->inode = (uint64_t)st->st_ino;
+	header->size = (uint64_t)st->st_size;
+	header->mtime_sec = (int64_t)st->st_mtim.tv_sec;
+	header->mtime_nsec = (int64_t)st->st_mtim.tv_nsec;
+}
+
+// FNV-1a over 8-byte words, each step is a bijection of the state, so a single changed word always changes the result
+static uint64_t checksum(const char* data, size_t size)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	size_t i = 0;
+
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * 1099511628211ULL;
+		hash ^= hash >> 29;
+	}
+
+	for (; i < size; i++)
+	{
+		hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+// checks the header, the checksum and that the records end exactly at the end of the file
+static int is_valid(const char* data, size_t size, const struct CacheHeader* expected, const char* script_path)
+{
+	struct CacheHeader header;
+	size_t position = sizeof(struct CacheHeader) + expected->path_size;
+
+	if (size < position)
+	{
+		return 0;
+	}
+
+	memcpy(&header, data, sizeof(header));
+	header.checksum = 0;
+
+	if (memcmp(&header, expected, sizeof(struct CacheHeader))
+		|| memcmp(data + sizeof(struct CacheHeader), script_path, expected->path_size)
+		|| checksum(data + position, size - position) != ((const struct CacheHeader*)data)->checksum)
+	{
+		return 0;
+	}
+
+	while (size - position >= sizeof(uint64_t))
+	{
+		uint64_t record_size;
+		memcpy(&record_size, data + position, sizeof(record_size));
+		position += sizeof(record_size);
+
+		if (!record_size)
+		{
+			return position == size;
+		}
+
+		if (record_size > size - position)
+		{
+			return 0;
+		}
+
+		position += record_size;
+	}
+
+	return 0;
+}
+
+static int map_cache(struct ScriptCache* cache, const struct CacheHeader* header, const char* script_path)
+{
+	int fd = open(cache->path, O_RDONLY);
+	if (fd == -1)
+	{
+		return 0;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 || !st.st_size)
+	{
+		close(fd);
+		return 0;
+	}
+
+	char* mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (mapping == MAP_FAILED)
+	{
+		return 0;
+	}
+
+	if (!is_valid(mapping, (size_t)st.st_size, header, script_path))
+	{
+		munmap(mapping, (size_t)st.st_size);
+		return 0;
+	}
+
+	madvise(mapping, (size_t)st.st_size, MADV_SEQUENTIAL);
+	cache->mapping = mapping;
+	cache->mapping_size = (size_t)st.st_size;
+	cache->position = sizeof(struct CacheHeader) + header->path_size;
+
+	return 1;
+}
+
+static void create_cache_file(struct ScriptCache* cache, const struct CacheHeader* header, const char* script_path)
+{
+	cache->temp_path = malloc(strlen(cache->path) + 8);
+	sprintf(cache->temp_path, "%s.XXXXXX", cache->path);
+
+	int fd = mkstemp(cache->temp_path);
+	if (fd == -1)
+	{
+		free(cache->temp_path);
+		cache->temp_path = NULL;
+		return;
+	}
+
+	cache->file = fdopen(fd, "wb");
+	cache->record_capacity = RECORD_CAP;
+	cache->record = malloc(RECORD_CAP);
+
+	fwrite(header, sizeof(struct CacheHeader), 1, cache->file);
+	fwrite(script_path, header->path_size, 1, cache->file);
+}
+
+int open_script_cache(struct ScriptCache* cache, const char* script_path, const struct stat* st)
+{
+	memset(cache, 0, sizeof(struct ScriptCache));
+
+	char full_path[PATH_MAX];
+	if (!realpath(script_path, full_path) || !(cache->path = cache_file_path(full_path)))
+	{
+		return 0;
+	}
+
+	struct CacheHeader header;
+	fill_header(&header, full_path, st);
+
+	if (map_cache(cache, &header, full_path))
+	{
+		return 1;
+	}
+
+	create_cache_file(cache, &header, full_path);
+
+	return 0;
+}
+
+CommandsList* load_command(struct ScriptCache* cache, struct Arena* arena)
+{
+	uint64_t record_size;
+	memcpy(&record_size, cache->mapping + cache->position, sizeof(record_size)); // the record chain was checked by is_valid()
+
+	if (!record_size)
+	{
+		return NULL;
+	}
+
+	size_t position = cache->position + sizeof(record_size);
+	struct Reader reader = { cache->mapping, position, position + record_size, 0, arena };
+	CommandsList* program = get_nodes(&reader, COMMAND_NODES);
+
+	if (!program || reader.failed || reader.position != reader.end)
+	{
+		cache->failed = 1;
+		return NULL;
+	}
+
+	cache->position = reader.position;
+
+	return program;
+}
+
+void save_command(struct ScriptCache* cache, CommandsList* program)
+{
+	if (cache->file)
+	{
+		cache->record_size = 0;
+		put_nodes(cache, program);
+
+		uint64_t record_size = cache->record_size;
+
+		fwrite(&record_size, sizeof(record_size), 1, cache->file);
+		fwrite(cache->record, record_size, 1, cache->file);
+	}
+}
+
+// the checksum of the records is stored in the header of the written file
+static int write_checksum(int fd)
+{
+	struct stat st;
+	if (fstat(fd, &st) == -1)
+	{
+		return -1;
+	}
+
+	char* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED)
+	{
+		return -1;
+	}
+
+	struct CacheHeader header;
+	memcpy(&header, data, sizeof(header));
+	size_t position = sizeof(struct CacheHeader) + header.path_size;
+	uint64_t sum = checksum(data + position, (size_t)st.st_size - position);
+	munmap(data, (size_t)st.st_size);
+
+	off_t offset = (off_t)offsetof(struct CacheHeader, checksum);
+	return pwrite(fd, &sum, sizeof(sum), offset) == (ssize_t)sizeof(sum) ? 0 : -1;
+}
+
+void commit_script_cache(struct ScriptCache* cache)
+{
+	if (cache->file)
+	{
+		uint64_t end = 0;
+		fwrite(&end, sizeof(end), 1, cache->file);
+
+		int failed = fflush(cache->file) || write_checksum(fileno(cache->file));
+		failed |= ferror(cache->file);
+		failed |= fclose(cache->file);
+		cache->file = NULL;
+
+		if (!failed && !rename(cache->temp_path, cache->path))
+		{
+			free(cache->temp_path);
+			cache->temp_path = NULL;
+		}
+	}
+}
+
+void remove_script_cache(struct ScriptCache* cache)
+{
+	if (cache->path)
+	{
+		unlink(cache->path);
+	}
+
+	close_script_cache(cache);
+}
+
+void close_script_cache(struct ScriptCache* cache)
+{
+	if (cache->mapping)
+	{
+		munmap(cache->mapping, cache->mapping_size);
+	}
+
+	if (cache->file)
+	{
+		fclose(cache->file);
+	}
+
+	if (cache->temp_path)
+	{
+		unlink(cache->temp_path);
+		free(cache->temp_path);
+	}
+
+	free(cache->path);
+	free(cache->record);
+	memset(cache, 0, sizeof(struct ScriptCache));
+}
@@ -0,0 +1,414 @@
+#include "format.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+
+#define FORMAT_STOP 'C' // \c in the format, ends the output
+#define FORMAT_NUMBER_SIZE 128 // formatted conversions that don't fit are formatted again into the heap
+
+static int octal_digit(char c)
+{
+	return c >= '0' && c <= '7';
+}
+
+static int hex_digit(char c)
+{
+	return (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+}
+
+/*
+	s points after '\', the escaped character is stored in c. Returns the number of characters used,
+	0 if s isn't an escape and -1 for \c. Octal escapes are \nnn in formats and \0nnn in echo -e and %b.
+*/
+static int parse_escape(const char* s, int octal_zero, char* c)
+{
+	switch (*s)
+	{
+		case 'a': *c = '\a'; return 1;
+		case 'b': *c = '\b'; return 1;
+		case 'e': *c = '\033'; return 1;
+		case 'f': *c = '\f'; return 1;
+		case 'n': *c = '\n'; return 1;
+		case 'r': *c = '\r'; return 1;
+		case 't': *c = '\t'; return 1;
+		case 'v': *c = '\v'; return 1;
+		case '\\': *c = '\\'; return 1;
+		case 'c': return -1;
+		case '"':
+		case '\'':
+		{
+			*c = *s;
+			return octal_zero ? 0 : 1;
+		}
+		case 'x':
+		{
+			int value = 0;
+			int used = 1;
+
+			for (; used < 3 && hex_digit(s[used]) != -1; used++)
+			{
+				value = value * 16 + hex_digit(s[used]);
+			}
+
+			*c = (char)value;
+			return used > 1 ? used : 0;
+		}
+		default: break;
+	}
+
+	if (!octal_digit(*s) || (octal_zero && *s != '0'))
+	{
+		return 0;
+	}
+
+	int used = octal_zero ? 1 : 0;
+	int value = 0;
+
+	for (int digits = 0; digits < 3 && octal_digit(s[used]); digits++, used++)
+	{
+		value = value * 8 + s[used] - '0';
+	}
+
+	*c = (char)value;
+
+	return used;
+}
+
+// dest gets at most strlen(s) characters, returns 1 if \c was found
+static int unescape(const char* s, char* dest, size_t* size, int octal_zero)
+{
+	*size = 0;
+
+	for (; *s; s++)
+	{
+		char c = *s;
+
+		if (c == '\\')
+		{
+			int used = parse_escape(s + 1, octal_zero, &c);
+
+			if (used == -1)
+			{
+				return 1;
+			}
+
+			s += used;
+		}
+
+		dest[(*size)++] = c;
+	}
+
+	return 0;
+}
+
+int print_escaped(struct Output* output, const char* string)
+{
+	size_t size;
+	char* text = malloc(strlen(string) + 1);
+	int stop = unescape(string, text, &size, 1);
+
+	output_write(output, text, size);
+	free(text);
+
+	return stop;
+}
+
+static const char* parse_conversion(const char* p, struct FormatSpec* spec)
+{
+	const char* start = p; // after '%'
+	size_t length = 0;
+
+	while (*p && strchr("-+ #0", *p))
+	{
+		p++;
+	}
+
+	while (*p >= '0' && *p <= '9')
+	{
+		p++;
+	}
+
+	if (*p == '.')
+	{
+		p++;
+
+		while (*p >= '0' && *p <= '9')
+		{
+			p++;
+		}
+	}
+
+	if (!*p || !strchr("diouxXcsbeEfFgGaA", *p))
+	{
+		return NULL;
+	}
+
+	spec->conversion = *p;
+
+	if ((*p == 's' || *p == 'b') && p == start) // plain %s and %b are written without snprintf()
+	{
+		spec->directive[0] = '\0';
+		return p + 1;
+	}
+
+	length = (size_t)(p - start);
+
+	if (length + 5 > FORMAT_DIRECTIVE_SIZE)
+	{
+		return NULL;
+	}
+
+	char* directive = spec->directive;
+	*directive++ = '%';
+	memcpy(directive, start, length);
+	directive += length;
+
+	if (strchr("diouxX", *p))
+	{
+		*directive++ = 'l';
+		*directive++ = 'l';
+	}
+
+	*directive++ = *p == 'b' ? 's' : *p;
+	*directive = '\0';
+
+	return p + 1;
+}
+
+struct Format* compile_format(struct Arena* arena, const char* format)
+{
+	size_t length = strlen(format);
+	size_t max_specs = 1;
+
+	for (const char* p = format; *p; p++)
+	{
+		max_specs += *p == '%';
+	}
+
+	struct Format* result = arena_alloc(arena, sizeof(struct Format));
+	char* text = arena_alloc(arena, length + 1);
+	result->specs = arena_alloc(arena, max_specs * sizeof(struct FormatSpec));
+
+	struct FormatSpec* spec = result->specs;
+	spec->text = text;
+
+	for (const char* p = format; *p; )
+	{
+		if (*p == '\\')
+		{
+			char c = '\\';
+			int used = parse_escape(p + 1, 0, &c);
+
+			if (used == -1)
+			{
+				spec->conversion = FORMAT_STOP;
+				break;
+			}
+
+			*text++ = c;
+			spec->text_size++;
+			p += used + 1;
+		}
+		else if (*p == '%' && p[1] == '%')
+		{
+			*text++ = '%';
+			spec->text_size++;
+			p += 2;
+		}
+		else if (*p == '%')
+		{
+			p = parse_conversion(p + 1, spec);
+
+			if (!p)
+			{
+				fprintf(stderr, "printf: %s: invalid format\n", format);
+				return NULL;
+			}
+
+			result->conversions++;
+			spec++;
+			spec->text = text;
+		}
+		else
+		{
+			*text++ = *p++;
+			spec->text_size++;
+		}
+	}
+
+	result->size = (size_t)(spec - result->specs) + (spec->text_size || spec->conversion ? 1 : 0);
+
+	return result;
+}
+
+static void print_directive(struct Output* output, const char* directive, ...)
+{
+	char buffer[FORMAT_NUMBER_SIZE];
+	va_list args;
+
+	va_start(args, directive);
+	int size = vsnprintf(buffer, sizeof(buffer), directive, args);
+	va_end(args);
+
+	if (size < 0)
+	{
+		return;
+	}
+
+	if ((size_t)size < sizeof(buffer))
+	{
+		output_write(output, buffer, (size_t)size);
+		return;
+	}
+
+	char* text = malloc((size_t)size + 1);
+
+	va_start(args, directive);
+	vsnprintf(text, (size_t)size + 1, directive, args);
+	va_end(args);
+
+	output_write(output, text, (size_t)size);
+	free(text);
+}
+
+// 'c and "c are the character's code, returns 1 if arg isn't a number
+static int parse_number(const char* arg, int conversion, long long* integer, unsigned long long* uinteger, double* real)
+{
+	char* end = NULL;
+
+	*integer = 0;
+	*uinteger = 0;
+	*real = 0;
+
+	if (!*arg)
+	{
+		return 0;
+	}
+
+	if (*arg == '\'' || *arg == '"')
+	{
+		*integer = (unsigned char)arg[1];
+		*uinteger = (unsigned long long)*integer;
+		*real = (double)*integer;
+		return 0;
+	}
+
+	errno = 0;
+
+	if (strchr("eEfFgGaA", conversion))
+	{
+		*real = strtod(arg, &end);
+	}
+	else if (*arg == '-' || strchr("di", conversion))
+	{
+		*integer = strtoll(arg, &end, 0);
+		*uinteger = (unsigned long long)*integer;
+	}
+	else
+	{
+		*uinteger = strtoull(arg, &end, 0);
+	}
+
+	if (*end || errno == ERANGE)
+	{
+		fprintf(stderr, "printf: %s: invalid number\n", arg);
+		return 1;
+	}
+
+	return 0;
+}
+
+int print_format(struct Output* output, struct Format* format, char** args)
+{
+	int rc = 0;
+
+	do
+	{
+		for (size_t i = 0; i < format->size; i++)
+		{
+			struct FormatSpec* spec = format->specs + i;
+			const char* arg = "";
+
+			output_reference(output, spec->text, spec->text_size);
+
+			if (!spec->conversion)
+			{
+				continue;
+			}
+
+			if (spec->conversion == FORMAT_STOP)
+			{
+				return rc;
+			}
+
+			if (*args)
+			{
+				arg = *args++;
+			}
+
+			switch (spec->conversion)
+			{
+				case 's':
+				{
+					spec->directive[0] ? print_directive(output, spec->directive, arg) : output_reference(output, arg, strlen(arg));
+				} break;
+				case 'b':
+				{
+					if (!spec->directive[0])
+					{
+						if (print_escaped(output, arg))
+						{
+							return rc;
+						}
+
+						break;
+					}
+
+					size_t size;
+					char* text = malloc(strlen(arg) + 1);
+					int stop = unescape(arg, text, &size, 1);
+
+					text[size] = '\0';
+					print_directive(output, spec->directive, text);
+					free(text);
+
+					if (stop)
+					{
+						return rc;
+					}
+				} break;
+				case 'c':
+				{
+					if (*arg) // an empty argument gives no character
+					{
+						print_directive(output, spec->directive, *arg);
+					}
+				} break;
+				default:
+				{
+					long long integer;
+					unsigned long long uinteger;
+					double real;
+
+					rc |= parse_number(arg, spec->conversion, &integer, &uinteger, &real);
+
+					if (strchr("di", spec->conversion))
+					{
+						print_directive(output, spec->directive, integer);
+					}
+					else if (strchr("ouxX", spec->conversion))
+					{
+						print_directive(output, spec->directive, uinteger);
+					}
+					else
+					{
+						print_directive(output, spec->directive, real);
+					}
+				} break;
+			}
+		}
+	} while (format->conversions && *args);
+
+	return rc;
+}
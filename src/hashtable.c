@@ -1,8 +1,12 @@
 #include "hashtable.h"
 #include "utility.h"
 #include <string.h>
+#include <stddef.h>
+#include <sys/mman.h>
 
-static size_t hashf(struct Hashtable* hashtable, const char* key)
+#define MIN_HASHTABLE_CAPACITY 8
+
+static size_t hashf(const char* key)
 {
 	size_t hash = 1315423911;
 
@@ -12,53 +16,105 @@ static size_t hashf(struct Hashtable* hashtable, const char* key)
 		key++;
 	}
 
-	return (hash % hashtable->capacity);
+	// the index is taken from the low bits, mix the high ones into them
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+static size_t round_capacity(size_t capacity)
+{
+	size_t result = MIN_HASHTABLE_CAPACITY;
+
+	while (result < capacity)
+	{
+		result <<= 1;
+	}
+
+	return result;
 }
 
 struct Hashtable* create_hashtable(size_t capacity)
 {
 	struct Hashtable* hashtable = calloc(1, sizeof(struct Hashtable));
 
-	hashtable->table = calloc(capacity, sizeof(struct Bucket*));
-	hashtable->capacity = capacity;
+	hashtable->capacity = round_capacity(capacity);
+	hashtable->table = calloc(hashtable->capacity, sizeof(struct Entry));
 
 	return hashtable;
 }
 
-static void free_entry(void* entry)
+// returns 1 if entries that were already in the table have been moved
+static int place(struct Entry* table, size_t capacity, struct Entry entry)
 {
-	struct Entry* e = (struct Entry*)entry;
-	free(e->key);
-	free(e->value);
-	free(e);
+	size_t mask = capacity - 1;
+	int moved = 0;
+
+	entry.distance = 0;
+
+	for (size_t i = entry.hash & mask; ; i = (i + 1) & mask, entry.distance++)
+	{
+		if (!table[i].key)
+		{
+			table[i] = entry;
+			return moved;
+		}
+
+		if (table[i].distance < entry.distance)
+		{
+			struct Entry temp = table[i];
+			table[i] = entry;
+			entry = temp;
+			moved = 1;
+		}
+	}
 }
 
-static struct Entry* _get(struct Hashtable* hashtable, const char* key, size_t indx)
+static void grow(struct Hashtable* hashtable)
 {
-	if (!hashtable->table[indx])
+	struct Entry* old_table = hashtable->table;
+	size_t old_capacity = hashtable->capacity;
+
+	hashtable->capacity <<= 1;
+	hashtable->table = calloc(hashtable->capacity, sizeof(struct Entry));
+	hashtable->generation++;
+
+	for (size_t i = 0; i < old_capacity; i++)
 	{
-		return NULL;
+		if (old_table[i].key)
+		{
+			place(hashtable->table, hashtable->capacity, old_table[i]);
+		}
 	}
 
-	struct Entry* entry = NULL;
-	struct Node* node = hashtable->table[indx]->entries->head;
+	free(old_table);
+}
+
+static struct Entry* _get(struct Hashtable* hashtable, const char* key, size_t hash)
+{
+	size_t mask = hashtable->capacity - 1;
 
-	for (; node; node = node->next)
+	for (size_t i = hash & mask, distance = 0; ; i = (i + 1) & mask, distance++)
 	{
-		entry = (struct Entry*)(node->data);
+		struct Entry* entry = hashtable->table + i;
 
-		if (!strcmp(entry->key, key))
+		if (!entry->key || entry->distance < distance)
 		{
-			break;
+			return NULL;
 		}
-	}
 
-	return node ? entry : NULL;
+		if (entry->hash == hash && !strcmp(entry->key, key))
+		{
+			return entry;
+		}
+	}
 }
 
 char** get(struct Hashtable* hashtable, const char* key)
 {
-	struct Entry* entry = _get(hashtable, key, hashf(hashtable, key));
+	struct Entry* entry = _get(hashtable, key, hashf(key));
 
 	if (entry)
 	{
@@ -68,35 +124,50 @@ char** get(struct Hashtable* hashtable, const char* key)
 	return NULL;
 }
 
-void insert(struct Hashtable* hashtable, const char* key, const char* value)
+char** cached_get(struct Hashtable* hashtable, const char* key, struct LookupCache* cache)
 {
-	size_t indx = hashf(hashtable, key);
-
-	if (_get(hashtable, key, indx))
+	if (cache->value && cache->generation == hashtable->generation)
 	{
-		return;
+		return cache->value;
 	}
 
-	struct Entry* entry = malloc(sizeof(struct Entry)); 
-	entry->key = copy_string(key);
-	entry->value = copy_string(value);
+	char** value = get(hashtable, key);
 
-	if (!hashtable->table[indx])
+	if (value)
 	{
-		hashtable->table[indx] = calloc(1, sizeof(struct Bucket));
-		hashtable->table[indx]->entries = create_list(free_entry);
-		hashtable->size++;
+		cache->value = value;
+		cache->generation = hashtable->generation;
 	}
 
-	push_back(hashtable->table[indx]->entries, entry);
-	hashtable->table[indx]->size++;
+	return value;
 }
 
-static void destroy_bucket(struct Bucket** bucket)
+void insert(struct Hashtable* hashtable, const char* key, const char* value)
 {
-	destroy_list(&(*bucket)->entries);
-	free(*bucket);
-	*bucket = NULL;
+	size_t hash = hashf(key);
+
+	if (_get(hashtable, key, hash))
+	{
+		return;
+	}
+
+	if ((hashtable->size + 1) * 4 > hashtable->capacity * 3) // load factor is kept below 0.75
+	{
+		grow(hashtable);
+	}
+
+	struct Entry entry;
+	entry.key = copy_string(key);
+	entry.value = copy_string(value);
+	entry.array = NULL;
+	entry.hash = hash;
+
+	if (place(hashtable->table, hashtable->capacity, entry))
+	{
+		hashtable->generation++;
+	}
+
+	hashtable->size++;
 }
 
 void destroy_hashtable(struct Hashtable** hashtable)
@@ -105,15 +176,17 @@ void destroy_hashtable(struct Hashtable** hashtable)
 	{
 		struct Hashtable* h = *hashtable;
 
-		for (size_t i = 0, count = 0; i < h->capacity && count < h->size; i++)
+		for (size_t i = 0; i < h->capacity; i++)
 		{
-			if (h->table[i])
+			if (h->table[i].key)
 			{
-				count++;
-				destroy_bucket(&h->table[i]);
+				free(h->table[i].key);
+				free(h->table[i].value);
+				destroy_array(h->table[i].array);
 			}
 		}
 
+		free(h->table);
 		free(*hashtable);
 		*hashtable = NULL;
 	}
@@ -121,19 +194,88 @@ void destroy_hashtable(struct Hashtable** hashtable)
 
 void erase(struct Hashtable* hashtable, const char* key)
 {
-	size_t indx = hashf(hashtable, key);
-	struct Entry* entry = _get(hashtable, key, indx);
+	struct Entry* entry = _get(hashtable, key, hashf(key));
 
 	if (entry)
 	{
-		if (!(--hashtable->table[indx]->size))
+		size_t mask = hashtable->capacity - 1;
+		size_t i = (size_t)(entry - hashtable->table);
+
+		free(entry->key);
+		free(entry->value);
+		destroy_array(entry->array);
+
+		// shift the following entries of the cluster one slot back instead of leaving a tombstone
+		for (size_t next = (i + 1) & mask; hashtable->table[next].key && hashtable->table[next].distance; next = (next + 1) & mask)
 		{
-			hashtable->size--;
-			destroy_bucket(&hashtable->table[indx]);
+			hashtable->table[i] = hashtable->table[next];
+			hashtable->table[i].distance--;
+			i = next;
+		}
+
+		hashtable->table[i].key = NULL;
+		hashtable->table[i].value = NULL;
+		hashtable->table[i].array = NULL;
+		hashtable->size--;
+		hashtable->generation++;
+	}
+}
+
+void insert_array(struct Hashtable* hashtable, const char* key, struct Array* array)
+{
+	const char* first = array->size ? array->items[0] : "";
+	struct Entry* entry = _get(hashtable, key, hashf(key));
+
+	if (!entry)
+	{
+		insert(hashtable, key, first);
+		entry = _get(hashtable, key, hashf(key));
+	}
+	else
+	{
+		free(entry->value);
+		entry->value = copy_string(first);
+		destroy_array(entry->array);
+	}
+
+	if (array->size)
+	{
+		array->items[0] = entry->value;
+	}
+
+	entry->array = array;
+}
+
+struct Array* value_array(char** value)
+{
+	return ((struct Entry*)((char*)value - offsetof(struct Entry, value)))->array;
+}
+
+void destroy_array(struct Array* array)
+{
+	if (array)
+	{
+		if (array->mapped)
+		{
+			munmap(array->storage, array->storage_size);
 		}
 		else
 		{
-			remove_node(hashtable->table[indx]->entries, entry);
+			free(array->storage);
+		}
+
+		free(array->items);
+		free(array);
+	}
+}
+
+void traverse(struct Hashtable* hashtable, void (*visit)(const char* key, const char* value, void* arg), void* arg)
+{
+	for (size_t i = 0; i < hashtable->capacity; i++)
+	{
+		if (hashtable->table[i].key)
+		{
+			visit(hashtable->table[i].key, hashtable->table[i].value, arg);
 		}
 	}
 }
\ No newline at end of file
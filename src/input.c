@@ -0,0 +1,314 @@
+#include "input.h"
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#define LINES_CAP 1024
+#define LOAD_BLOCK_SIZE (1 << 20)
+
+static enum InputMode get_mode(struct Input* input, int fd)
+{
+	struct stat sb;
+
+	if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && lseek(fd, 0, SEEK_CUR) != -1)
+	{
+		return INPUT_SEEKABLE; // preferred even when owned, commands of the loop's body see the rest of the input
+	}
+
+	if (input->owned)
+	{
+		return INPUT_OWNED;
+	}
+
+	return INPUT_UNBUFFERED; // bytes read past the record couldn't be returned to other readers
+}
+
+// moves unread data to the beginning of the buffer and reads more, returns the number of bytes read
+static ssize_t fill(struct Input* input, int fd)
+{
+	if (input->start)
+	{
+		memmove(input->buffer, input->buffer + input->start, input->end - input->start);
+		input->end -= input->start;
+		input->start = 0;
+	}
+
+	if (input->end == input->capacity) // a record longer than the buffer
+	{
+		input->capacity = input->capacity ? input->capacity << 1 : INPUT_BLOCK_SIZE;
+		input->buffer = realloc(input->buffer, input->capacity + 1); // + '\0' after the last record
+	}
+
+	size_t size = input->mode == INPUT_UNBUFFERED ? 1 : input->capacity - input->end;
+	ssize_t count;
+
+	while ((count = read(fd, input->buffer + input->end, size)) == -1 && errno == EINTR)
+	{
+	}
+
+	if (count > 0)
+	{
+		input->end += (size_t)count;
+	}
+
+	return count;
+}
+
+// the delimiter at found is escaped if it's preceded by an odd number of backslashes
+static int is_escaped(const char* start, const char* found)
+{
+	const char* p = found;
+
+	while (p > start && p[-1] == '\\')
+	{
+		p--;
+	}
+
+	return (found - p) & 1;
+}
+
+int read_record(struct Input* input, int fd, char delim, int raw, char** record, size_t* size)
+{
+	if (input->mode == INPUT_UNKNOWN)
+	{
+		input->mode = get_mode(input, fd);
+	}
+
+	size_t scan = 0; // the part of the record before scan has no delimiter
+
+	while (1)
+	{
+		char* begin = input->buffer + input->start;
+		char* found = input->end > input->start ? memchr(begin + scan, delim, input->end - input->start - scan) : NULL;
+
+		while (found && !raw && is_escaped(begin, found))
+		{
+			found = memchr(found + 1, delim, (size_t)(input->buffer + input->end - found - 1));
+		}
+
+		if (found)
+		{
+			*found = '\0';
+			*record = begin;
+			*size = (size_t)(found - begin);
+			input->start += *size + 1;
+			return 1;
+		}
+
+		scan = input->end - input->start;
+
+		ssize_t count = fill(input, fd);
+
+		if (count <= 0)
+		{
+			input->buffer[input->end] = '\0'; // fill() allocated the buffer
+			*record = input->buffer + input->start;
+			*size = input->end - input->start;
+			input->start = input->end;
+
+			return count == 0 ? 0 : -1;
+		}
+	}
+}
+
+void release_input(struct Input* input, int fd)
+{
+	if (input->mode == INPUT_SEEKABLE && input->end > input->start)
+	{
+		lseek(fd, -(off_t)(input->end - input->start), SEEK_CUR);
+	}
+
+	drop_input(input);
+}
+
+void drop_input(struct Input* input)
+{
+	input->start = 0;
+	input->end = 0;
+	input->mode = INPUT_UNKNOWN;
+}
+
+// the rest of a regular file is mapped privately, the reserved byte after it is '\0'
+static char* map_rest(int fd, size_t* size, struct Array* array)
+{
+	struct stat sb;
+	off_t offset = lseek(fd, 0, SEEK_CUR);
+
+	if (offset == -1 || fstat(fd, &sb) == -1 || !S_ISREG(sb.st_mode) || sb.st_size <= offset)
+	{
+		return NULL;
+	}
+
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t file_size = (size_t)sb.st_size;
+	size_t reserved = (file_size + 1 + page - 1) & ~(page - 1);
+
+	// the file is mapped over an anonymous mapping, so the byte after its end exists even if the size is a multiple of the page size
+	char* base = mmap(NULL, reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (base == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	if (mmap(base, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+	{
+		munmap(base, reserved);
+		return NULL;
+	}
+
+	madvise(base, file_size, MADV_SEQUENTIAL);
+	lseek(fd, 0, SEEK_END); // the input is consumed
+
+	array->storage = base;
+	array->storage_size = reserved;
+	array->mapped = 1;
+	*size = file_size - (size_t)offset;
+
+	return base + offset;
+}
+
+// the read-ahead data followed by the rest of the input, terminated with '\0'
+static char* read_rest(struct Input* input, int fd, size_t* size, struct Array* array)
+{
+	size_t capacity = LOAD_BLOCK_SIZE;
+	size_t length = input->end - input->start;
+
+	while (capacity <= length)
+	{
+		capacity <<= 1;
+	}
+
+	char* buffer = malloc(capacity);
+	memcpy(buffer, input->buffer + input->start, length);
+	drop_input(input);
+
+	while (1)
+	{
+		if (length + 1 == capacity)
+		{
+			capacity <<= 1;
+			buffer = realloc(buffer, capacity);
+		}
+
+		ssize_t count = read(fd, buffer + length, capacity - length - 1);
+
+		if (count == -1 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (count == -1)
+		{
+			free(buffer);
+			return NULL;
+		}
+
+		if (count == 0)
+		{
+			break;
+		}
+
+		length += (size_t)count;
+	}
+
+	buffer[length] = '\0';
+
+	array->storage = buffer;
+	array->storage_size = capacity;
+	*size = length;
+
+	return buffer;
+}
+
+static void add_line(struct Array* array, size_t* capacity, char* line)
+{
+	if (array->size == *capacity)
+	{
+		*capacity = *capacity ? *capacity << 1 : LINES_CAP;
+		array->items = realloc(array->items, *capacity * sizeof(char*));
+	}
+
+	array->items[array->size++] = line;
+}
+
+int load_lines(struct Input* input, int fd, int strip, struct Array* array)
+{
+	size_t size = 0;
+	size_t capacity = 0;
+	char* data = NULL;
+
+	if (input->mode == INPUT_SEEKABLE || input->end == input->start)
+	{
+		release_input(input, fd);
+		data = map_rest(fd, &size, array);
+	}
+
+	if (!data && !(data = read_rest(input, fd, &size, array)))
+	{
+		return -1;
+	}
+
+	char* end = data + size; // *end == '\0'
+
+	if (strip)
+	{
+		for (char* line = data; line < end; )
+		{
+			char* newline = memchr(line, '\n', (size_t)(end - line));
+			newline = newline ? newline : end;
+			*newline = '\0';
+
+			add_line(array, &capacity, line);
+			line = newline + 1;
+		}
+
+		return 0;
+	}
+
+	size_t lines = 0;
+
+	for (char* p = data; p < end && (p = memchr(p, '\n', (size_t)(end - p))); p++)
+	{
+		lines++;
+	}
+
+	char* storage = malloc(size + lines + 2); // each line gets '\0', the last one may have no newline
+	char* out = storage;
+
+	for (char* line = data; line < end; )
+	{
+		char* newline = memchr(line, '\n', (size_t)(end - line));
+		size_t length = newline ? (size_t)(newline - line) + 1 : (size_t)(end - line);
+
+		memcpy(out, line, length);
+		out[length] = '\0';
+
+		add_line(array, &capacity, out);
+		out += length + 1;
+		line += length;
+	}
+
+	if (array->mapped)
+	{
+		munmap(array->storage, array->storage_size);
+	}
+	else
+	{
+		free(array->storage);
+	}
+
+	array->storage = storage;
+	array->storage_size = size + lines + 2;
+	array->mapped = 0;
+
+	return 0;
+}
+
+void free_input(struct Input* input)
+{
+	free(input->buffer);
+	memset(input, 0, sizeof(struct Input));
+}
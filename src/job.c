@@ -1,26 +1,17 @@
 #include "job.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <unistd.h>
+#include <poll.h>
 #include <sys/wait.h>
+#ifdef __linux__
+#include <sys/signalfd.h>
+#endif
 
-struct Job* find_job(Jobs* jobs, pid_t pgid)
-{
-	if (jobs)
-	{
-		for (struct Node* node = jobs->head; node; node = node->next)
-		{
-			struct Job* job = (struct Job*)node->data;
-
-			if (job->pgid == pgid)
-			{
-				return job;
-			} 
-		}
-	}
-
-	return NULL;	
-}
+#define PROCESS_INDEX_CAP 64
+#define JOB_TABLE_CAP 16
+#define SAVED_STATUSES_CAP 1024 // like CHILD_MAX, the number of exit statuses of freed background jobs wait can still return
 
 int is_job_stopped(struct Job* job)
 {
@@ -30,7 +21,7 @@ int is_job_stopped(struct Job* job)
 		{
 			struct Process* process = (struct Process*)node->data;
 
-			if (!process->stopped && !process->stopped)
+			if (!process->completed && !process->stopped)
 			{
 				return 0;
 			}
@@ -78,110 +69,573 @@ void destroy_process(void* process)
 	}
 }
 
-static int mark_process_status(Jobs* jobs, pid_t pid, int status)
+static size_t slot_of(struct ProcessIndex* index, pid_t pid)
+{
+	return ((size_t)pid * 0x9E3779B97F4A7C15ULL >> 32) & (index->capacity - 1);
+}
+
+static void index_insert(struct ProcessIndex* index, struct Process* process, struct Job* job);
+
+static void grow_index(struct ProcessIndex* index)
+{
+	struct ProcessSlot* slots = index->slots;
+	size_t capacity = index->capacity;
+
+	index->capacity = capacity ? capacity << 1 : PROCESS_INDEX_CAP;
+	index->slots = calloc(index->capacity, sizeof(struct ProcessSlot));
+	index->size = 0;
+
+	for (size_t i = 0; i < capacity; i++)
+	{
+		if (slots[i].pid)
+		{
+			index_insert(index, slots[i].process, slots[i].job);
+		}
+	}
+
+	free(slots);
+}
+
+static void index_insert(struct ProcessIndex* index, struct Process* process, struct Job* job)
 {
-	if (!pid)
+	if ((index->size + 1) * 2 > index->capacity) // load factor stays below 0.5
 	{
-		return -1;
+		grow_index(index);
 	}
 
-	for (struct Node* node = jobs->head; node; node = node->next)
+	size_t i = slot_of(index, process->pid);
+
+	while (index->slots[i].pid)
 	{
-		struct Job* job = (struct Job*)node->data;
+		i = (i + 1) & (index->capacity - 1);
+	}
 
-		for (struct Node* n = job->processes->head; n; n = n->next)
-		{
-			struct Process* process = (struct Process*)n->data;
+	index->slots[i].pid = process->pid;
+	index->slots[i].process = process;
+	index->slots[i].job = job;
+	index->size++;
+}
 
-			if (process->pid == pid)
+static size_t index_find(struct ProcessIndex* index, pid_t pid)
+{
+	if (index->size)
+	{
+		for (size_t i = slot_of(index, pid); index->slots[i].pid; i = (i + 1) & (index->capacity - 1))
+		{
+			if (index->slots[i].pid == pid)
 			{
-				process->status = status;
-
-				if (WIFSTOPPED(status))
-				{
-					process->stopped = 1;
-				}
-				else
-				{
-					process->completed = 1;
-
-					if (WIFSIGNALED(status)) 
-					{
-						fprintf(stderr, "%d: Terminated by signal %d\n", (int)pid, WTERMSIG(process->status));
-						process->rc = 129;
-					}
-					else
-					{
-						process->rc = WEXITSTATUS(status);
-					}
-				}
-
-				return 0;
+				return i;
 			}
 		}
 	}
 
-	return -1;
+	return index->capacity;
 }
 
-void wait_for_job(Jobs* jobs, struct Job* job)
+// backward shift deletion, no tombstones are left
+static void index_erase(struct ProcessIndex* index, pid_t pid)
 {
-	pid_t pid;
-	int status;
+	size_t i = index_find(index, pid);
+	if (i == index->capacity)
+	{
+		return;
+	}
+
+	size_t mask = index->capacity - 1;
 
-	do
+	for (size_t j = (i + 1) & mask; index->slots[j].pid; j = (j + 1) & mask)
 	{
-		pid = waitpid(-1, &status, WUNTRACED);
-	} while (!mark_process_status(jobs, pid, status) && !is_job_completed(job) && !is_job_stopped(job));
+		size_t home = slot_of(index, index->slots[j].pid);
+
+		if (((j - home) & mask) >= ((j - i) & mask)) // the entry at j may move to i
+		{
+			index->slots[i] = index->slots[j];
+			i = j;
+		}
+	}
+
+	index->slots[i].pid = 0;
+	index->slots[i].process = NULL;
+	index->slots[i].job = NULL;
+	index->size--;
 }
 
-static void format_job_info(struct Job* job, const char* status)
+struct JobControl* create_job_control()
+{
+	struct JobControl* job_control = calloc(1, sizeof(struct JobControl));
+	job_control->sigchld_fd = -1;
+
+#ifdef __linux__
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+
+	int fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (fd != -1)
+	{
+		sigprocmask(SIG_BLOCK, &mask, NULL);
+		job_control->sigchld_fd = fd;
+	}
+#endif
+
+	return job_control;
+}
+
+void destroy_job_control(struct JobControl** job_control)
+{
+	if (*job_control)
+	{
+		if ((*job_control)->sigchld_fd != -1)
+		{
+			close((*job_control)->sigchld_fd);
+		}
+
+		struct JobTable* jobs = &(*job_control)->jobs;
+
+		for (size_t i = 0; i < jobs->size; i++)
+		{
+			destroy_job(jobs->slots[i]);
+		}
+
+		free(jobs->slots);
+		free(jobs->free_ids);
+		free((*job_control)->index.slots);
+		free((*job_control)->changed);
+		free((*job_control)->saved);
+		free(*job_control);
+		*job_control = NULL;
+	}
+}
+
+void child_sigmask(sigset_t* mask)
+{
+	sigprocmask(SIG_BLOCK, NULL, mask);
+	sigdelset(mask, SIGCHLD);
+}
+
+static size_t new_job_id(struct JobTable* jobs)
+{
+	if (jobs->free_count)
+	{
+		return jobs->free_ids[--jobs->free_count];
+	}
+
+	if (jobs->size == jobs->capacity)
+	{
+		jobs->capacity = jobs->capacity ? jobs->capacity << 1 : JOB_TABLE_CAP;
+		jobs->slots = realloc(jobs->slots, jobs->capacity * sizeof(struct Job*));
+		jobs->free_ids = realloc(jobs->free_ids, jobs->capacity * sizeof(size_t));
+	}
+
+	jobs->slots[jobs->size] = NULL;
+
+	return ++jobs->size;
+}
+
+static void queue_changed_job(struct JobControl* job_control, struct Job* job)
+{
+	if (job->changed || !job->id) // add_job() checks the job again
+	{
+		return;
+	}
+
+	if (job_control->changed_count == job_control->changed_capacity)
+	{
+		job_control->changed_capacity = job_control->changed_capacity ? job_control->changed_capacity << 1 : JOB_TABLE_CAP;
+		job_control->changed = realloc(job_control->changed, job_control->changed_capacity * sizeof(size_t));
+	}
+
+	job_control->changed[job_control->changed_count++] = job->id;
+	job->changed = 1;
+}
+
+void add_job(struct JobControl* job_control, struct Job* job)
+{
+	struct JobTable* jobs = &job_control->jobs;
+
+	job->id = new_job_id(jobs);
+	jobs->slots[job->id - 1] = job;
+	jobs->count++;
+
+	jobs->previous = jobs->current;
+	jobs->current = job->id;
+
+	for (struct Node* node = job->processes->head; node; node = node->next)
+	{
+		struct Process* process = (struct Process*)node->data;
+
+		if (process->completed || process->stopped) // changed before the job got its number, builtins are always completed
+		{
+			queue_changed_job(job_control, job);
+			break;
+		}
+	}
+}
+
+void add_process(struct JobControl* job_control, struct Job* job, struct Process* process)
 {
-	fprintf (stderr, "%ld: %s\n", (long)job->pgid, status);
+	push_back(job->processes, process);
+
+	if (process->pid > 0 && !process->completed)
+	{
+		index_insert(&job_control->index, process, job);
+	}
 }
 
-static void update_status(Jobs* jobs)
+void remove_job(struct JobControl* job_control, struct Job* job)
 {
+	struct JobTable* jobs = &job_control->jobs;
+
+	for (struct Node* node = job->processes->head; node; node = node->next)
+	{
+		struct Process* process = (struct Process*)node->data;
+
+		if (process->pid > 0 && !process->completed)
+		{
+			index_erase(&job_control->index, process->pid);
+		}
+	}
+
+	if (!job->id) // wasn't added
+	{
+		destroy_job(job);
+		return;
+	}
+
+	jobs->slots[job->id - 1] = NULL;
+	jobs->count--;
+
+	if (!jobs->count) // numbering starts again from 1
+	{
+		jobs->size = 0;
+		jobs->free_count = 0;
+		jobs->current = 0;
+		jobs->previous = 0;
+	}
+	else
+	{
+		jobs->free_ids[jobs->free_count++] = job->id;
+	}
+
+	if (jobs->current == job->id)
+	{
+		jobs->current = jobs->previous;
+		jobs->previous = 0;
+	}
+	else if (jobs->previous == job->id)
+	{
+		jobs->previous = 0;
+	}
+
+	destroy_job(job);
+}
+
+struct Job* find_job(struct JobControl* job_control, size_t id)
+{
+	return id && id <= job_control->jobs.size ? job_control->jobs.slots[id - 1] : NULL;
+}
+
+// the newest job other than skip, the table is scanned only after %+ or %- was removed
+static size_t newest_job_id(struct JobTable* jobs, size_t skip)
+{
+	for (size_t id = jobs->size; id; id--)
+	{
+		if (jobs->slots[id - 1] && id != skip)
+		{
+			return id;
+		}
+	}
+
+	return 0;
+}
+
+struct Job* current_job(struct JobControl* job_control, int previous)
+{
+	struct JobTable* jobs = &job_control->jobs;
+
+	if (!jobs->current || !find_job(job_control, jobs->current))
+	{
+		jobs->current = newest_job_id(jobs, 0);
+	}
+
+	if (previous && (!jobs->previous || !find_job(job_control, jobs->previous)))
+	{
+		jobs->previous = newest_job_id(jobs, jobs->current);
+	}
+
+	return find_job(job_control, previous ? jobs->previous : jobs->current);
+}
+
+static void mark_process_status(struct JobControl* job_control, pid_t pid, int status)
+{
+	size_t i = index_find(&job_control->index, pid);
+	if (i == job_control->index.capacity)
+	{
+		return; // isn't a job's process
+	}
+
+	struct Process* process = job_control->index.slots[i].process;
+	queue_changed_job(job_control, job_control->index.slots[i].job);
+	process->status = status;
+
+	if (WIFSTOPPED(status))
+	{
+		process->stopped = 1;
+	}
+	else if (WIFCONTINUED(status))
+	{
+		process->stopped = 0;
+	}
+	else
+	{
+		process->completed = 1;
+		index_erase(&job_control->index, pid);
+
+		if (WIFSIGNALED(status)) 
+		{
+			if (WTERMSIG(status) != SIGPIPE) // a writer whose reader exited early, like head in yes | head -1
+			{
+				fprintf(stderr, "%d: Terminated by signal %d\n", (int)pid, WTERMSIG(process->status));
+			}
+
+			process->rc = 129;
+		}
+		else
+		{
+			process->rc = WEXITSTATUS(status);
+		}
+	}
+}
+
+size_t reap_children(struct JobControl* job_control)
+{
+	if (!job_control->index.size)
+	{
+		return 0; // no child is running, loops of builtins make no system calls here
+	}
+
+#ifdef __linux__
+	if (job_control->sigchld_fd != -1)
+	{
+		struct signalfd_siginfo info[16];
+
+		if (read(job_control->sigchld_fd, info, sizeof(info)) <= 0)
+		{
+			return 0; // no SIGCHLD since the last call, so there is nothing to reap
+		}
+
+		while (read(job_control->sigchld_fd, info, sizeof(info)) > 0) // pending SIGCHLDs are merged, the waitpid() loop below reaps every child
+		{
+		}
+	}
+#endif
+
+	size_t count = 0;
 	int status;
 	pid_t pid;
 
-	do
+	while ((pid = waitpid(-1, &status, WUNTRACED | WCONTINUED | WNOHANG)) > 0)
 	{
-		pid = waitpid(-1, &status, WUNTRACED | WNOHANG);
-	} while (!mark_process_status(jobs, pid, status));
+		mark_process_status(job_control, pid, status);
+		count++;
+	}
+
+	return count;
 }
 
-void do_job_notification(Jobs* jobs)
+int wait_for_children(struct JobControl* job_control)
 {
-	update_status(jobs);
+	if (reap_children(job_control))
+	{
+		return 1;
+	}
 
-	for (struct Node* node = jobs->head; node; node = node->next)
+	if (job_control->sigchld_fd != -1)
 	{
-		struct Job* job = (struct Job*)node->data;
+		struct pollfd pfd = { job_control->sigchld_fd, POLLIN, 0 };
+		poll(&pfd, 1, -1); // SIGCHLD that came after the last read makes the descriptor readable
+		return 1;
+	}
 
-		if (is_job_completed(job))
+	int status;
+	pid_t pid = waitpid(-1, &status, WUNTRACED);
+
+	if (pid > 0)
+	{
+		mark_process_status(job_control, pid, status);
+	}
+
+	return pid > 0 || errno == EINTR; // ECHILD - no children left
+}
+
+void wait_for_job(struct JobControl* job_control, struct Job* job)
+{
+	while (!is_job_completed(job) && !is_job_stopped(job))
+	{
+		if (!wait_for_children(job_control))
 		{
-			struct Node** prev = node == jobs->head ? &jobs->head : &node->prev;
+			break;
+		}
+	}
+}
 
-			format_job_info(job, "completed");
-			remove_node(jobs, node->data);
+int process_status(struct Process* process)
+{
+	return process->stopped && !process->completed ? 128 + WSTOPSIG(process->status) : process->rc;
+}
+
+struct Job* find_process(struct JobControl* job_control, pid_t pid, struct Process** process)
+{
+	size_t i = index_find(&job_control->index, pid);
 
-			node = *prev;
+	if (i != job_control->index.capacity)
+	{
+		*process = job_control->index.slots[i].process;
+		return job_control->index.slots[i].job;
+	}
+
+	for (size_t id = 1; id <= job_control->jobs.size; id++) // completed processes of the jobs that weren't freed yet
+	{
+		struct Job* job = job_control->jobs.slots[id - 1];
+
+		for (struct Node* node = job ? job->processes->head : NULL; node; node = node->next)
+		{
+			if (((struct Process*)node->data)->pid == pid)
+			{
+				*process = (struct Process*)node->data;
+				return job;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static void save_status(struct JobControl* job_control, struct Job* job)
+{
+	struct Process* process = (struct Process*)job->processes->tail->data;
+
+	if (process->pid <= 0)
+	{
+		return; // a builtin
+	}
+
+	if (!job_control->saved)
+	{
+		job_control->saved = malloc(SAVED_STATUSES_CAP * sizeof(struct SavedStatus));
+	}
+
+	if (job_control->saved_count == SAVED_STATUSES_CAP) // the oldest status is forgotten
+	{
+		job_control->saved_first = (job_control->saved_first + 1) % SAVED_STATUSES_CAP;
+		job_control->saved_count--;
+	}
+
+	struct SavedStatus* saved = job_control->saved + (job_control->saved_first + job_control->saved_count++) % SAVED_STATUSES_CAP;
+	saved->pid = process->pid;
+	saved->id = job->id;
+	saved->rc = process->rc;
+}
+
+static void drop_taken_statuses(struct JobControl* job_control)
+{
+	while (job_control->saved_count && !job_control->saved[job_control->saved_first].pid) // taken statuses at the beginning are dropped
+	{
+		job_control->saved_first = (job_control->saved_first + 1) % SAVED_STATUSES_CAP;
+		job_control->saved_count--;
+	}
+}
+
+int take_saved_status(struct JobControl* job_control, pid_t pid, int* rc)
+{
+	int found = 0;
+
+	for (size_t i = 0; i < job_control->saved_count && !found; i++)
+	{
+		struct SavedStatus* saved = job_control->saved + (job_control->saved_first + i) % SAVED_STATUSES_CAP;
+
+		if (saved->pid && (!pid || saved->pid == pid))
+		{
+			*rc = saved->rc;
+			saved->pid = 0;
+			found = 1;
+		}
+	}
+
+	drop_taken_statuses(job_control);
+
+	return found;
+}
+
+int take_saved_job_status(struct JobControl* job_control, size_t id, int* rc)
+{
+	int found = 0;
+
+	for (size_t i = job_control->saved_count; i > 0 && !found; i--) // numbers are reused, the newest status is the job's
+	{
+		struct SavedStatus* saved = job_control->saved + (job_control->saved_first + i - 1) % SAVED_STATUSES_CAP;
+
+		if (saved->pid && saved->id == id)
+		{
+			*rc = saved->rc;
+			saved->pid = 0;
+			found = 1;
+		}
+	}
+
+	drop_taken_statuses(job_control);
+
+	return found;
+}
+
+void forget_saved_statuses(struct JobControl* job_control)
+{
+	job_control->saved_first = 0;
+	job_control->saved_count = 0;
+}
+
+static void format_job_info(struct Job* job, const char* status)
+{
+	fprintf (stderr, "[%zu] %ld: %s\n", job->id, (long)job->pgid, status);
+}
+
+// only the jobs queued by mark_process_status() are checked, not the whole table
+void do_job_notification(struct JobControl* job_control)
+{
+	reap_children(job_control);
+
+	for (size_t i = 0; i < job_control->changed_count; i++)
+	{
+		struct Job* job = find_job(job_control, job_control->changed[i]);
+
+		if (!job || !job->changed) // removed, its number may already belong to another job
+		{
+			continue;
+		}
+
+		job->changed = 0;
+
+		if (is_job_completed(job))
+		{
+			if (job_control->notify)
+			{
+				format_job_info(job, "completed");
+			}
+
+			save_status(job_control, job);
+			remove_job(job_control, job);
 		}
 		else
 		{
-			if (!job->notified && is_job_stopped(job))
+			if (job_control->notify && !job->notified && is_job_stopped(job))
 			{
 				format_job_info(job, "stopped");
 				job->notified = 1;
 			}
 		}
-
-		if (!node)
-		{
-			break;
-		}
 	}
+
+	job_control->changed_count = 0;
 }
 
 void mark_job_as_running(struct Job* job)
@@ -195,33 +649,44 @@ void mark_job_as_running(struct Job* job)
 	job->notified = 0;
 }
 
-void continue_job(pid_t init_pgid, Jobs* jobs, struct Job* job, int foreground)
+int continue_job(pid_t init_pgid, struct JobControl* job_control, struct Job* job, int foreground)
 {
 	mark_job_as_running(job);
 
 	if (foreground)
 	{
-		put_job_in_foreground(init_pgid, jobs, job);
-	}
-	else
-	{
-		put_job_in_background(job);
+		return put_job_in_foreground(init_pgid, job_control, job);
 	}
+
+	put_job_in_background(job);
+
+	return 0;
 }
 
-void put_job_in_foreground(pid_t init_pgid, Jobs* jobs, struct Job* job)
+int put_job_in_foreground(pid_t init_pgid, struct JobControl* job_control, struct Job* job)
 {
 	tcsetpgrp(STDIN_FILENO, job->pgid);
 	kill(-job->pgid, SIGCONT);
 
-	wait_for_job(jobs, job);
+	wait_for_job(job_control, job);
 
 	tcsetpgrp(STDIN_FILENO, init_pgid);
 
+	int rc = process_status((struct Process*)job->processes->tail->data);
+
 	if (is_job_completed(job))
 	{
-		remove_node(jobs, job);
+		remove_job(job_control, job);
+		return rc;
 	}
+
+	if (job_control->jobs.current != job->id) // the stopped job becomes %+
+	{
+		job_control->jobs.previous = job_control->jobs.current;
+		job_control->jobs.current = job->id;
+	}
+
+	return rc;
 }
 
 void put_job_in_background(struct Job* job)
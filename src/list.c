@@ -9,10 +9,25 @@ struct List* create_list(void (*free_data)(void*))
 	return list;
 }
 
+struct List* create_arena_list(struct Arena* arena)
+{
+	struct List* list = arena_alloc(arena, sizeof(struct List));
+	list->arena = arena;
+
+	return list;
+}
+
+static struct Node* create_node(struct List* list, void* data)
+{
+	struct Node* node = list->arena ? arena_alloc(list->arena, sizeof(struct Node)) : calloc(1, sizeof(struct Node));
+	node->data = data;
+
+	return node;
+}
+
 void push_back(struct List* list, void* data)
 {
-	struct Node* last = calloc(1, sizeof(struct Node));
-	last->data = data;
+	struct Node* last = create_node(list, data);
 
 	if (!list->head)
 	{
@@ -27,8 +42,7 @@ void push_back(struct List* list, void* data)
 
 void push_forward(struct List* list, void* data)
 {
-	struct Node* first = calloc(1, sizeof(struct Node));
-	first->data = data;
+	struct Node* first = create_node(list, data);
 
 	if (!list->head)
 	{
@@ -69,7 +83,11 @@ void remove_node(struct List* list, void* data)
 		*prev = node->next;
 		*next = node->prev;
 
-		list->free_data(data);
+		if (!list->arena)
+		{
+			list->free_data(data);
+			free(node);
+		}
 	}
 }
 
@@ -77,22 +95,29 @@ void destroy_list(struct List** list)
 {
 	if (*list)
 	{
-		free_elements(&(*list)->head, (*list)->free_data);
-		free(*list);
+		if (!(*list)->arena)
+		{
+			free_elements(&(*list)->head, (*list)->free_data);
+			free(*list);
+		}
+
 		*list = NULL;
 	}
 }
 
 void free_elements(struct Node** head, void (*free_data)(void*))
 {
-	if (*head)
+	struct Node* node = *head;
+
+	while (node)
 	{
-		if ((*head)->next)
-		{
-			free_elements(&(*head)->next, free_data);
-			free((*head)->next);
-		}
+		struct Node* next = node->next;
 
-		free_data((*head)->data);
+		free_data(node->data);
+		free(node);
+
+		node = next;
 	}
+
+	*head = NULL;
 }
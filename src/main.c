@@ -3,6 +3,7 @@
 #include "utility.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
 #include <readline/readline.h>
 
 int main(int argc, char** argv)
@@ -16,15 +17,24 @@ int main(int argc, char** argv)
 
 	int rc = 0;
 
+	if (argc > 1 && !strcmp(argv[1], "--no-cache"))
+	{
+		shell->use_script_cache = 0;
+		argv++;
+		argc--;
+	}
+
 	if (argc != 1)
 	{
 		rc = shell_execute_from_file(shell, argv[1]);
 	}
-	else
+	else if (isatty(STDIN_FILENO))
 	{
 		char* input = NULL;
 		char* prompt = NULL;
 
+		shell->job_control->notify = 1;
+
 		while (1) 
 		{
 			prompt = concat_strings(get_variable(shell, "PWD"), "$ ");
@@ -40,12 +50,16 @@ int main(int argc, char** argv)
 			free(input);
 			free(prompt);
 
-			do_job_notification(shell->jobs);
+			do_job_notification(shell->job_control);
 		}
 
 		free(input);
 		free(prompt);
 	}
+	else
+	{
+		rc = 1; // commands are read from the terminal only
+	}
 
 	destroy(shell);
 	
@@ -0,0 +1,150 @@
+#include "output.h"
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#define OUTPUT_PARTS_CAP 16
+#define OUTPUT_BUFFER_CAP 256
+#define OUTPUT_IOV_COUNT 64 // iovecs passed to a writev() call
+
+static struct OutputPart* new_part(struct Output* output)
+{
+	if (output->parts_count == output->parts_capacity)
+	{
+		output->parts_capacity = output->parts_capacity ? output->parts_capacity << 1 : OUTPUT_PARTS_CAP;
+		output->parts = realloc(output->parts, output->parts_capacity * sizeof(struct OutputPart));
+	}
+
+	return output->parts + output->parts_count++;
+}
+
+static void check_size(struct Output* output)
+{
+	if (output->total > OUTPUT_FLUSH_SIZE && flush_output(output) == -1)
+	{
+		output->error = 1;
+	}
+}
+
+void output_reference(struct Output* output, const char* data, size_t size)
+{
+	if (size)
+	{
+		struct OutputPart* part = new_part(output);
+		part->data = data;
+		part->size = size;
+		output->total += size;
+
+		check_size(output);
+	}
+}
+
+void output_write(struct Output* output, const char* data, size_t size)
+{
+	if (!size)
+	{
+		return;
+	}
+
+	if (output->size + size > output->capacity)
+	{
+		while (output->size + size > output->capacity)
+		{
+			output->capacity = output->capacity ? output->capacity << 1 : OUTPUT_BUFFER_CAP;
+		}
+
+		output->buffer = realloc(output->buffer, output->capacity);
+	}
+
+	memcpy(output->buffer + output->size, data, size);
+
+	struct OutputPart* last = output->parts_count ? output->parts + output->parts_count - 1 : NULL;
+
+	if (last && !last->data && last->offset + last->size == output->size) // continues the previous copied part
+	{
+		last->size += size;
+	}
+	else
+	{
+		struct OutputPart* part = new_part(output);
+		part->data = NULL;
+		part->offset = output->size;
+		part->size = size;
+	}
+
+	output->size += size;
+	output->total += size;
+
+	check_size(output);
+}
+
+void output_char(struct Output* output, char c)
+{
+	output_write(output, &c, 1);
+}
+
+int flush_output(struct Output* output)
+{
+	int rc = output->error ? -1 : 0;
+	size_t part = 0;
+	size_t skip = 0; // bytes of parts[part] that were already written
+
+	while (part < output->parts_count && rc == 0)
+	{
+		struct iovec iov[OUTPUT_IOV_COUNT];
+		int count = 0;
+
+		for (size_t i = part; i < output->parts_count && count < OUTPUT_IOV_COUNT; i++, count++)
+		{
+			struct OutputPart* p = output->parts + i;
+			size_t offset = i == part ? skip : 0;
+
+			iov[count].iov_base = (char*)(p->data ? p->data : output->buffer + p->offset) + offset;
+			iov[count].iov_len = p->size - offset;
+		}
+
+		ssize_t written = writev(STDOUT_FILENO, iov, count);
+
+		if (written == -1)
+		{
+			if (errno != EINTR)
+			{
+				rc = -1;
+			}
+
+			continue;
+		}
+
+		for (size_t left = (size_t)written; left; ) // partial writes continue from the first unwritten byte
+		{
+			size_t rest = output->parts[part].size - skip;
+
+			if (left < rest)
+			{
+				skip += left;
+				left = 0;
+			}
+			else
+			{
+				left -= rest;
+				part++;
+				skip = 0;
+			}
+		}
+	}
+
+	output->parts_count = 0;
+	output->size = 0;
+	output->total = 0;
+	output->error = 0;
+
+	return rc;
+}
+
+void free_output(struct Output* output)
+{
+	free(output->parts);
+	free(output->buffer);
+	memset(output, 0, sizeof(struct Output));
+}
@@ -2,6 +2,9 @@
 #include "list.h"
 #include "utility.h"
 #include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
 
 // get_token(...) function is get_next_token(...) or arithm_get_next_token(...) (if parser->parsing_arithm_expr == 1)
 int eat(struct Parser* parser, enum TokenType expected, struct Token(*get_token)(struct Scanner*, int*))
@@ -23,16 +26,438 @@ struct AstWord* ast_word(struct Parser* parser)
 		return NULL;
 	}
 
-	struct AstWord* word = malloc(sizeof(struct AstWord));
-	copy_token(&word->word, &parser->current_token);
+	struct AstWord* word = arena_alloc(parser->arena, sizeof(struct AstWord));
+	copy_token(parser->arena, &word->word, &parser->current_token);
 	eat(parser, word->word.type, get_next_token);
 
+	if (word->word.type == PARAMETER_EXPANSION && word->word.word.buffer[0] == '{')
+	{
+		if (!(word->expansion = compile_param_exp(parser->arena, word->word.word.buffer)))
+		{
+			set_error(parser->error, "bad substitution!");
+		}
+	}
+	else if (word->word.type == WORD)
+	{
+		word->brace = word->word.brace ? compile_brace_exp(parser->arena, word->word.word.buffer) : NULL;
+		word->glob = word->word.glob && !word->brace ? compile_glob(parser->arena, pattern_text(&word->word)) : NULL; // words produced by brace expansion aren't expanded further
+	}
+
 	return word;
 }
 
-static struct AstNode* create_ast_node(void* actual_data, enum AstNodeType node_type)
+static int is_name_char(char c)
+{
+	return isalnum((unsigned char)c) || c == '_';
+}
+
+// index is a number or a variable's name (with or without '$')
+static int compile_subscript(struct Arena* arena, struct ParamExp* exp, const char* index, const char* end)
+{
+	if (end - index == 1 && (*index == '@' || *index == '*'))
+	{
+		exp->subscript = SUBSCRIPT_ALL;
+		return 1;
+	}
+
+	exp->subscript = SUBSCRIPT_INDEX;
+
+	if (*index == '$')
+	{
+		index++;
+	}
+
+	if (index < end && (*index == '-' || isdigit((unsigned char)*index)))
+	{
+		char* number_end = NULL;
+		exp->index = strtol(index, &number_end, 10);
+		return number_end == end;
+	}
+
+	for (const char* p = index; p < end; p++)
+	{
+		if (!is_name_char(*p))
+		{
+			return 0;
+		}
+	}
+
+	if (index == end)
+	{
+		return 0;
+	}
+
+	exp->index_name = arena_alloc(arena, (size_t)(end - index) + 1);
+	memcpy(exp->index_name, index, (size_t)(end - index));
+
+	return 1;
+}
+
+static int is_name_range(const char* begin, const char* end)
+{
+	if (begin == end || isdigit((unsigned char)*begin))
+	{
+		return 0;
+	}
+
+	for (const char* p = begin; p < end; p++)
+	{
+		if (!is_name_char(*p))
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static char* copy_range(struct Arena* arena, const char* begin, const char* end)
+{
+	char* copy = arena_alloc(arena, (size_t)(end - begin) + 1);
+	memcpy(copy, begin, (size_t)(end - begin));
+
+	return copy;
+}
+
+// $name or ${name}, returns NULL if the text isn't a single variable
+static char* compile_variable(struct Arena* arena, const char* begin, const char* end)
+{
+	if (begin == end || *begin != '$')
+	{
+		return NULL;
+	}
+
+	begin++;
+
+	if (begin < end && *begin == '{' && end[-1] == '}')
+	{
+		begin++;
+		end--;
+	}
+
+	return is_name_range(begin, end) ? copy_range(arena, begin, end) : NULL;
+}
+
+// a literal pattern is compiled, backslashes of other literal operands are removed
+static void compile_operand(struct Arena* arena, struct ParamOperand* operand, const char* begin, const char* end, int pattern)
+{
+	if ((operand->name = compile_variable(arena, begin, end)))
+	{
+		return;
+	}
+
+	operand->text = copy_range(arena, begin, end);
+
+	if (pattern)
+	{
+		operand->pattern = compile_pattern(arena, operand->text, (size_t)(end - begin));
+		return;
+	}
+
+	char* out = operand->text;
+
+	for (const char* p = begin; p < end; p++)
+	{
+		if (*p == '\\' && p + 1 < end)
+		{
+			p++;
+		}
+
+		*out++ = *p;
+	}
+
+	*out = '\0';
+}
+
+// an integer or a variable's name (with or without '$'), surrounding spaces are allowed: ${name: -1}
+static int compile_number(struct Arena* arena, struct ParamOperand* operand, const char* begin, const char* end)
+{
+	while (begin < end && *begin == ' ')
+	{
+		begin++;
+	}
+
+	while (end > begin && end[-1] == ' ')
+	{
+		end--;
+	}
+
+	if (begin < end && (*begin == '-' || isdigit((unsigned char)*begin)))
+	{
+		char* number_end = NULL;
+		operand->text = copy_range(arena, begin, end);
+		strtol(operand->text, &number_end, 10);
+
+		return number_end == operand->text + (end - begin) && number_end != operand->text;
+	}
+
+	operand->name = is_name_range(begin, end) ? copy_range(arena, begin, end) : compile_variable(arena, begin, end);
+
+	return operand->name != NULL;
+}
+
+// p points at the operator after the name and the subscript
+static int compile_operator(struct Arena* arena, struct ParamExp* exp, const char* p, const char* end)
+{
+	switch (*p++)
+	{
+		case '#':
+		case '%':
+		{
+			int is_long = p < end && *p == p[-1];
+
+			if (p[-1] == '#')
+			{
+				exp->op = is_long ? PARAM_REMOVE_LONG_PREFIX : PARAM_REMOVE_SHORT_PREFIX;
+			}
+			else
+			{
+				exp->op = is_long ? PARAM_REMOVE_LONG_SUFFIX : PARAM_REMOVE_SHORT_SUFFIX;
+			}
+
+			compile_operand(arena, &exp->pattern, p + is_long, end, 1);
+		} return 1;
+		case '/':
+		{
+			exp->op = PARAM_REPLACE;
+
+			if (p < end && *p == '/')
+			{
+				exp->op = PARAM_REPLACE_ALL;
+				p++;
+			}
+			else if (p < end && (*p == '#' || *p == '%'))
+			{
+				exp->anchor = *p++;
+			}
+
+			const char* separator = p;
+
+			while (separator < end && *separator != '/')
+			{
+				separator += *separator == '\\' && separator + 1 < end ? 2 : 1;
+			}
+
+			compile_operand(arena, &exp->pattern, p, separator, 1);
+			compile_operand(arena, &exp->replacement, separator < end ? separator + 1 : end, end, 0);
+		} return 1;
+		case ':':
+		{
+			if (p < end && *p == '-')
+			{
+				exp->op = PARAM_DEFAULT;
+				compile_operand(arena, &exp->pattern, p + 1, end, 0);
+				return 1;
+			}
+
+			exp->op = PARAM_SUBSTRING;
+
+			const char* separator = memchr(p, ':', (size_t)(end - p));
+
+			if (!compile_number(arena, &exp->offset, p, separator ? separator : end))
+			{
+				return 0;
+			}
+
+			return !separator || compile_number(arena, &exp->length, separator + 1, end);
+		}
+		default: return 0;
+	}
+}
+
+struct ParamExp* compile_param_exp(struct Arena* arena, const char* text)
+{
+	size_t length = strlen(text);
+
+	if (length < 3 || text[0] != '{' || text[length - 1] != '}')
+	{
+		return NULL;
+	}
+
+	struct ParamExp* exp = arena_alloc(arena, sizeof(struct ParamExp));
+	const char* p = text + 1;
+	const char* end = text + length - 1;
+
+	if (*p == '#' && p + 1 < end)
+	{
+		exp->op = PARAM_LENGTH;
+		p++;
+	}
+
+	const char* name = p;
+
+	while (p < end && is_name_char(*p))
+	{
+		p++;
+	}
+
+	if (!is_name_range(name, p))
+	{
+		return NULL;
+	}
+
+	exp->name = copy_range(arena, name, p);
+
+	if (p < end && *p == '[')
+	{
+		const char* close = memchr(p, ']', (size_t)(end - p));
+
+		if (!close || !compile_subscript(arena, exp, p + 1, close))
+		{
+			return NULL;
+		}
+
+		p = close + 1;
+	}
+
+	if (p == end)
+	{
+		return exp;
+	}
+
+	if (exp->op == PARAM_LENGTH || !compile_operator(arena, exp, p, end))
+	{
+		return NULL;
+	}
+
+	return exp;
+}
+
+// a decimal number without spaces, padded is set if it begins with a zero
+static int parse_brace_number(const char* begin, const char* end, long long* number, int* padded)
 {
-	struct AstNode* node = malloc(sizeof(struct AstNode));
+	const char* digits = begin + (*begin == '-');
+
+	if (digits == end || !isdigit((unsigned char)*digits))
+	{
+		return 0;
+	}
+
+	char* number_end = NULL;
+	errno = 0;
+	*number = strtoll(begin, &number_end, 10);
+
+	if (number_end != end || errno == ERANGE)
+	{
+		return 0;
+	}
+
+	*padded |= *digits == '0' && end - digits > 1;
+
+	return 1;
+}
+
+// {first..last} or {first..last..step}, the direction comes from first and last; if first or last begins with a zero,
+// the numbers are padded to the width of the wider one
+static int compile_brace_range(struct BraceExp* exp, const char* begin, const char* end)
+{
+	const char* dots = strstr(begin, "..");
+	long long last = 0;
+	long long step = 1;
+	int padded = 0;
+
+	if (!dots || dots >= end || !parse_brace_number(begin, dots, &exp->first, &padded))
+	{
+		return 0;
+	}
+
+	const char* next = dots + 2;
+	const char* step_dots = strstr(next, "..");
+
+	if (step_dots && step_dots < end)
+	{
+		int step_padded = 0;
+
+		if (!parse_brace_number(step_dots + 2, end, &step, &step_padded))
+		{
+			return 0;
+		}
+	}
+	else
+	{
+		step_dots = end;
+	}
+
+	if (!parse_brace_number(next, step_dots, &last, &padded))
+	{
+		return 0;
+	}
+
+	int width = padded ? (int)(dots - begin > step_dots - next ? dots - begin : step_dots - next) : 0;
+
+	unsigned long long distance = last >= exp->first ? (unsigned long long)last - (unsigned long long)exp->first : (unsigned long long)exp->first - (unsigned long long)last;
+	unsigned long long increment = step == 0 ? 1 : step < 0 ? -(unsigned long long)step : (unsigned long long)step;
+
+	if (distance / increment >= (unsigned long long)SIZE_MAX || width > BRACE_WIDTH_MAX)
+	{
+		return 0;
+	}
+
+	exp->count = (size_t)(distance / increment) + 1;
+	exp->step = last >= exp->first ? (long long)increment : -(long long)increment;
+	exp->width = width;
+
+	return 1;
+}
+
+// {a,b,c}, items may be empty
+static int compile_brace_list(struct Arena* arena, struct BraceExp* exp, const char* begin, const char* end)
+{
+	size_t count = 1;
+
+	for (const char* p = begin; p < end; p++)
+	{
+		count += *p == ',';
+	}
+
+	if (count < 2)
+	{
+		return 0;
+	}
+
+	exp->items = arena_alloc(arena, count * sizeof(char*));
+	exp->sizes = arena_alloc(arena, count * sizeof(size_t));
+
+	for (const char* item = begin; exp->count < count; exp->count++)
+	{
+		const char* comma = memchr(item, ',', (size_t)(end - item));
+		comma = comma ? comma : end;
+
+		exp->items[exp->count] = item;
+		exp->sizes[exp->count] = (size_t)(comma - item);
+		item = comma + 1;
+	}
+
+	return 1;
+}
+
+struct BraceExp* compile_brace_exp(struct Arena* arena, const char* text)
+{
+	const char* open = strchr(text, '{');
+	const char* close = open ? strchr(open, '}') : NULL;
+
+	if (!close)
+	{
+		return NULL;
+	}
+
+	struct BraceExp* exp = arena_alloc(arena, sizeof(struct BraceExp));
+	exp->prefix = text;
+	exp->prefix_size = (size_t)(open - text);
+	exp->suffix = close + 1;
+	exp->suffix_size = strlen(close + 1);
+
+	if (!compile_brace_range(exp, open + 1, close) && !compile_brace_list(arena, exp, open + 1, close))
+	{
+		return NULL;
+	}
+
+	return exp;
+}
+
+static struct AstNode* create_ast_node(struct Parser* parser, void* actual_data, enum AstNodeType node_type)
+{
+	struct AstNode* node = arena_alloc(parser->arena, sizeof(struct AstNode));
 	node->actual_data = actual_data;
 	node->node_type = node_type;
 	return node;
@@ -53,13 +478,13 @@ AssignmentsList* cmd_prefix(struct Parser* parser)
 		return NULL;
 	}
 
-	AssignmentsList* assignment_list = create_list(&free_ast_assignment);
+	AssignmentsList* assignment_list = create_arena_list(parser->arena);
 	struct AstAssignment* assignment = NULL;
 	struct Token token;
 
 	do
 	{
-		copy_token(&token, &parser->current_token);
+		token = parser->current_token;
 		eat(parser, NAME, get_next_token);
 
 		struct AstNode* node = NULL;
@@ -72,81 +497,223 @@ AssignmentsList* cmd_prefix(struct Parser* parser)
 		{
 			if (parser->current_token.type == WORD || parser->current_token.type == PARAMETER_EXPANSION)
 			{
-				node = create_ast_node(ast_word(parser), AST_WORD);
+				node = create_ast_node(parser, ast_word(parser), AST_WORD);
 			}
 		}
 
 		if (node)
 		{
-			assignment = calloc(1, sizeof(struct AstAssignment));
-			assignment->variable = malloc(sizeof(struct Token));
-			copy_token(assignment->variable, &token);
+			assignment = arena_alloc(parser->arena, sizeof(struct AstAssignment));
+			assignment->variable = arena_alloc(parser->arena, sizeof(struct Token));
+			copy_token(parser->arena, assignment->variable, &token);
 			assignment->expression = node;
 			push_back(assignment_list, assignment);
 		}
 		else
 		{
-			destroy_list(&assignment_list);
-			free(assignment_list);
-
-			if (!parser->error->error)
+			if (!parser->error->error)
+			{
+				set_error(parser->error, "invalid assignment statement");
+			}
+
+			return NULL;
+		}
+	} while (parser->current_token.type == NAME);
+
+	return assignment_list;
+}
+
+// filenme: WORD
+//        | PARAMETER_EXPANSION
+struct AstWord* filename(struct Parser* parser)
+{
+	return ast_word(parser);
+}
+
+/*
+io_redirect : INPUT_REDIRECT  filename
+            | OUTPUT_REDIRECT filename
+*/
+struct AstIORedirect* io_redirect(struct Parser* parser)
+{
+	if (parser->current_token.type == INPUT_REDIRECT || parser->current_token.type == OUTPUT_REDIRECT)
+	{
+		struct Token* token = arena_alloc(parser->arena, sizeof(struct Token));
+		*token = parser->current_token;
+		eat(parser, parser->current_token.type, get_next_token);
+
+		struct AstWord* file_name = filename(parser);
+		if (!file_name) 
+		{
+			set_error(parser->error, "incomplete I/O redirection! Expected filename!");
+			return NULL;
+		}
+
+		struct AstIORedirect* io_redir = arena_alloc(parser->arena, sizeof(struct AstIORedirect));
+		io_redir->file_name = file_name;
+		io_redir->token = token;
+
+		return io_redir;
+	}
+
+	return NULL;
+}
+
+static int finish_reading_arithm_expr(struct Scanner* scanner)
+{
+	if (scanner->buffer[scanner->position] == ')')
+	{
+		scanner->position++;
+		return 1;
+	}
+
+	return 0;
+}
+
+static int is_constant(struct AstArithmExpr* arithm_expr)
+{
+	return arithm_expr->token.type == INTEGER;
+}
+
+static void make_constant(struct AstArithmExpr* arithm_expr, int64_t value)
+{
+	arithm_expr->left = arithm_expr->right = NULL;
+	arithm_expr->token.type = INTEGER;
+	arithm_expr->value = value;
+}
+
+// replaces subtrees without parameters by their values, expressions that overflow or divide by zero are left to fail at runtime
+static void fold_arithm_expr(struct AstArithmExpr* arithm_expr)
+{
+	struct AstArithmExpr* left = arithm_expr->left;
+	struct AstArithmExpr* right = arithm_expr->right;
+
+	if (left)
+	{
+		fold_arithm_expr(left);
+	}
+
+	if (right)
+	{
+		fold_arithm_expr(right);
+	}
+
+	if (!left || !is_constant(left) || (right && !is_constant(right)))
+	{
+		return;
+	}
+
+	int64_t value = 0;
+
+	switch (arithm_expr->token.type)
+	{
+		case PLUS:
+		{
+			if (!right)
+			{
+				make_constant(arithm_expr, left->value);
+			}
+			else if (!__builtin_add_overflow(left->value, right->value, &value))
+			{
+				make_constant(arithm_expr, value);
+			}
+		} break;
+		case MINUS:
+		{
+			if (!right)
+			{
+				if (!__builtin_sub_overflow((int64_t)0, left->value, &value))
+				{
+					make_constant(arithm_expr, value);
+				}
+			}
+			else if (!__builtin_sub_overflow(left->value, right->value, &value))
+			{
+				make_constant(arithm_expr, value);
+			}
+		} break;
+		case MULTIPLY:
+		{
+			if (!__builtin_mul_overflow(left->value, right->value, &value))
+			{
+				make_constant(arithm_expr, value);
+			}
+		} break;
+		case DIVIDE:
+		{
+			if (right->value != 0 && !(left->value == INT64_MIN && right->value == -1))
 			{
-				set_error(parser->error, "invalid assignment statement");
+				make_constant(arithm_expr, left->value / right->value);
 			}
-
-			return NULL;
-		}
-	} while (parser->current_token.type == NAME);
-
-	return assignment_list;
+		} break;
+		default: break;
+	}
 }
 
-// filenme: WORD
-//        | PARAMETER_EXPANSION
-struct AstWord* filename(struct Parser* parser)
+static size_t count_arithm_ops(struct AstArithmExpr* arithm_expr)
 {
-	return ast_word(parser);
+	if (!arithm_expr)
+	{
+		return 0;
+	}
+
+	size_t count = count_arithm_ops(arithm_expr->left) + count_arithm_ops(arithm_expr->right);
+
+	if (arithm_expr->token.type == PLUS && !arithm_expr->right) // unary plus doesn't need an instruction
+	{
+		return count;
+	}
+
+	return count + 1;
 }
 
-/*
-io_redirect : INPUT_REDIRECT  filename
-            | OUTPUT_REDIRECT filename
-*/
-struct AstIORedirect* io_redirect(struct Parser* parser)
+// emits arithm_expr in postfix order, returns stack depth needed to evaluate arithm_expr
+static size_t emit_arithm_ops(struct ArithmProgram* program, struct AstArithmExpr* arithm_expr)
 {
-	if (parser->current_token.type == INPUT_REDIRECT || parser->current_token.type == OUTPUT_REDIRECT)
-	{
-		struct Token* token = malloc(sizeof(struct Token));
-		copy_token(token, &parser->current_token);
-		eat(parser, parser->current_token.type, get_next_token);
+	size_t left_depth = arithm_expr->left ? emit_arithm_ops(program, arithm_expr->left) : 0;
+	size_t right_depth = arithm_expr->right ? emit_arithm_ops(program, arithm_expr->right) + 1 : 0;
+	size_t depth = left_depth > right_depth ? left_depth : right_depth;
 
-		struct AstWord* file_name = filename(parser);
-		if (!file_name) 
-		{
-			free(token);
-			set_error(parser->error, "incomplete I/O redirection! Expected filename!");
-			return NULL;
-		}
+	if (arithm_expr->token.type == PLUS && !arithm_expr->right)
+	{
+		return depth;
+	}
 
-		struct AstIORedirect* io_redir = malloc(sizeof(struct AstIORedirect));
-		io_redir->file_name = file_name;
-		io_redir->token = token;
+	struct ArithmOp* op = program->ops + program->size++;
 
-		return io_redir;
+	switch (arithm_expr->token.type)
+	{
+		case INTEGER:
+		{
+			op->type = ARITHM_INTEGER;
+			op->value = arithm_expr->value;
+			return 1;
+		} break;
+		case PARAMETER_EXPANSION:
+		{
+			op->type = ARITHM_PARAMETER;
+			op->parameter = arithm_expr->token.word.buffer;
+			return 1;
+		} break;
+		case PLUS: op->type = ARITHM_ADD; break;
+		case MINUS: op->type = arithm_expr->right ? ARITHM_SUBTRACT : ARITHM_NEGATE; break;
+		case MULTIPLY: op->type = ARITHM_MULTIPLY; break;
+		case DIVIDE: op->type = ARITHM_DIVIDE; break;
+		default: break;
 	}
 
-	return NULL;
+	return depth;
 }
 
-static int finish_reading_arithm_expr(struct Scanner* scanner)
+static struct ArithmProgram* compile_arithm_expr(struct Parser* parser, struct AstArithmExpr* arithm_expr)
 {
-	if (scanner->buffer[scanner->position] == ')')
-	{
-		scanner->position++;
-		return 1;
-	}
+	fold_arithm_expr(arithm_expr);
 
-	return 0;
+	struct ArithmProgram* program = arena_alloc(parser->arena, sizeof(struct ArithmProgram));
+	program->ops = arena_alloc(parser->arena, count_arithm_ops(arithm_expr) * sizeof(struct ArithmOp));
+	program->depth = emit_arithm_ops(program, arithm_expr);
+
+	return program;
 }
 
 // returns result of arithm_expression
@@ -157,11 +724,15 @@ struct AstNode* parse_arithm_expr(struct Parser* parser)
 	struct AstArithmExpr* arithm_expr = arithm_expression(parser);
 	if (!arithm_expr || !finish_reading_arithm_expr(parser->scanner))
 	{
-		set_error(parser->error, "invalid arithmetic expression!");
+		if (!parser->error->error)
+		{
+			set_error(parser->error, "invalid arithmetic expression!");
+		}
+
 		return NULL;
 	}
 
-	struct AstNode* node = create_ast_node(arithm_expr, AST_ARITHM_EXPR);
+	struct AstNode* node = create_ast_node(parser, compile_arithm_expr(parser, arithm_expr), AST_ARITHM_EXPR);
 
 	parser->parsing_arithm_expr = 0;
 	parser->current_token = get_next_token(parser->scanner, &parser->parsing_arithm_expr);
@@ -181,7 +752,7 @@ cmd_suffix :	        io_redirect
 */
 struct CmdArgs* cmd_suffix(struct Parser* parser)
 {
-	struct CmdArgs* cmd_args = calloc(1, sizeof(struct CmdArgs));
+	struct CmdArgs* cmd_args = arena_alloc(parser->arena, sizeof(struct CmdArgs));
 
 	for (int running = 1; running; )
 	{
@@ -191,12 +762,10 @@ struct CmdArgs* cmd_suffix(struct Parser* parser)
 		{
 			if (io_redir->token->type == OUTPUT_REDIRECT)
 			{
-				free_ast_io_redirect(cmd_args->output_redirect);
 				cmd_args->output_redirect = io_redir;
 			}
 			else
 			{
-				free_ast_io_redirect(cmd_args->input_redirect);
 				cmd_args->input_redirect = io_redir;
 			}
 		}
@@ -222,7 +791,7 @@ struct CmdArgs* cmd_suffix(struct Parser* parser)
 
 				if (arg)
 				{
-					node = create_ast_node(arg, AST_WORD);
+					node = create_ast_node(parser, arg, AST_WORD);
 				}				
 			}
 
@@ -230,7 +799,7 @@ struct CmdArgs* cmd_suffix(struct Parser* parser)
 			{
 				if (!cmd_args->command_args)
 				{
-					cmd_args->command_args = create_list(&free_ast_node);
+					cmd_args->command_args = create_arena_list(parser->arena);
 				}
 
 				push_back(cmd_args->command_args, node);
@@ -244,7 +813,6 @@ struct CmdArgs* cmd_suffix(struct Parser* parser)
 
 	if (!cmd_args->input_redirect && !cmd_args->output_redirect && !cmd_args->command_args)
 	{
-		free(cmd_args);
 		return NULL;
 	}
 
@@ -272,7 +840,7 @@ struct AstSimpleCommand* simple_command(struct Parser* parser)
 	AssignmentsList* assignment_list = cmd_prefix(parser);
 	if (assignment_list)
 	{
-		ast_scommand = calloc(1, sizeof(struct AstSimpleCommand));
+		ast_scommand = arena_alloc(parser->arena, sizeof(struct AstSimpleCommand));
 		ast_scommand->assignment_list = assignment_list;
 	}
 	else
@@ -288,7 +856,7 @@ struct AstSimpleCommand* simple_command(struct Parser* parser)
 	{
 		if (!ast_scommand)
 		{
-			ast_scommand = calloc(1, sizeof(struct AstSimpleCommand));
+			ast_scommand = arena_alloc(parser->arena, sizeof(struct AstSimpleCommand));
 		}
 
 		ast_scommand->command_name = command_name;
@@ -307,7 +875,6 @@ struct AstSimpleCommand* simple_command(struct Parser* parser)
 			ast_scommand->command_args = cmd_args->command_args;
 			ast_scommand->input_redirect = cmd_args->input_redirect;
 			ast_scommand->output_redirect = cmd_args->output_redirect;
-			free(cmd_args);
 		}
 	}
 
@@ -332,11 +899,16 @@ struct AstArithmExpr* arithm_expression(struct Parser* parser)
 		enum TokenType type = parser->current_token.type;
 		eat(parser, type, arithm_get_next_token);
 
-		struct AstArithmExpr* temp = calloc(1, sizeof(struct AstArithmExpr));
+		struct AstArithmExpr* temp = arena_alloc(parser->arena, sizeof(struct AstArithmExpr));
 		temp->left = node;
 		temp->token.type = type;
 		temp->right = arithm_term(parser);
 
+		if (!temp->right)
+		{
+			return NULL;
+		}
+
 		node = temp;
 	}
 
@@ -361,14 +933,13 @@ struct AstArithmExpr* arithm_term(struct Parser* parser)
 		enum TokenType type = parser->current_token.type;
 		eat(parser, type, arithm_get_next_token);
 
-		struct AstArithmExpr* temp = calloc(1, sizeof(struct AstArithmExpr));
+		struct AstArithmExpr* temp = arena_alloc(parser->arena, sizeof(struct AstArithmExpr));
 		temp->token.type = type;
 		temp->left = node;
 		temp->right = arithm_factor(parser);
 
 		if (!temp->right)
 		{
-			free_ast_arithm_expr(temp);
 			return NULL;
 		}
 
@@ -393,29 +964,47 @@ struct AstArithmExpr* arithm_factor(struct Parser* parser)
 	{
 		case INTEGER:
 		{
-			node = calloc(1, sizeof(struct AstArithmExpr));
-			node->token = parser->current_token;
+			errno = 0;
+			int64_t value = strtoll(parser->current_token.word.buffer, NULL, 10);
+
+			if (errno == ERANGE)
+			{
+				set_error(parser->error, "integer constant is too large in arithmetic expression!");
+				return NULL;
+			}
+
+			node = arena_alloc(parser->arena, sizeof(struct AstArithmExpr));
+			node->token.type = INTEGER;
+			node->value = value;
 			eat(parser, INTEGER, arithm_get_next_token);
 		} break;
 		case PARAMETER_EXPANSION:
 		{
-			node = calloc(1, sizeof(struct AstArithmExpr));
-			node->token = parser->current_token;
+			node = arena_alloc(parser->arena, sizeof(struct AstArithmExpr));
+			copy_token(parser->arena, &node->token, &parser->current_token);
 			eat(parser, PARAMETER_EXPANSION, arithm_get_next_token);
 		} break;
 		case PLUS:
 		{
 			eat(parser, PLUS, arithm_get_next_token);
-			node = calloc(1, sizeof(struct AstArithmExpr));
+			node = arena_alloc(parser->arena, sizeof(struct AstArithmExpr));
 			node->token.type = PLUS;
-			node->left = arithm_factor(parser);
+
+			if (!(node->left = arithm_factor(parser)))
+			{
+				return NULL;
+			}
 		} break;
 		case MINUS:
 		{
 			eat(parser, MINUS, arithm_get_next_token);
-			node = calloc(1, sizeof(struct AstArithmExpr));
+			node = arena_alloc(parser->arena, sizeof(struct AstArithmExpr));
 			node->token.type = MINUS;
-			node->left = arithm_factor(parser);
+
+			if (!(node->left = arithm_factor(parser)))
+			{
+				return NULL;
+			}
 		} break;
 		case LPAR:
 		{
@@ -424,7 +1013,6 @@ struct AstArithmExpr* arithm_factor(struct Parser* parser)
 
 			if (!eat(parser, RPAR, arithm_get_next_token))
 			{
-				free_ast_arithm_expr(node);
 				return NULL;
 			}
 		} break;
@@ -448,8 +1036,8 @@ struct AstPipeline* pipeline(struct Parser* parser)
 		return NULL;
 	}
 
-	struct AstPipeline* ast_pipeline = calloc(1, sizeof(struct AstPipeline));
-	ast_pipeline->pipeline = create_list(free_ast_simple_command);
+	struct AstPipeline* ast_pipeline = arena_alloc(parser->arena, sizeof(struct AstPipeline));
+	ast_pipeline->pipeline = create_arena_list(parser->arena);
 	push_back(ast_pipeline->pipeline, ast_scommand);
 
 	while (parser->current_token.type == PIPE)
@@ -463,7 +1051,6 @@ struct AstPipeline* pipeline(struct Parser* parser)
 		}
 		else
 		{
-			free_ast_pipeline(ast_pipeline);
 			set_error(parser->error, "incomplete pipeline!");
 			return NULL;
 		}
@@ -538,7 +1125,7 @@ PipelinesList* pipeline_list(struct Parser* parser)
 		return NULL;
 	}
 
-	PipelinesList* pipe_list = create_list(free_ast_pipeline);
+	PipelinesList* pipe_list = create_arena_list(parser->arena);
 	push_back(pipe_list, pipe);
 
 	while (parser->current_token.type == ASYNC_LIST || parser->current_token.type == SEQ_LIST || parser->current_token.type == NEWLINE)
@@ -637,7 +1224,7 @@ term : cc_list term
 */
 CommandsList* term(struct Parser* parser)
 {
-	CommandsList* commands_list = create_list(free_ast_node);
+	CommandsList* commands_list = create_arena_list(parser->arena);
 	CompoundCommandsList* compound_commands = NULL;
 	PipelinesList* pipes = NULL;
 
@@ -647,20 +1234,20 @@ CommandsList* term(struct Parser* parser)
 
 		if (pipes)
 		{
-			push_back(commands_list, create_ast_node(pipes, AST_PIPELINE_LIST));
+			push_back(commands_list, create_ast_node(parser, pipes, AST_PIPELINE_LIST));
 		}
 
 		compound_commands = cc_list(parser);
 
 		if (compound_commands)
 		{
-			push_back(commands_list, create_ast_node(compound_commands, AST_COMPOUND_COMMANDS_LIST));
+			push_back(commands_list, create_ast_node(parser, compound_commands, AST_COMPOUND_COMMANDS_LIST));
 		}
 	} while (compound_commands);
 
 	if (!commands_list->head)
 	{
-		destroy_list(&commands_list);
+		commands_list = NULL;
 	}
 
 	return commands_list;
@@ -681,7 +1268,7 @@ CompoundCommandsList* cc_list(struct Parser* parser)
 		return NULL;
 	}
 
-	CompoundCommandsList* commands_list = create_list(free_ast_node);
+	CompoundCommandsList* commands_list = create_arena_list(parser->arena);
 	push_back(commands_list, node);
 
 	while (1)
@@ -706,6 +1293,7 @@ CompoundCommandsList* cc_list(struct Parser* parser)
 compound_command: for_clause
                 | if_clause
                 | while_clause
+                | case_clause
 */
 struct AstNode* compound_command(struct Parser* parser)
 {
@@ -717,7 +1305,12 @@ struct AstNode* compound_command(struct Parser* parser)
 
 		if (!node && !parser->error->error)
 		{
-			return for_clause(parser);
+			node = for_clause(parser);
+
+			if (!node && !parser->error->error)
+			{
+				return case_clause(parser);
+			}
 		}
 	}
 
@@ -735,20 +1328,17 @@ struct AstNode* if_clause(struct Parser* parser)
 		return NULL;
 	}
 
-	struct AstIf* ast_if = calloc(1, sizeof(struct AstIf));
+	struct AstIf* ast_if = arena_alloc(parser->arena, sizeof(struct AstIf));
 	ast_if->condition = compoud_list(parser);
 
 	if (!ast_if->condition)
 	{
-		free(ast_if);
 		set_error(parser->error, "invalid 'if' statement!");
 		return NULL;
 	}
 
 	if (!eat(parser, THEN, get_next_token))
 	{
-		destroy_list(&ast_if->condition);
-		free(ast_if);
 		set_error(parser->error, "expected 'then' token in 'if' statement!");
 		return NULL;
 	}
@@ -757,8 +1347,6 @@ struct AstNode* if_clause(struct Parser* parser)
 
 	if (!ast_if->if_part && parser->error->error)
 	{
-		destroy_list(&ast_if->condition);
-		free(ast_if);
 		return NULL;
 	}
 
@@ -766,23 +1354,16 @@ struct AstNode* if_clause(struct Parser* parser)
 	
 	if (parser->error->error)
 	{
-		destroy_list(&ast_if->if_part);
-		destroy_list(&ast_if->condition);
-		free(ast_if);
 		return NULL;
 	}
 
 	if (!eat(parser, FI, get_next_token))
 	{
-		destroy_list(&ast_if->condition);
-		destroy_list(&ast_if->if_part);	
-		destroy_list(&ast_if->else_part);
-		free(ast_if);
 		set_error(parser->error, "expected 'fi' token in 'if' statement!");
 		return NULL;
 	}
 
-	return create_ast_node(ast_if, AST_IF);
+	return create_ast_node(parser, ast_if, AST_IF);
 }
 
 //else_part: Else compound_list
@@ -796,7 +1377,10 @@ CommandsList* else_part(struct Parser* parser)
 	return compoud_list(parser);
 }
 
-//while_clause: While compound_list do_group
+/*
+while_clause: While compound_list do_group
+            | While compound_list do_group io_redirect_list
+*/
 struct AstNode* while_clause(struct Parser* parser)
 {
 	if (!eat(parser, WHILE, get_next_token))
@@ -814,15 +1398,33 @@ struct AstNode* while_clause(struct Parser* parser)
 	CommandsList* body = do_group(parser);
 	if (!body && parser->error->error)
 	{
-		destroy_list(&condition);
 		return NULL;
 	}
 
-	struct AstWhile* ast_while = malloc(sizeof(struct AstWhile));
+	struct AstWhile* ast_while = arena_alloc(parser->arena, sizeof(struct AstWhile));
 	ast_while->body = body;
 	ast_while->condition = condition;
+	ast_while->input_redirect = NULL;
+	ast_while->output_redirect = NULL;
+
+	for (struct AstIORedirect* io_redir = io_redirect(parser); io_redir; io_redir = io_redirect(parser))
+	{
+		if (io_redir->token->type == OUTPUT_REDIRECT)
+		{
+			ast_while->output_redirect = io_redir;
+		}
+		else
+		{
+			ast_while->input_redirect = io_redir;
+		}
+	}
+
+	if (parser->error->error)
+	{
+		return NULL;
+	}
 
-	return create_ast_node(ast_while, AST_WHILE);
+	return create_ast_node(parser, ast_while, AST_WHILE);
 }
 
 //do_group : Do compound_list Done
@@ -838,14 +1440,12 @@ CommandsList* do_group(struct Parser* parser)
 
 	if (parser->error->error)
 	{
-		destroy_list(&commands);
 		return NULL;
 	}
 	
 	if (!eat(parser, DONE, get_next_token))
 	{
 		set_error(parser->error, "expected 'done' token!");
-		destroy_list(&commands);
 		return NULL;
 	}
 
@@ -866,7 +1466,7 @@ struct AstNode* for_clause(struct Parser* parser)
 		return NULL;
 	}
 
-	struct AstFor* ast_for = calloc(1, sizeof(struct AstFor));
+	struct AstFor* ast_for = arena_alloc(parser->arena, sizeof(struct AstFor));
 	ast_for->variable = ast_word(parser);
 	
 	linebreak(parser);
@@ -874,14 +1474,12 @@ struct AstNode* for_clause(struct Parser* parser)
 	if (!eat(parser, IN, get_next_token))
 	{
 		set_error(parser->error, "invalid 'for' loop! Expected 'in' token");
-		free_ast_for(ast_for);
 		return NULL;
 	}
 
 	if (!(ast_for->wordlist = wordlist(parser)))
 	{
 		set_error(parser->error, "invalid 'for' loop!");
-		free_ast_for(ast_for);
 		return NULL;
 	}
 
@@ -891,11 +1489,168 @@ struct AstNode* for_clause(struct Parser* parser)
 
 	if (parser->error->error)
 	{
-		free_ast_for(ast_for);
 		return NULL;
 	}
 
-	return create_ast_node(ast_for, AST_FOR);
+	return create_ast_node(parser, ast_for, AST_FOR);
+}
+
+/*
+case_clause : Case WORD linebreak In linebreak case_list Esac
+            | Case WORD linebreak In linebreak           Esac
+*/
+struct AstNode* case_clause(struct Parser* parser)
+{
+	if (!eat(parser, CASE, get_next_token))
+	{
+		return NULL;
+	}
+
+	struct AstCase* ast_case = arena_alloc(parser->arena, sizeof(struct AstCase));
+
+	if (!(ast_case->word = ast_word(parser)))
+	{
+		set_error(parser->error, "invalid 'case' statement! Expected 'word' token");
+		return NULL;
+	}
+
+	linebreak(parser);
+
+	if (!eat(parser, IN, get_next_token))
+	{
+		set_error(parser->error, "invalid 'case' statement! Expected 'in' token");
+		return NULL;
+	}
+
+	linebreak(parser);
+
+	ast_case->items = create_arena_list(parser->arena);
+
+	while (!eat(parser, ESAC, get_next_token))
+	{
+		struct AstCaseItem* item = case_item(parser);
+
+		if (!item)
+		{
+			if (!parser->error->error)
+			{
+				set_error(parser->error, "expected 'esac' token in 'case' statement!");
+			}
+
+			return NULL;
+		}
+
+		push_back(ast_case->items, item);
+	}
+
+	compile_case_patterns(parser->arena, ast_case);
+
+	return create_ast_node(parser, ast_case, AST_CASE);
+}
+
+/*
+case_item : pattern ')' linebreak     DSEMI linebreak
+          | pattern ')' compound_list DSEMI linebreak
+          | pattern ')' compound_list
+*/
+struct AstCaseItem* case_item(struct Parser* parser)
+{
+	Wordlist* patterns = pattern(parser);
+
+	if (!patterns)
+	{
+		return NULL;
+	}
+
+	if (!eat(parser, RPAR, get_next_token))
+	{
+		set_error(parser->error, "expected ')' token in 'case' statement!");
+		return NULL;
+	}
+
+	struct AstCaseItem* item = arena_alloc(parser->arena, sizeof(struct AstCaseItem));
+	item->patterns = patterns;
+	item->body = compoud_list(parser);
+
+	if (parser->error->error)
+	{
+		return NULL;
+	}
+
+	linebreak(parser); // an empty body
+
+	if (eat(parser, DSEMI, get_next_token))
+	{
+		linebreak(parser);
+	}
+	else if (parser->current_token.type != ESAC) // only the last item may omit ';;'
+	{
+		set_error(parser->error, "expected ';;' or 'esac' token in 'case' statement!");
+		return NULL;
+	}
+
+	return item;
+}
+
+/*
+pattern :             WORD
+        |             PARAMETER_EXPANSION
+        | pattern '|' WORD
+        | pattern '|' PARAMETER_EXPANSION
+*/
+Wordlist* pattern(struct Parser* parser)
+{
+	Wordlist* patterns = create_arena_list(parser->arena);
+
+	do
+	{
+		struct AstWord* word = ast_word(parser);
+
+		if (!word)
+		{
+			return NULL;
+		}
+
+		push_back(patterns, create_ast_node(parser, word, AST_WORD));
+	} while (eat(parser, PIPE, get_next_token));
+
+	return patterns;
+}
+
+void compile_case_patterns(struct Arena* arena, struct AstCase* ast_case)
+{
+	size_t item_index = 0;
+
+	for (struct Node* node = ast_case->items->head; node; node = node->next)
+	{
+		ast_case->pattern_count += get_list_size(((struct AstCaseItem*)node->data)->patterns);
+	}
+
+	ast_case->patterns = arena_alloc(arena, ast_case->pattern_count * sizeof(struct CasePattern));
+	struct Pattern** literals = arena_alloc(arena, ast_case->pattern_count * sizeof(struct Pattern*));
+	struct CasePattern* case_pattern = ast_case->patterns;
+
+	for (struct Node* node = ast_case->items->head; node; node = node->next, item_index++)
+	{
+		for (struct Node* word_node = ((struct AstCaseItem*)node->data)->patterns->head; word_node; word_node = word_node->next)
+		{
+			struct AstWord* word = (struct AstWord*)((struct AstNode*)word_node->data)->actual_data;
+
+			case_pattern->word = word;
+			case_pattern->item = item_index;
+
+			if (word->word.type == WORD) // quoted characters were escaped by the scanner, so a quoted word is a literal pattern
+			{
+				const char* text = pattern_text(&word->word);
+				case_pattern->pattern = compile_pattern(arena, text, strlen(text));
+			}
+
+			literals[case_pattern - ast_case->patterns] = case_pattern->pattern;
+			case_pattern++;
+		}
+	}
+
+	ast_case->automaton = compile_pattern_set(arena, literals, ast_case->pattern_count);
 }
 
 /*
@@ -908,7 +1663,7 @@ wordlist : wordlist WORD
 */
 Wordlist* wordlist(struct Parser* parser)
 {
-	Wordlist* list = create_list(free_ast_node);
+	Wordlist* list = create_arena_list(parser->arena);
 	struct AstNode* arithm_expr = NULL;
 	struct AstWord* word = NULL;
 
@@ -920,7 +1675,6 @@ Wordlist* wordlist(struct Parser* parser)
 
 			if (!arithm_expr)
 			{
-				destroy_list(&list);
 				return NULL;
 			}
 
@@ -931,13 +1685,12 @@ Wordlist* wordlist(struct Parser* parser)
 
 		if (word)
 		{
-			push_back(list, create_ast_node(word, AST_WORD));
+			push_back(list, create_ast_node(parser, word, AST_WORD));
 		}
 	} while (word || parser->parsing_arithm_expr);
 
 	if (!list->head)
 	{
-		free(list);
 		return NULL;
 	}
 
@@ -961,169 +1714,64 @@ CommandsList* parse(struct Parser* parser)
 	return program;
 }
 
-void free_ast_simple_command(void* ast_scommand)
+/*
+complete_command : linebreak compound_command
+                 | linebreak pipeline (separator_op pipeline)* [separator_op]
+*/
+CommandsList* complete_command(struct Parser* parser)
 {
-	if (ast_scommand)
-	{
-		struct AstSimpleCommand* command = (struct AstSimpleCommand*)ast_scommand;
-		destroy_list(&command->assignment_list);
-		destroy_list(&command->command_args);
-		free_ast_word(command->command_name);
-		free_ast_io_redirect(command->input_redirect);
-		free_ast_io_redirect(command->output_redirect);
-		free(command);
-	}
-}
+	linebreak(parser);
 
-void free_ast_assignment(void* assignment)
-{
-	if (assignment)
+	if (parser->current_token.type == END)
 	{
-		struct AstAssignment* a = (struct AstAssignment*)assignment;
-		free_ast_node(a->expression);
-		free(a->variable->word.buffer);
-		free(a->variable);
-		free(a);
+		return NULL;
 	}
-}
 
-void free_ast_node(void* node)
-{
+	CommandsList* commands = create_arena_list(parser->arena);
+	struct AstNode* node = compound_command(parser);
+
 	if (node)
 	{
-		struct AstNode* n = (struct AstNode*)node;
-
-		switch (n->node_type)
-		{
-			case AST_WORD:
-			{
-				free_ast_word(n->actual_data);
-			} break;
-			case AST_IF:
-			{
-				free_ast_if(n->actual_data);
-			} break;
-			case AST_FOR:
-			{
-				free_ast_for(n->actual_data);
-			} break;
-			case AST_WHILE:
-			{
-				free_ast_while(n->actual_data);
-			} break;
-			case AST_ARITHM_EXPR:
-			{
-				free_ast_arithm_expr(n->actual_data);
-			} break;
-			case AST_PIPELINE_LIST:
-			{
-				destroy_list((struct List**)&n->actual_data);
-			} break;
-			case AST_COMPOUND_COMMANDS_LIST:
-			{
-				destroy_list((struct List**)&n->actual_data);
-			} break;
-			default:
-			{
-				free(n->actual_data);
-			} break;
-		}
-
-		free(n);
+		CompoundCommandsList* compound_commands = create_arena_list(parser->arena);
+		push_back(compound_commands, node);
+		push_back(commands, create_ast_node(parser, compound_commands, AST_COMPOUND_COMMANDS_LIST));
+		return commands;
 	}
-}
 
-void free_ast_io_redirect(void* io_redir)
-{
-	if (io_redir)
-	{
-		struct AstIORedirect* redir = (struct AstIORedirect*)io_redir;
-		free_ast_word(redir->file_name);
-		free(redir->token);
-		free(redir);
-	}
-}
+	struct AstPipeline* pipe = NULL;
 
-void free_ast_word(void* word)
-{
-	if (word)
+	if (parser->error->error || !(pipe = pipeline(parser)))
 	{
-		struct AstWord* w = (struct AstWord*)word;
-
-		if (w->word.word.buffer)
+		if (!parser->error->error)
 		{
-			free(w->word.word.buffer);
+			set_error(parser->error, "invalid token!");
 		}
 
-		free(w);
+		return NULL;
 	}
-}
 
-void free_ast_arithm_expr(void* arithm_expr)
-{
-	if (arithm_expr)
-	{
-		struct AstArithmExpr* expr = (struct AstArithmExpr*)arithm_expr;
+	PipelinesList* pipe_list = create_arena_list(parser->arena);
+	push_back(pipe_list, pipe);
 
-		if (expr->left)
-		{
-			free_ast_arithm_expr(expr->left);
-		}
-		if (expr->right)
-		{
-			free_ast_arithm_expr(expr->right);
-		}
+	// the command ends at a newline, a compound command may follow on the same line
+	while (parser->current_token.type == ASYNC_LIST || parser->current_token.type == SEQ_LIST)
+	{
+		pipe->mode = separator_op(parser);
 
-		if (expr->token.word.buffer)
+		if (!(pipe = pipeline(parser)))
 		{
-			free(expr->token.word.buffer);
+			break;
 		}
 
-		free(expr);
-	}
-}
-
-void free_ast_pipeline(void* ast_pipeline)
-{
-	if (ast_pipeline)
-	{
-		struct AstPipeline* pipe = (struct AstPipeline*)ast_pipeline;
-		destroy_list(&pipe->pipeline);
-		free(pipe);
+		push_back(pipe_list, pipe);
 	}
-}
 
-void free_ast_if(void* ast_if)
-{
-	if (ast_if)
+	if (parser->error->error)
 	{
-		struct AstIf* if_statement = (struct AstIf*)ast_if;
-		destroy_list(&if_statement->condition);
-		destroy_list(&if_statement->if_part);
-		destroy_list(&if_statement->else_part);
-		free(if_statement);
+		return NULL;
 	}
-}
 
-void free_ast_while(void* ast_while)
-{
-	if (ast_while)
-	{
-		struct AstWhile* while_loop = (struct AstWhile*)ast_while;
-		destroy_list(&while_loop->body);
-		destroy_list(&while_loop->condition);
-		free(while_loop);
-	}
-}
+	push_back(commands, create_ast_node(parser, pipe_list, AST_PIPELINE_LIST));
 
-void free_ast_for(void* ast_for)
-{
-	if (ast_for)
-	{
-		struct AstFor* for_loop = (struct AstFor*)ast_for;
-		destroy_list(&for_loop->wordlist);
-		destroy_list(&for_loop->body);
-		free_ast_word(for_loop->variable);
-		free(ast_for);
-	}
+	return commands;
 }
\ No newline at end of file
@@ -0,0 +1,455 @@
+#include "pathname.h"
+#include "walker.h"
+#include "utility.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#define PATHS_CAP 16
+#define ENTRIES_CAP 64
+#define NAMES_CAP 4096
+#define RADIX_SORT_SIZE 4096 // smaller lists are sorted with qsort()
+
+struct Glob* compile_glob(struct Arena* arena, const char* text)
+{
+	size_t length = strlen(text);
+	struct Glob* glob = arena_alloc(arena, sizeof(struct Glob));
+	glob->segments = arena_alloc(arena, (length / 2 + 1) * sizeof(struct GlobSegment)); // non-empty segments are separated by '/'
+	glob->absolute = *text == '/';
+	glob->directory = length && text[length - 1] == '/';
+
+	int patterns = 0;
+
+	for (const char* p = text; *p; )
+	{
+		if (*p == '/')
+		{
+			p++;
+			continue;
+		}
+
+		const char* end = strchrnul(p, '/');
+
+		if (end - p == 2 && p[0] == '*' && p[1] == '*')
+		{
+			if (!glob->size || !glob->segments[glob->size - 1].recursive) // **/** is the same as **
+			{
+				glob->segments[glob->size++].recursive = 1;
+				glob->recursive = 1;
+				patterns++;
+			}
+
+			p = end;
+			continue;
+		}
+
+		struct GlobSegment* segment = glob->segments + glob->size++;
+		segment->pattern = compile_pattern(arena, p, (size_t)(end - p));
+		patterns += !segment->pattern->literal;
+
+		p = end;
+	}
+
+	return patterns ? glob : NULL;
+}
+
+void add_path(struct PathList* list, char* path)
+{
+	if (list->size == list->capacity)
+	{
+		list->capacity = list->capacity ? list->capacity << 1 : PATHS_CAP;
+		list->paths = realloc(list->paths, list->capacity * sizeof(char*));
+	}
+
+	list->paths[list->size++] = path;
+}
+
+char* join_path(const char* base, const char* name, size_t name_size)
+{
+	size_t base_size = strlen(base);
+	size_t separator = base_size && base[base_size - 1] != '/' ? 1 : 0;
+	char* path = malloc(base_size + separator + name_size + 1);
+
+	memcpy(path, base, base_size);
+
+	if (separator)
+	{
+		path[base_size] = '/';
+	}
+
+	memcpy(path + base_size + separator, name, name_size);
+	path[base_size + separator + name_size] = '\0';
+
+	return path;
+}
+
+static void add_entry(struct Directory* directory, const char* name, unsigned char type, size_t* names_capacity, size_t* entries_capacity)
+{
+	size_t size = strlen(name) + 1;
+	size_t offset = directory->count ? directory->offsets[directory->count] : 0;
+
+	if (directory->count + 1 >= *entries_capacity) // the offset after the last entry is kept too
+	{
+		*entries_capacity = *entries_capacity ? *entries_capacity << 1 : ENTRIES_CAP;
+		directory->offsets = realloc(directory->offsets, *entries_capacity * sizeof(size_t));
+		directory->types = realloc(directory->types, *entries_capacity);
+	}
+
+	if (offset + size > *names_capacity)
+	{
+		while (offset + size > *names_capacity)
+		{
+			*names_capacity = *names_capacity ? *names_capacity << 1 : NAMES_CAP;
+		}
+
+		directory->names = realloc(directory->names, *names_capacity);
+	}
+
+	memcpy(directory->names + offset, name, size);
+	directory->offsets[directory->count] = offset;
+	directory->types[directory->count] = type;
+	directory->offsets[++directory->count] = offset + size;
+}
+
+// a directory that can't be read has no entries
+static struct Directory* read_directory(const char* path)
+{
+	struct Directory* directory = calloc(1, sizeof(struct Directory));
+	directory->path = copy_string(path);
+
+	int fd = open(*path ? path : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	if (fd == -1)
+	{
+		return directory;
+	}
+
+	char* batch = malloc(DIRENT_BATCH_SIZE);
+	size_t names_capacity = 0;
+	size_t entries_capacity = 0;
+	long size;
+
+	while ((size = syscall(SYS_getdents64, fd, batch, DIRENT_BATCH_SIZE)) > 0)
+	{
+		for (long position = 0; position < size; )
+		{
+			struct LinuxDirent64* entry = (struct LinuxDirent64*)(batch + position);
+			const char* name = entry->d_name;
+
+			position += entry->d_reclen;
+
+			if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2])))
+			{
+				continue;
+			}
+
+			add_entry(directory, name, entry->d_type, &names_capacity, &entries_capacity);
+		}
+	}
+
+	free(batch);
+	close(fd);
+
+	return directory;
+}
+
+static struct Directory* get_directory(struct DirectoryCache* cache, const char* path)
+{
+	for (struct Directory* directory = cache->directories; directory; directory = directory->next)
+	{
+		if (!strcmp(directory->path, path))
+		{
+			return directory;
+		}
+	}
+
+	struct Directory* directory = read_directory(path);
+	directory->next = cache->directories;
+	cache->directories = directory;
+
+	return directory;
+}
+
+static int is_directory(const struct Directory* directory, size_t indx, const char* path)
+{
+	if (directory->types[indx] != DT_UNKNOWN && directory->types[indx] != DT_LNK)
+	{
+		return directory->types[indx] == DT_DIR;
+	}
+
+	struct stat sb;
+
+	return stat(path, &sb) == 0 && S_ISDIR(sb.st_mode);
+}
+
+// a name beginning with '.' matches only a pattern beginning with '.'
+static void match_directory(struct DirectoryCache* cache, const char* base, const struct Pattern* pattern, int directories_only, struct PathList* matches)
+{
+	struct Directory* directory = get_directory(cache, base);
+	int hidden = pattern->prefix_size && *pattern->prefix == '.';
+
+	for (size_t i = 0; i < directory->count; i++)
+	{
+		const char* name = directory->names + directory->offsets[i];
+		size_t size = directory->offsets[i + 1] - directory->offsets[i] - 1;
+
+		if ((*name == '.' && !hidden) || !match_pattern(pattern, name, size))
+		{
+			continue;
+		}
+
+		char* path = join_path(base, name, size);
+
+		if (directories_only && !is_directory(directory, i, path))
+		{
+			free(path);
+			continue;
+		}
+
+		add_path(matches, path);
+	}
+}
+
+static int path_exists(const char* path, int directories_only)
+{
+	struct stat sb;
+
+	if (directories_only)
+	{
+		return stat(path, &sb) == 0 && S_ISDIR(sb.st_mode);
+	}
+
+	return lstat(path, &sb) == 0;
+}
+
+/*
+	Paths are sorted by their first 8 bytes as big-endian integers, so most comparisons don't touch the strings.
+	Large lists are sorted by the integers with a radix sort, paths with equal integers are compared afterwards.
+*/
+struct SortKey
+{
+	uint64_t prefix;
+	char* path;
+};
+
+static uint64_t get_prefix(const char* path)
+{
+	uint64_t prefix = 0;
+
+	for (int i = 0; i < 8 && path[i]; i++)
+	{
+		prefix |= (uint64_t)(unsigned char)path[i] << (56 - 8 * i);
+	}
+
+	return prefix;
+}
+
+static int compare_keys(const void* a, const void* b)
+{
+	const struct SortKey* first = a;
+	const struct SortKey* second = b;
+
+	if (first->prefix != second->prefix)
+	{
+		return first->prefix < second->prefix ? -1 : 1;
+	}
+
+	return (first->prefix & 0xff) ? strcmp(first->path + 8, second->path + 8) : 0; // shorter paths are equal
+}
+
+static struct SortKey* radix_sort(struct SortKey* keys, struct SortKey* buffer, size_t size)
+{
+	size_t* counts = malloc(65536 * sizeof(size_t));
+
+	for (int shift = 0; shift < 64; shift += 16)
+	{
+		memset(counts, 0, 65536 * sizeof(size_t));
+
+		for (size_t i = 0; i < size; i++)
+		{
+			counts[(keys[i].prefix >> shift) & 0xffff]++;
+		}
+
+		if (counts[(keys[0].prefix >> shift) & 0xffff] == size) // the keys don't differ in the digit
+		{
+			continue;
+		}
+
+		for (size_t digit = 0, position = 0; digit < 65536; digit++)
+		{
+			size_t count = counts[digit];
+			counts[digit] = position;
+			position += count;
+		}
+
+		for (size_t i = 0; i < size; i++)
+		{
+			buffer[counts[(keys[i].prefix >> shift) & 0xffff]++] = keys[i];
+		}
+
+		struct SortKey* sorted = buffer;
+		buffer = keys;
+		keys = sorted;
+	}
+
+	free(counts);
+
+	for (size_t start = 0, end; start < size; start = end)
+	{
+		for (end = start + 1; end < size && keys[end].prefix == keys[start].prefix; end++)
+		{
+		}
+
+		if (end - start > 1 && (keys[start].prefix & 0xff))
+		{
+			qsort(keys + start, end - start, sizeof(struct SortKey), compare_keys);
+		}
+	}
+
+	return keys;
+}
+
+static void sort_paths(char** paths, size_t size)
+{
+	if (size < 2)
+	{
+		return;
+	}
+
+	struct SortKey* storage = malloc(size * 2 * sizeof(struct SortKey));
+	struct SortKey* keys = storage;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		keys[i].prefix = get_prefix(paths[i]);
+		keys[i].path = paths[i];
+	}
+
+	if (size < RADIX_SORT_SIZE)
+	{
+		qsort(keys, size, sizeof(struct SortKey), compare_keys);
+	}
+	else
+	{
+		keys = radix_sort(keys, storage + size, size);
+	}
+
+	for (size_t i = 0; i < size; i++)
+	{
+		paths[i] = keys[i].path;
+	}
+
+	free(storage);
+}
+
+static void free_path_strings(struct PathList* list)
+{
+	for (size_t i = 0; i < list->size; i++)
+	{
+		free(list->paths[i]);
+	}
+
+	list->size = 0;
+}
+
+/*
+	Segments are expanded one after another: a pattern segment is matched against the entries of each
+	directory found so far, a literal segment is appended without reading the directory.
+	The segment after '**' is matched while the trees are walked, the matches of all the trees are sorted together.
+*/
+size_t expand_glob(struct DirectoryCache* cache, const struct Glob* glob, size_t threads, struct PathList* list)
+{
+	struct PathList current = { 0 };
+	struct PathList next = { 0 };
+
+	add_path(&current, copy_string(glob->absolute ? "/" : ""));
+
+	for (size_t i = 0; i < glob->size && current.size; i++)
+	{
+		const struct GlobSegment* segment = glob->segments + i;
+
+		if (segment->recursive)
+		{
+			const struct Pattern* pattern = i + 1 < glob->size ? glob->segments[++i].pattern : NULL;
+			walk_trees((const char**)current.paths, current.size, pattern, i + 1 < glob->size || glob->directory, threads, &next);
+		}
+
+		int directories_only = i + 1 < glob->size || glob->directory;
+
+		for (size_t j = 0; j < current.size && !segment->recursive; j++)
+		{
+			if (!segment->pattern->literal)
+			{
+				match_directory(cache, current.paths[j], segment->pattern, directories_only, &next);
+				continue;
+			}
+
+			char* path = join_path(current.paths[j], segment->pattern->prefix, segment->pattern->prefix_size);
+
+			if (i + 1 == glob->size && !path_exists(path, directories_only)) // directories are checked when they're read
+			{
+				free(path);
+				continue;
+			}
+
+			add_path(&next, path);
+		}
+
+		free_path_strings(&current);
+
+		struct PathList swap = current;
+		current = next;
+		next = swap;
+	}
+
+	for (size_t i = 0; glob->directory && i < current.size; i++)
+	{
+		size_t length = strlen(current.paths[i]);
+
+		if (current.paths[i][length - 1] == '/') // a/**/ matches a/
+		{
+			continue;
+		}
+
+		current.paths[i] = realloc(current.paths[i], length + 2);
+		memcpy(current.paths[i] + length, "/", 2);
+	}
+
+	sort_paths(current.paths, current.size);
+
+	for (size_t i = 0; i < current.size; i++)
+	{
+		add_path(list, current.paths[i]);
+	}
+
+	free(current.paths);
+	free(next.paths);
+
+	return current.size;
+}
+
+void clear_directory_cache(struct DirectoryCache* cache)
+{
+	while (cache->directories)
+	{
+		struct Directory* directory = cache->directories;
+		cache->directories = directory->next;
+
+		free(directory->path);
+		free(directory->names);
+		free(directory->offsets);
+		free(directory->types);
+		free(directory);
+	}
+}
+
+void free_paths(struct PathList* list)
+{
+	free_path_strings(list);
+	free(list->paths);
+	list->paths = NULL;
+	list->capacity = 0;
+}
@@ -0,0 +1,636 @@
+#include "pattern.h"
+#include <string.h>
+#include <ctype.h>
+
+#define SET_SIZE 32 // bytes of a PATTERN_CLASS bitmap
+
+struct NamedClass
+{
+	const char* name;
+	int (*is)(int);
+};
+
+static const struct NamedClass NamedClasses[] =
+{
+	{ "alpha", isalpha },
+	{ "digit", isdigit },
+	{ "alnum", isalnum },
+	{ "upper", isupper },
+	{ "lower", islower },
+	{ "space", isspace },
+	{ "blank", isblank },
+	{ "xdigit", isxdigit },
+	{ "punct", ispunct },
+	{ "print", isprint },
+	{ "graph", isgraph },
+	{ "cntrl", iscntrl }
+};
+
+static const size_t NamedClassesCount = sizeof(NamedClasses) / sizeof(struct NamedClass);
+
+static void set_bit(unsigned char* set, unsigned char c)
+{
+	set[c >> 3] |= (unsigned char)(1 << (c & 7));
+}
+
+static int has_bit(const unsigned char* set, unsigned char c)
+{
+	return set[c >> 3] & (1 << (c & 7));
+}
+
+// [:name:], p points at '[', returns the position after ":]" or NULL if it isn't a known class
+static const char* add_named_class(const char* p, const char* end, unsigned char* set)
+{
+	for (size_t i = 0; i < NamedClassesCount; i++)
+	{
+		size_t length = strlen(NamedClasses[i].name);
+
+		if ((size_t)(end - p) >= length + 4 && !strncmp(p + 2, NamedClasses[i].name, length) && !strncmp(p + 2 + length, ":]", 2))
+		{
+			for (int c = 0; c < 256; c++)
+			{
+				if (NamedClasses[i].is(c))
+				{
+					set_bit(set, (unsigned char)c);
+				}
+			}
+
+			return p + length + 4;
+		}
+	}
+
+	return NULL;
+}
+
+// p points after '[', returns the position after ']' or NULL if the bracket expression isn't terminated
+static const char* compile_class(const char* p, const char* end, unsigned char* set)
+{
+	int negate = 0;
+
+	if (p < end && (*p == '!' || *p == '^'))
+	{
+		negate = 1;
+		p++;
+	}
+
+	const char* start = p; // ']' at the start is an ordinary character
+
+	while (p < end && (*p != ']' || p == start))
+	{
+		const char* next = *p == '[' && p + 1 < end && p[1] == ':' ? add_named_class(p, end, set) : NULL;
+
+		if (next)
+		{
+			p = next;
+			continue;
+		}
+
+		unsigned char first = (unsigned char)*p;
+
+		if (first == '\\' && p + 1 < end)
+		{
+			first = (unsigned char)*(++p);
+		}
+
+		p++;
+
+		if (p + 1 < end && *p == '-' && p[1] != ']') // a range
+		{
+			p++;
+
+			if (*p == '\\' && p + 1 < end)
+			{
+				p++;
+			}
+
+			for (int c = first; c <= (unsigned char)*p; c++)
+			{
+				set_bit(set, (unsigned char)c);
+			}
+
+			p++;
+		}
+		else
+		{
+			set_bit(set, first);
+		}
+	}
+
+	if (p >= end)
+	{
+		return NULL;
+	}
+
+	if (negate)
+	{
+		for (size_t i = 0; i < SET_SIZE; i++)
+		{
+			set[i] = (unsigned char)~set[i];
+		}
+	}
+
+	return p + 1;
+}
+
+static struct PatternElement* add_element(struct Pattern* pattern, enum PatternOp op)
+{
+	struct PatternElement* element = pattern->elements + pattern->size++;
+	element->op = op;
+
+	return element;
+}
+
+struct Pattern* compile_pattern(struct Arena* arena, const char* text, size_t size)
+{
+	struct Pattern* pattern = arena_alloc(arena, sizeof(struct Pattern));
+	pattern->elements = arena_alloc(arena, (size + 1) * sizeof(struct PatternElement)); // at most an element per character
+
+	char* literal = arena_alloc(arena, size + 1); // unescaped literal characters of all elements
+	const char* end = text + size;
+	struct PatternElement* last = NULL;
+
+	for (const char* p = text; p < end; )
+	{
+		char c = *p;
+
+		if (c == '*')
+		{
+			if (!last || last->op != PATTERN_STAR) // ** is the same as *
+			{
+				last = add_element(pattern, PATTERN_STAR);
+				pattern->stars++;
+			}
+
+			p++;
+			continue;
+		}
+
+		if (c == '?')
+		{
+			last = add_element(pattern, PATTERN_ANY);
+			pattern->min_length++;
+			p++;
+			continue;
+		}
+
+		if (c == '[')
+		{
+			unsigned char* set = arena_alloc(arena, SET_SIZE);
+			const char* next = compile_class(p + 1, end, set);
+
+			if (next)
+			{
+				last = add_element(pattern, PATTERN_CLASS);
+				last->set = set;
+				pattern->min_length++;
+				p = next;
+				continue;
+			}
+		}
+
+		if (c == '\\' && p + 1 < end)
+		{
+			c = *(++p);
+		}
+
+		p++;
+
+		if (!last || last->op != PATTERN_LITERAL)
+		{
+			last = add_element(pattern, PATTERN_LITERAL);
+			last->text = literal;
+		}
+
+		*literal++ = c;
+		last->size++;
+		pattern->min_length++;
+	}
+
+	if (pattern->size && pattern->elements[0].op == PATTERN_LITERAL)
+	{
+		pattern->prefix = pattern->elements[0].text;
+		pattern->prefix_size = pattern->elements[0].size;
+	}
+
+	if (pattern->size && pattern->elements[pattern->size - 1].op == PATTERN_LITERAL)
+	{
+		pattern->suffix = pattern->elements[pattern->size - 1].text;
+		pattern->suffix_size = pattern->elements[pattern->size - 1].size;
+	}
+
+	pattern->literal = pattern->size == 0 || (pattern->size == 1 && pattern->elements[0].op == PATTERN_LITERAL);
+	pattern->affixes = pattern->stars == 1 && pattern->size == (size_t)(1 + !!pattern->prefix_size + !!pattern->suffix_size);
+
+	return pattern;
+}
+
+// matches the element at string + *position and moves the position after it
+static int match_element(const struct PatternElement* element, const char* string, size_t length, size_t* position)
+{
+	switch (element->op)
+	{
+		case PATTERN_LITERAL:
+		{
+			if (length - *position < element->size || memcmp(string + *position, element->text, element->size))
+			{
+				return 0;
+			}
+
+			*position += element->size;
+		} return 1;
+		case PATTERN_ANY:
+		{
+			if (*position == length)
+			{
+				return 0;
+			}
+
+			(*position)++;
+		} return 1;
+		case PATTERN_CLASS:
+		{
+			if (*position == length || !has_bit(element->set, (unsigned char)string[*position]))
+			{
+				return 0;
+			}
+
+			(*position)++;
+		} return 1;
+		default: return 0;
+	}
+}
+
+/*
+	Only the last star is backtracked: when the elements after it fail, the star takes one more character.
+	Earlier stars never need to take more, because whatever follows the last star can still match later.
+*/
+static int match_elements(const struct Pattern* pattern, const char* string, size_t length)
+{
+	size_t element = 0;
+	size_t position = 0;
+	size_t star_element = 0; // the element after the last star, 0 - no star yet
+	size_t star_position = 0; // where the characters after the last star begin
+
+	while (1)
+	{
+		if (element < pattern->size && pattern->elements[element].op == PATTERN_STAR)
+		{
+			star_element = ++element;
+			star_position = position;
+			continue;
+		}
+
+		if (element == pattern->size)
+		{
+			if (position == length)
+			{
+				return 1;
+			}
+		}
+		else if (match_element(pattern->elements + element, string, length, &position))
+		{
+			element++;
+			continue;
+		}
+
+		if (!star_element || star_position == length)
+		{
+			return 0;
+		}
+
+		element = star_element;
+		position = ++star_position;
+	}
+}
+
+int match_pattern(const struct Pattern* pattern, const char* string, size_t length)
+{
+	if (length < pattern->min_length || (!pattern->stars && length != pattern->min_length))
+	{
+		return 0;
+	}
+
+	if (memcmp(string, pattern->prefix, pattern->prefix_size) ||
+		memcmp(string + length - pattern->suffix_size, pattern->suffix, pattern->suffix_size))
+	{
+		return 0;
+	}
+
+	return pattern->literal || pattern->affixes || match_elements(pattern, string, length);
+}
+
+// a position of the nondeterministic automaton, it's followed by an element that takes a single byte or by a star
+struct Position
+{
+	enum PatternOp op; // a literal run is a position for each byte
+	unsigned char byte;
+	const unsigned char* set;
+	long pattern; // the pattern matched at its last position, -1 for the other positions
+};
+
+/*
+	A state of the deterministic automaton is a set of positions, states are found by their hash in an open
+	addressing table of their indexes
+*/
+struct SetBuilder
+{
+	struct Position* positions;
+	size_t position_count;
+	size_t words; // uint64_t words of a positions set
+	uint64_t* states;
+	size_t state_count;
+	size_t capacity;
+	int32_t* table;
+	size_t table_size;
+	int32_t* transitions;
+	size_t class_count;
+};
+
+static int has_position(const uint64_t* set, size_t position)
+{
+	return (set[position >> 6] >> (position & 63)) & 1;
+}
+
+static void add_position(uint64_t* set, size_t position)
+{
+	set[position >> 6] |= (uint64_t)1 << (position & 63);
+}
+
+static int position_accepts(const struct Position* position, unsigned char c)
+{
+	switch (position->op)
+	{
+		case PATTERN_LITERAL: return c == position->byte;
+		case PATTERN_CLASS: return has_bit(position->set, c);
+		default: return 1;
+	}
+}
+
+// a star can match nothing, so the position after it is reached too
+static void close_positions(const struct SetBuilder* builder, uint64_t* set)
+{
+	for (size_t i = 0; i < builder->position_count; i++)
+	{
+		if (builder->positions[i].pattern == -1 && builder->positions[i].op == PATTERN_STAR && has_position(set, i))
+		{
+			add_position(set, i + 1);
+		}
+	}
+}
+
+// returns 0 if no position is reached
+static int step_positions(const struct SetBuilder* builder, const uint64_t* from, unsigned char c, uint64_t* to)
+{
+	int reached = 0;
+
+	memset(to, 0, builder->words * sizeof(uint64_t));
+
+	for (size_t i = 0; i < builder->position_count; i++)
+	{
+		const struct Position* position = builder->positions + i;
+
+		if (position->pattern == -1 && has_position(from, i) && position_accepts(position, c))
+		{
+			add_position(to, position->op == PATTERN_STAR ? i : i + 1);
+			reached = 1;
+		}
+	}
+
+	close_positions(builder, to);
+
+	return reached;
+}
+
+static size_t hash_positions(const struct SetBuilder* builder, const uint64_t* set)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < builder->words; i++)
+	{
+		hash = (hash ^ set[i]) * 1099511628211ULL;
+	}
+
+	return (size_t)(hash ^ (hash >> 29)) & (builder->table_size - 1);
+}
+
+static void insert_state(struct SetBuilder* builder, int32_t state)
+{
+	size_t slot = hash_positions(builder, builder->states + (size_t)state * builder->words);
+
+	while (builder->table[slot] != -1)
+	{
+		slot = (slot + 1) & (builder->table_size - 1);
+	}
+
+	builder->table[slot] = state;
+}
+
+static void grow_states(struct SetBuilder* builder)
+{
+	builder->capacity <<= 1;
+	builder->states = realloc(builder->states, builder->capacity * builder->words * sizeof(uint64_t));
+	builder->transitions = realloc(builder->transitions, builder->capacity * builder->class_count * sizeof(int32_t));
+
+	builder->table_size = builder->capacity << 1;
+	builder->table = realloc(builder->table, builder->table_size * sizeof(int32_t));
+	memset(builder->table, -1, builder->table_size * sizeof(int32_t));
+
+	for (size_t i = 0; i < builder->state_count; i++)
+	{
+		insert_state(builder, (int32_t)i);
+	}
+}
+
+// returns the index of the state with the positions, -1 if there would be too many states
+static int32_t find_state(struct SetBuilder* builder, const uint64_t* set)
+{
+	size_t slot = hash_positions(builder, set);
+
+	for (; builder->table[slot] != -1; slot = (slot + 1) & (builder->table_size - 1))
+	{
+		if (!memcmp(builder->states + (size_t)builder->table[slot] * builder->words, set, builder->words * sizeof(uint64_t)))
+		{
+			return builder->table[slot];
+		}
+	}
+
+	if (builder->state_count == PATTERN_SET_MAX_STATES)
+	{
+		return -1;
+	}
+
+	if (builder->state_count == builder->capacity)
+	{
+		grow_states(builder);
+	}
+
+	int32_t state = (int32_t)builder->state_count++;
+	memcpy(builder->states + (size_t)state * builder->words, set, builder->words * sizeof(uint64_t));
+	insert_state(builder, state);
+
+	return state;
+}
+
+// each position that takes particular bytes splits the classes into the bytes it takes and the others
+static size_t compute_classes(const struct SetBuilder* builder, unsigned char* classes)
+{
+	size_t class_count = 1;
+
+	memset(classes, 0, 256);
+
+	for (size_t i = 0; i < builder->position_count; i++)
+	{
+		const struct Position* position = builder->positions + i;
+
+		if (position->pattern != -1 || (position->op != PATTERN_LITERAL && position->op != PATTERN_CLASS))
+		{
+			continue;
+		}
+
+		int split[512];
+		memset(split, -1, sizeof(split));
+		class_count = 0;
+
+		for (int c = 0; c < 256; c++)
+		{
+			int key = classes[c] * 2 + (position_accepts(position, (unsigned char)c) ? 1 : 0);
+
+			if (split[key] == -1)
+			{
+				split[key] = (int)class_count++;
+			}
+
+			classes[c] = (unsigned char)split[key];
+		}
+	}
+
+	return class_count;
+}
+
+static void add_positions(struct SetBuilder* builder, const struct Pattern* pattern, long indx)
+{
+	for (size_t i = 0; i < pattern->size; i++)
+	{
+		const struct PatternElement* element = pattern->elements + i;
+		size_t bytes = element->op == PATTERN_LITERAL ? element->size : 1;
+
+		for (size_t j = 0; j < bytes; j++)
+		{
+			struct Position* position = builder->positions + builder->position_count++;
+			position->op = element->op;
+			position->byte = element->op == PATTERN_LITERAL ? (unsigned char)element->text[j] : 0;
+			position->set = element->set;
+			position->pattern = -1;
+		}
+	}
+
+	builder->positions[builder->position_count++].pattern = indx;
+}
+
+struct PatternSet* compile_pattern_set(struct Arena* arena, struct Pattern** patterns, size_t count)
+{
+	struct SetBuilder builder = { 0 };
+	size_t position_count = 0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		position_count += patterns[i] ? patterns[i]->min_length + (size_t)patterns[i]->stars + 1 : 0;
+	}
+
+	builder.positions = calloc(position_count + 1, sizeof(struct Position));
+	builder.words = position_count / 64 + 1;
+
+	uint64_t* start = calloc(builder.words * 2, sizeof(uint64_t));
+	uint64_t* next = start + builder.words;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (patterns[i])
+		{
+			add_position(start, builder.position_count);
+			add_positions(&builder, patterns[i], (long)i);
+		}
+	}
+
+	close_positions(&builder, start);
+
+	struct PatternSet* set = arena_alloc(arena, sizeof(struct PatternSet));
+	set->class_count = compute_classes(&builder, set->classes);
+
+	unsigned char representatives[256];
+
+	for (int c = 255; c >= 0; c--)
+	{
+		representatives[set->classes[c]] = (unsigned char)c;
+	}
+
+	builder.class_count = set->class_count;
+	builder.capacity = 8;
+	grow_states(&builder);
+	find_state(&builder, start);
+
+	for (size_t state = 0; state < builder.state_count && set; state++)
+	{
+		for (size_t class = 0; class < set->class_count; class++)
+		{
+			int32_t target = -1;
+
+			if (step_positions(&builder, builder.states + state * builder.words, representatives[class], next) &&
+				(target = find_state(&builder, next)) == -1)
+			{
+				set = NULL; // too many states
+				break;
+			}
+
+			builder.transitions[state * builder.class_count + class] = target;
+		}
+	}
+
+	if (set)
+	{
+		set->state_count = builder.state_count;
+		set->transitions = arena_alloc(arena, builder.state_count * set->class_count * sizeof(int32_t));
+		set->matches = arena_alloc(arena, builder.state_count * sizeof(int32_t));
+		memcpy(set->transitions, builder.transitions, builder.state_count * set->class_count * sizeof(int32_t));
+
+		for (size_t state = 0; state < builder.state_count; state++)
+		{
+			const uint64_t* positions = builder.states + state * builder.words;
+			set->matches[state] = -1;
+
+			for (size_t i = 0; i < builder.position_count; i++) // accepting positions are in the order of the patterns
+			{
+				if (builder.positions[i].pattern != -1 && has_position(positions, i))
+				{
+					set->matches[state] = (int32_t)builder.positions[i].pattern;
+					break;
+				}
+			}
+		}
+	}
+
+	free(builder.positions);
+	free(builder.states);
+	free(builder.table);
+	free(builder.transitions);
+	free(start);
+
+	return set;
+}
+
+long match_pattern_set(const struct PatternSet* set, const char* string, size_t length)
+{
+	int32_t state = 0;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		state = set->transitions[(size_t)state * set->class_count + set->classes[(unsigned char)string[i]]];
+
+		if (state == -1)
+		{
+			return -1;
+		}
+	}
+
+	return set->matches[state];
+}
@@ -1,52 +1,166 @@
 #include "scanner.h"
 #include <string.h>
+#include <stdint.h>
 
-struct Keyword
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SCANNER_SIMD
+#endif
+
+#define CC_BLANK 1 // ' ', '\t'
+#define CC_SEPARATOR 2 // ' ', '\t', '\n', '\0'
+#define CC_DELIM 4 // characters that end a word
+#define CC_SPECIAL 8 // characters handled by a case of get_next_token()
+#define CC_PATTERN 16 // '*', '?', '[', pathname expansion may apply to the word
+#define CC_BRACE 32 // '{', brace expansion may apply to the word
+
+#define CC_WORD_END (CC_DELIM | CC_SPECIAL | CC_PATTERN | CC_BRACE) // characters that end a run of ordinary characters
+
+static const unsigned char char_class[256] =
 {
-	enum TokenType type;
-	const char* word;
+	['\0'] = CC_SEPARATOR | CC_DELIM,
+	[' '] = CC_BLANK | CC_SEPARATOR | CC_DELIM,
+	['\t'] = CC_BLANK | CC_SEPARATOR | CC_DELIM,
+	['\n'] = CC_SEPARATOR | CC_DELIM | CC_SPECIAL,
+	['|'] = CC_DELIM | CC_SPECIAL,
+	[';'] = CC_DELIM | CC_SPECIAL,
+	['&'] = CC_DELIM | CC_SPECIAL,
+	[')'] = CC_DELIM | CC_SPECIAL,
+	['$'] = CC_SPECIAL,
+	['<'] = CC_SPECIAL,
+	['>'] = CC_SPECIAL,
+	['='] = CC_SPECIAL,
+	['\''] = CC_SPECIAL,
+	['"'] = CC_SPECIAL,
+	['*'] = CC_PATTERN,
+	['?'] = CC_PATTERN,
+	['['] = CC_PATTERN,
+	['{'] = CC_BRACE
 };
 
-static const struct Keyword keywords[] = 
+static int has_class(char c, unsigned char cc)
 {
-	{ IF, "if" },
-	{ ELSE, "else" },
-	{ FI, "fi" },
-	{ THEN, "then" },
-	{ WHILE, "while" },
-	{ DO, "do" },
-	{ DONE, "done" },
-	{ FOR, "for" },
-	{ IN, "in" }
-};
+	return char_class[(unsigned char)c] & cc;
+}
 
-static const size_t keywords_numb = sizeof(keywords) / sizeof(struct Keyword);
+/*
+	find_word_end(p) returns the first character at or after p that isn't an ordinary word character.
+	The SIMD versions test a cheap superset of CC_WORD_END (every byte <= '*', ';'..'?', '[', '{' and '|')
+	16 or 32 bytes at a time and confirm a candidate with char_class. They use aligned loads only,
+	so they never read across a page boundary past the terminating '\0'.
+*/
+static const char* scalar_find_word_end(const char* p)
+{
+	while (!has_class(*p, CC_WORD_END))
+	{
+		p++;
+	}
+
+	return p;
+}
 
-static void free_buffer(struct Buffer* buffer)
+#ifdef SCANNER_SIMD
+static unsigned sse2_candidates(__m128i v)
 {
-	free(buffer->buffer);
-	buffer->capacity = 0;
-	buffer->size = 0;
-	buffer->buffer = NULL;
+	__m128i low = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8('*')), v);
+	__m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8(';'));
+	__m128i range = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8('?' - ';')), shifted);
+	__m128i brackets = _mm_cmpeq_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('{')); // '[' or '{'
+	__m128i pipe = _mm_cmpeq_epi8(v, _mm_set1_epi8('|'));
+
+	return (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(low, range), _mm_or_si128(brackets, pipe)));
 }
 
-static void is_keyword(struct Token* token)
+static const char* sse2_find_word_end(const char* p)
 {
-	if (!token->word.buffer)
+	size_t misalignment = (uintptr_t)p & 15;
+	const char* block = p - misalignment;
+	unsigned mask = sse2_candidates(_mm_load_si128((const __m128i*)block)) >> misalignment << misalignment;
+
+	while (1)
 	{
-		return;
+		while (!mask)
+		{
+			block += 16;
+			mask = sse2_candidates(_mm_load_si128((const __m128i*)block));
+		}
+
+		const char* candidate = block + __builtin_ctz(mask);
+		if (has_class(*candidate, CC_WORD_END))
+		{
+			return candidate;
+		}
+
+		mask &= mask - 1;
 	}
+}
+
+__attribute__((target("avx2")))
+static unsigned avx2_candidates(__m256i v)
+{
+	__m256i low = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8('*')), v);
+	__m256i shifted = _mm256_sub_epi8(v, _mm256_set1_epi8(';'));
+	__m256i range = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8('?' - ';')), shifted);
+	__m256i brackets = _mm256_cmpeq_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('{')); // '[' or '{'
+	__m256i pipe = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('|'));
+
+	return (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(low, range), _mm256_or_si256(brackets, pipe)));
+}
+
+__attribute__((target("avx2")))
+static const char* avx2_find_word_end(const char* p)
+{
+	size_t misalignment = (uintptr_t)p & 31;
+	const char* block = p - misalignment;
+	unsigned mask = avx2_candidates(_mm256_load_si256((const __m256i*)block)) >> misalignment << misalignment;
 
-	for (size_t i = 0; i < keywords_numb; i++)
+	while (1)
 	{
-		if (!strcmp(keywords[i].word, token->word.buffer))
+		while (!mask)
 		{
-			free_buffer(&token->word);
-			token->type = keywords[i].type;
-			return;
+			block += 32;
+			mask = avx2_candidates(_mm256_load_si256((const __m256i*)block));
+		}
+
+		const char* candidate = block + __builtin_ctz(mask);
+		if (has_class(*candidate, CC_WORD_END))
+		{
+			return candidate;
 		}
+
+		mask &= mask - 1;
 	}
 }
+#endif
+
+static const char* select_find_word_end(const char* p);
+
+static const char* (*find_word_end)(const char*) = select_find_word_end;
+
+// picks the implementation on the first call, SMSH_SCANNER=scalar disables SIMD
+static const char* select_find_word_end(const char* p)
+{
+	find_word_end = scalar_find_word_end;
+
+#ifdef SCANNER_SIMD
+	const char* forced = getenv("SMSH_SCANNER");
+
+	if (!forced || strcmp(forced, "scalar"))
+	{
+		__builtin_cpu_init();
+		find_word_end = __builtin_cpu_supports("avx2") ? avx2_find_word_end : sse2_find_word_end;
+	}
+#endif
+
+	return find_word_end(p);
+}
+
+static void free_buffer(struct Buffer* buffer) // the memory is released with the scanner's arena
+{
+	buffer->capacity = 0;
+	buffer->size = 0;
+	buffer->buffer = NULL;
+}
 
 static void free_token(struct Token* token)
 {
@@ -54,30 +168,128 @@ static void free_token(struct Token* token)
 	token->type = END;
 }
 
+static int is_word(struct Buffer* word, const char* keyword, size_t length)
+{
+	return word->size == length && !memcmp(word->buffer, keyword, length);
+}
+
+// keywords are told apart by their length and first character, so a word is compared with two keywords at most (else and esac)
+static void is_keyword(struct Token* token)
+{
+	struct Buffer* word = &token->word;
+	enum TokenType type = WORD;
+
+	switch (word->size)
+	{
+		case 2:
+		{
+			switch (word->buffer[0])
+			{
+				case 'i': type = word->buffer[1] == 'f' ? IF : word->buffer[1] == 'n' ? IN : WORD; break;
+				case 'f': type = word->buffer[1] == 'i' ? FI : WORD; break;
+				case 'd': type = word->buffer[1] == 'o' ? DO : WORD; break;
+			}
+		} break;
+		case 3:
+		{
+			type = is_word(word, "for", 3) ? FOR : WORD;
+		} break;
+		case 4:
+		{
+			switch (word->buffer[0])
+			{
+				case 't': type = is_word(word, "then", 4) ? THEN : WORD; break;
+				case 'e': type = is_word(word, "else", 4) ? ELSE : is_word(word, "esac", 4) ? ESAC : WORD; break;
+				case 'd': type = is_word(word, "done", 4) ? DONE : WORD; break;
+				case 'c': type = is_word(word, "case", 4) ? CASE : WORD; break;
+			}
+		} break;
+		case 5:
+		{
+			type = is_word(word, "while", 5) ? WHILE : WORD;
+		} break;
+	}
+
+	if (type != WORD)
+	{
+		free_buffer(word);
+		token->type = type;
+	}
+}
+
 void init_buffer(struct Buffer* buffer)
 {
 	buffer->size = 0;
-	buffer->capacity = BUF_CAP;
-	buffer->buffer = malloc(BUF_CAP);
+	buffer->capacity = 0;
+	buffer->buffer = NULL;
 }
 
-void append_char(struct Buffer* buffer, char c)
+// appends the n characters starting at c, a slice only grows if they follow its end
+static void append_chars(struct Arena* arena, struct Buffer* buffer, const char* c, size_t n)
 {
-	if (buffer->size >= buffer->capacity)
+	if (!buffer->capacity)
 	{
-		buffer->capacity <<= 1;
-		buffer->buffer = realloc(buffer->buffer, buffer->capacity);
+		if (!buffer->size)
+		{
+			buffer->buffer = (char*)c;
+		}
+
+		if (buffer->buffer + buffer->size == c)
+		{
+			buffer->size += n;
+			return;
+		}
+
+		// the word isn't contiguous in the scanned text anymore, so it gets its own storage
+		size_t capacity = BUF_CAP;
+		while (capacity <= buffer->size + n)
+		{
+			capacity <<= 1;
+		}
+
+		char* storage = arena_alloc(arena, capacity);
+		memcpy(storage, buffer->buffer, buffer->size);
+		buffer->buffer = storage;
+		buffer->capacity = capacity;
 	}
 
-	buffer->buffer[buffer->size++] = c;
+	if (buffer->size + n > buffer->capacity)
+	{
+		size_t capacity = buffer->capacity;
+		while (capacity < buffer->size + n)
+		{
+			capacity <<= 1;
+		}
+
+		buffer->buffer = arena_realloc(arena, buffer->buffer, buffer->capacity, capacity);
+		buffer->capacity = capacity;
+	}
+
+	memcpy(buffer->buffer + buffer->size, c, n);
+	buffer->size += n;
+}
+
+// NUL-terminates a buffer that owns its storage, the terminator isn't counted in size
+static void terminate_buffer(struct Arena* arena, struct Buffer* buffer)
+{
+	append_chars(arena, buffer, "", 1);
+	buffer->size--;
+}
+
+void append_char(struct Arena* arena, struct Buffer* buffer, const char* c)
+{
+	append_chars(arena, buffer, c, 1);
 }
 
 // reads symbols from buffer from position until encountered terminating quote(returns 1 in that case) or '\0'(returns 0)
-int handle_quotes(char quote, size_t* position, const char* buffer, struct Token* token, int* contains_quotes)
+int handle_quotes(struct Arena* arena, char quote, size_t* position, const char* buffer, struct Token* token, int* contains_quotes)
 {
-	while (buffer[*position] != quote && buffer[*position] != '\0')
+	const char* end = strchrnul(buffer + *position, quote);
+
+	if (end != buffer + *position)
 	{
-		append_char(&token->word, buffer[(*position)++]);
+		append_chars(arena, &token->word, buffer + *position, end - (buffer + *position));
+		*position = end - buffer;
 	}
 
 	if (buffer[*position] == '\0')
@@ -92,11 +304,11 @@ int handle_quotes(char quote, size_t* position, const char* buffer, struct Token
 	return 1;
 }
 
-int handle_io_redirect(char redirect, const char* buffer, size_t* position, int contains_quotes, struct Token* token)
+int handle_io_redirect(struct Arena* arena, char redirect, const char* buffer, size_t* position, int contains_quotes, struct Token* token)
 {
 	if (contains_quotes)
 	{
-		append_char(&token->word, redirect);
+		append_char(arena, &token->word, buffer + *position - 1);
 		return 1;
 	}
 
@@ -106,7 +318,7 @@ int handle_io_redirect(char redirect, const char* buffer, size_t* position, int
 	}
 	else
 	{
-		if (buffer[*position] != ' ' && buffer[*position] != '\t' && buffer[*position] != '\0' && buffer[*position] != '\n')
+		if (!has_class(buffer[*position], CC_SEPARATOR))
 		{
 			(*position)--;
 		}
@@ -115,10 +327,66 @@ int handle_io_redirect(char redirect, const char* buffer, size_t* position, int
 	return 0;
 }
 
+static int is_quoted_special(char c)
+{
+	return has_class(c, CC_PATTERN) || c == '\\';
+}
+
+// begin and end enclose the scanned text of a word, a backslash is put before each quoted pattern character
+static const char* quoted_pattern(struct Arena* arena, const char* begin, const char* end)
+{
+	size_t escapes = 0;
+	char quote = 0;
+
+	for (const char* p = begin; p < end; p++)
+	{
+		if (quote ? *p == quote : (*p == '\'' || *p == '"'))
+		{
+			quote = quote ? 0 : *p;
+		}
+		else
+		{
+			escapes += quote && is_quoted_special(*p);
+		}
+	}
+
+	if (!escapes)
+	{
+		return NULL;
+	}
+
+	char* pattern = arena_alloc(arena, (size_t)(end - begin) + escapes + 1);
+	char* q = pattern;
+	quote = 0;
+
+	for (const char* p = begin; p < end; p++)
+	{
+		if (quote ? *p == quote : (*p == '\'' || *p == '"'))
+		{
+			quote = quote ? 0 : *p;
+			continue;
+		}
+
+		if (quote && is_quoted_special(*p))
+		{
+			*q++ = '\\';
+		}
+
+		*q++ = *p;
+	}
+
+	*q = '\0';
+
+	return pattern;
+}
+
 struct Token get_next_token(struct Scanner* scanner, int* arithm_expr_beginning)
 {
 	struct Token token;
 	token.type = END;
+	token.glob = 0;
+	token.brace = 0;
+	token.pattern = NULL;
 
 	if (!skip_delim(scanner))
 	{
@@ -151,6 +419,25 @@ struct Token get_next_token(struct Scanner* scanner, int* arithm_expr_beginning)
 					}
 
 					token.type = PARAMETER_EXPANSION;
+
+					if (buffer[position] == '{') // ${...} may contain '$' and separators, it's taken up to the matching '}'
+					{
+						size_t end = position;
+
+						for (int depth = 0; buffer[end] && buffer[end] != '\n'; end++)
+						{
+							depth += buffer[end] == '{' ? 1 : buffer[end] == '}' ? -1 : 0;
+
+							if (!depth)
+							{
+								end++;
+								break;
+							}
+						}
+
+						append_chars(scanner->arena, &token.word, buffer + position, end - position);
+						position = end;
+					}
 				}
 				else
 				{
@@ -160,23 +447,22 @@ struct Token get_next_token(struct Scanner* scanner, int* arithm_expr_beginning)
 			} break;
 			case '<':
 			{
-				running = handle_io_redirect(c, buffer, &position, contains_quotes, &token);
+				running = handle_io_redirect(scanner->arena, c, buffer, &position, contains_quotes, &token);
 			} break;
 			case '>':
 			{
-				running = handle_io_redirect(c, buffer, &position, contains_quotes, &token);
+				running = handle_io_redirect(scanner->arena, c, buffer, &position, contains_quotes, &token);
 			} break;
 			case '=':
 			{
-				if (!contains_quotes && token.word.size && buffer[position] != ' ' && buffer[position] != '\n'
-					&& buffer[position] != '\0' && buffer[position] != '\t')
+				if (!contains_quotes && token.word.size && !has_class(buffer[position], CC_SEPARATOR))
 				{
 					token.type = NAME;
 					running = 0;
 				}
 				else
 				{
-					append_char(&token.word, c);
+					append_char(scanner->arena, &token.word, buffer + position - 1);
 				}
 			} break;
 			case '|':
@@ -193,6 +479,17 @@ struct Token get_next_token(struct Scanner* scanner, int* arithm_expr_beginning)
 			{
 				token.type = SEQ_LIST;
 				running = 0;
+
+				if (buffer[position] == ';')
+				{
+					token.type = DSEMI;
+					position++;
+				}
+			} break;
+			case ')':
+			{
+				token.type = RPAR;
+				running = 0;
 			} break;
 			case '\n':
 			{
@@ -201,20 +498,23 @@ struct Token get_next_token(struct Scanner* scanner, int* arithm_expr_beginning)
 			} break;
 			case 39:
 			{
-				running = handle_quotes(c, &position, buffer, &token, &contains_quotes);
+				running = handle_quotes(scanner->arena, c, &position, buffer, &token, &contains_quotes);
 			} break;
 			case 34:
 			{
-				running = handle_quotes(c, &position, buffer, &token, &contains_quotes);
+				running = handle_quotes(scanner->arena, c, &position, buffer, &token, &contains_quotes);
 			} break;
-			default:
+			default: // takes the whole run of ordinary characters at once, a run begins at '*', '?', '[' or '{'
 			{
-				append_char(&token.word, c);
+				const char* end = find_word_end(buffer + position);
+				token.glob |= has_class(c, CC_PATTERN); // quoted characters don't count
+				token.brace |= has_class(c, CC_BRACE);
+				append_chars(scanner->arena, &token.word, buffer + position - 1, end - buffer - position + 1);
+				position = end - buffer;
 			} break;
 		}
 
-		if (buffer[position] == ' ' || buffer[position] == '\n' || buffer[position] == '\t' || buffer[position] == '|' || buffer[position] == '\0'
-			                        || buffer[position] == ';'  || buffer[position] == '&')
+		if (has_class(buffer[position], CC_DELIM))
 		{
 			break;
 		}
@@ -222,12 +522,23 @@ struct Token get_next_token(struct Scanner* scanner, int* arithm_expr_beginning)
 
 	if (token.type == WORD || token.type == NAME || token.type == PARAMETER_EXPANSION) // if token.type == END then error occurred during handling quotes
 	{
-		append_char(&token.word, '\0');
+		if (token.word.capacity)
+		{
+			terminate_buffer(scanner->arena, &token.word);
+		}
+		else if (!token.word.size)
+		{
+			token.word.buffer = (char*)buffer + position; // an empty slice
+		}
 
-		if (!contains_quotes)
+		if (token.type == WORD && !contains_quotes)
 		{
 			is_keyword(&token); // changes token.type if keyword
 		}
+		else if (token.type == WORD)
+		{
+			token.pattern = quoted_pattern(scanner->arena, buffer + scanner->position, buffer + position);
+		}
 	}
 	else
 	{
@@ -241,7 +552,7 @@ struct Token get_next_token(struct Scanner* scanner, int* arithm_expr_beginning)
 
 int skip_delim(struct Scanner* scanner)
 {
-	while (scanner->buffer[scanner->position] == ' ' || scanner->buffer[scanner->position] == '\t')
+	while (has_class(scanner->buffer[scanner->position], CC_BLANK))
 	{
 		scanner->position++;
 	}
@@ -263,7 +574,7 @@ static void arithm_read_param_exp(struct Scanner* scanner, struct Token* token)
 
 		if (c != ' ' && c != '\t' && c != '\n' && c != '\0' && c != ')' && c != '/' && c != '*' && c != '+' && c != '-')
 		{
-			append_char(&token->word, c);
+			append_char(scanner->arena, &token->word, buffer + position);
 		}
 		else
 		{
@@ -278,7 +589,6 @@ static void arithm_read_param_exp(struct Scanner* scanner, struct Token* token)
 	else
 	{
 		token->type = PARAMETER_EXPANSION;
-		append_char(&token->word, '\0');
 	}
 
 	scanner->position = position;
@@ -288,6 +598,9 @@ struct Token arithm_get_next_token(struct Scanner* scanner, int* arithm_expr_end
 {
 	struct Token token;
 	token.type = END;
+	token.glob = 0;
+	token.brace = 0;
+	token.pattern = NULL;
 
 	if (!skip_delim(scanner))
 	{
@@ -352,7 +665,7 @@ void arithm_read_integer(struct Scanner* scanner, struct Token* token)
 	{
 		if (c >= '0' && c <= '9')
 		{
-			append_char(&token->word, c);
+			append_char(scanner->arena, &token->word, buffer + position);
 		}
 		else
 		{
@@ -362,8 +675,7 @@ void arithm_read_integer(struct Scanner* scanner, struct Token* token)
 
 	if (token->word.size && buffer[position] != '\0')
 	{
-		append_char(&token->word, '\0');
-		token->type = INTEGER;
+		token->type = INTEGER; // the slice is followed by a non-digit, so strtoll() stops at its end
 	}
 	else
 	{
@@ -373,10 +685,23 @@ void arithm_read_integer(struct Scanner* scanner, struct Token* token)
 	scanner->position = position;
 }
 
-void copy_token(struct Token* dest, struct Token* src)
+const char* pattern_text(const struct Token* token)
+{
+	return token->pattern ? token->pattern : token->word.buffer;
+}
+
+void copy_token(struct Arena* arena, struct Token* dest, struct Token* src)
 {
 	dest->type = src->type;
-	dest->word.buffer = src->word.buffer;
-	dest->word.capacity = src->word.capacity;
-	dest->word.size = src->word.size;
+	dest->word = src->word;
+	dest->glob = src->glob;
+	dest->brace = src->brace;
+	dest->pattern = src->pattern;
+
+	if (src->word.buffer && !src->word.capacity)
+	{
+		dest->word.buffer = arena_alloc(arena, src->word.size + 1);
+		dest->word.capacity = src->word.size + 1;
+		memcpy(dest->word.buffer, src->word.buffer, src->word.size);
+	}
 }
\ No newline at end of file
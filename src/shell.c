@@ -1,15 +1,31 @@
 #include "shell.h"
 #include "utility.h"
 #include "builtin.h"
+#include "bytecode.h"
+#include "cache.h"
 #include <unistd.h>
+#include <spawn.h>
 #include <signal.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <stdio_ext.h>
+#include <malloc.h>
 
 #define DEFAULT_HASHTABLE_SIZE 128
+#define COMMANDS_HASHTABLE_SIZE 64
 #define IO_REDIRECT_ERROR_MES "can't execute I/O redirection"
+#define REAP_INTERVAL 1023 // loop iterations between checks for exited children, plus one
+#define SAVED_FD_MIN 10 // the shell's standard input and output are saved above the descriptors scripts use
+#define SCRIPT_RELEASE_SIZE (1 << 20) // parsed part of a script is dropped from memory in steps of this size
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 35))
+#define HAVE_SPAWN_TCSETPGRP // posix_spawn() can make the child the foreground process group
+#endif
 
 extern char** environ;
 
@@ -41,7 +57,9 @@ int shell_init(struct Shell* shell)
 		return 1;
 	}
 
-	return 0;
+	shell->pgid = getpgrp(); // a script whose standard input is a file or a pipe runs without the terminal
+
+	return 1;
 }
 
 static void init_from_env(struct Shell* shell)
@@ -77,10 +95,15 @@ struct Shell* create()
 	shell->scanner = calloc(1, sizeof(struct Scanner));
 	shell->execution_error = calloc(1, sizeof(struct Error));
 	shell->variables = create_hashtable(DEFAULT_HASHTABLE_SIZE);
-	shell->jobs = create_list(destroy_job);
+	shell->commands = create_hashtable(COMMANDS_HASHTABLE_SIZE);
+	shell->job_control = create_job_control();
+	shell->use_script_cache = 1;
 
 	shell->parser->scanner = shell->scanner;
 	shell->parser->error = calloc(1, sizeof(struct Error));
+	shell->parser->arena = create_arena();
+	shell->scanner->arena = shell->parser->arena;
+	shell->scratch = create_arena();
 
 	init_from_env(shell);
 
@@ -94,12 +117,19 @@ void destroy(struct Shell* shell)
 		destroy_error(shell->parser->error);
 		destroy_error(shell->execution_error);
 
+		destroy_arena(&shell->parser->arena);
+		destroy_arena(&shell->scratch);
+		free_output(&shell->output);
+		free(shell->expansion);
+		free_paths(&shell->paths);
+		release_input(&shell->input, STDIN_FILENO); // the rest of the input is left for the next reader
+		free_input(&shell->input);
 		free(shell->parser);
 		free(shell->scanner);
 
-		destroy_list(&shell->program);
-		destroy_list(&shell->jobs);
+		destroy_job_control(&shell->job_control);
 		destroy_hashtable(&shell->variables);
+		destroy_hashtable(&shell->commands);
 	}
 }
 
@@ -111,10 +141,43 @@ void init_parser(struct Shell* shell, char* buffer)
 	shell->parser->current_token = get_next_token(shell->scanner, &shell->parser->parsing_arithm_expr);
 }
 
+void rehash_commands(struct Shell* shell)
+{
+	destroy_hashtable(&shell->commands);
+	shell->commands = create_hashtable(COMMANDS_HASHTABLE_SIZE);
+}
+
+static void store_value(char** value, const char* var_value)
+{
+	if (*value != var_value) // 'a=$a'
+	{
+		size_t size = strlen(var_value) + 1;
+
+		if (malloc_usable_size(*value) < size) // a loop's variable keeps its buffer
+		{
+			*value = realloc(*value, size);
+		}
+
+		memcpy(*value, var_value, size);
+
+		struct Array* array = value_array(value);
+
+		if (array && array->size) // name=value changes the first item of an array
+		{
+			array->items[0] = *value;
+		}
+	}
+}
+
 int set_variable(struct Shell* shell, const char* var_name, const char* var_value)
 {
 	char** value = get(shell->variables, var_name);
 
+	if (!strcmp(var_name, "PATH"))
+	{
+		rehash_commands(shell);
+	}
+
 	if (!value)
 	{
 		insert(shell->variables, var_name, var_value);
@@ -122,13 +185,50 @@ int set_variable(struct Shell* shell, const char* var_name, const char* var_valu
 	}
 	else
 	{
-		size_t size = strlen(var_value) + 1;
-		*value = realloc(*value, size);
-		memcpy(*value, var_value, size);
+		store_value(value, var_value);
 		return 1;
 	}
 }
 
+// set_variable() for names known at parse time, cache remembers the variable's entry
+static void assign_variable(struct Shell* shell, const char* var_name, struct LookupCache* cache, const char* var_value)
+{
+	char** value = cached_get(shell->variables, var_name, cache);
+
+	if (!value)
+	{
+		set_variable(shell, var_name, var_value);
+		return;
+	}
+
+	if (!strcmp(var_name, "PATH"))
+	{
+		rehash_commands(shell);
+	}
+
+	store_value(value, var_value);
+}
+
+void set_array(struct Shell* shell, const char* var_name, struct Array* array)
+{
+	if (!strcmp(var_name, "PATH"))
+	{
+		rehash_commands(shell);
+	}
+
+	insert_array(shell->variables, var_name, array);
+}
+
+void unset_variable(struct Shell* shell, const char* var_name)
+{
+	if (!strcmp(var_name, "PATH"))
+	{
+		rehash_commands(shell);
+	}
+
+	erase(shell->variables, var_name);
+}
+
 const char* get_variable(struct Shell* shell, const char* var_name)
 {
 	char** value = get(shell->variables, var_name);
@@ -168,305 +268,801 @@ static const char* expand_token(struct Shell* shell, struct Token* token)
 	}
 }
 
-static int is_integer(const char* string)
+static char* reserve_expansion(struct Shell* shell, size_t size)
 {
-	if (*string == '-' || (*string >= '0' && *string <= '9'))
+	if (size > shell->expansion_capacity)
 	{
-		string++;
+		shell->expansion_capacity = size;
+		shell->expansion = realloc(shell->expansion, size);
+	}
 
-		for (; *string; string++)
-		{
-			if (*string < '0' || *string > '9')
-			{
-				return 0;
-			}
-		}
+	return shell->expansion;
+}
 
-		return 1;
+// the value of an operand, an unset variable is empty
+static const char* operand_value(struct Shell* shell, struct ParamOperand* operand)
+{
+	if (operand->name)
+	{
+		const char* value = get_variable(shell, operand->name);
+		return value ? value : "";
 	}
 
-	return 0;
+	return operand->text ? operand->text : "";
 }
 
-int execute_arithm_expr(struct Shell* shell, struct AstArithmExpr* arithm_expr)
+/*
+	The first and the number of the items (or characters) of ${name:offset:length} among size ones.
+	Negative offset counts from the end, negative length is the number of items left out at the end,
+	more items left out than there are is an expansion error.
+*/
+static int get_slice(struct Shell* shell, struct ParamExp* exp, size_t size, size_t* first, size_t* count)
 {
-	switch (arithm_expr->token.type)
+	long offset = strtol(operand_value(shell, &exp->offset), NULL, 10);
+
+	if (offset < 0)
 	{
-		case INTEGER:
-		{
-			return atoi(arithm_expr->token.word.buffer);
-		} break;
-		case PARAMETER_EXPANSION:
-		{
-			const char* value = expand_token(shell, &arithm_expr->token);
+		offset += (long)size;
+	}
 
-			if (is_integer(value))
-			{
-				return atoi(value);
-			}
-			else
-			{
-				if (!shell->execution_error->error)
-				{
-					set_error(shell->execution_error, "invalid parameter expansion inside arithmetic expansion!");
-				}
-			}
-		} break;
-		case MULTIPLY:
-		{
-			return execute_arithm_expr(shell, arithm_expr->left) * execute_arithm_expr(shell, arithm_expr->right);
-		} break;
-		case DIVIDE:
-		{
-			return execute_arithm_expr(shell, arithm_expr->left) / execute_arithm_expr(shell, arithm_expr->right);
-		} break;
-		case PLUS:
+	if (offset < 0 || (size_t)offset > size)
+	{
+		return 0;
+	}
+
+	*first = (size_t)offset;
+	*count = size - *first;
+
+	if (exp->length.text || exp->length.name)
+	{
+		const char* value = operand_value(shell, &exp->length);
+		long length = strtol(value, NULL, 10);
+
+		if (length < 0)
 		{
-			if (arithm_expr->right)
-			{
-				return execute_arithm_expr(shell, arithm_expr->left) + execute_arithm_expr(shell, arithm_expr->right);
-			}
-			else
-			{
-				return execute_arithm_expr(shell ,arithm_expr->left);
-			}
-		} break;
-		case MINUS:
+			length += (long)*count;
+		}
+
+		if (length < 0)
 		{
-			if (arithm_expr->right)
-			{
-				return execute_arithm_expr(shell, arithm_expr->left) - execute_arithm_expr(shell, arithm_expr->right);
-			}
-			else
+			if (!shell->execution_error->error)
 			{
-				return -execute_arithm_expr(shell, arithm_expr->left);
+				char* error_mes = concat_strings(value, ": substring expression < 0");
+				set_error(shell->execution_error, error_mes);
+				free(error_mes);
 			}
-		} break;
-		default: break;
+
+			return 0;
+		}
+
+		*count = (size_t)length < *count ? (size_t)length : *count;
 	}
 
-	return 0;
+	return 1;
 }
 
-static char* expand_arithm_expr(struct Shell* shell, struct AstArithmExpr* arithm_expr)
+// items of the expanded variable: an array has its items, a string is a single item, an unset variable has none
+static size_t get_items(struct Shell* shell, struct AstWord* word, char*** items)
 {
-	char* exp = calloc(12, sizeof(char)); // int is maximum 11 digits long
-	sprintf(exp, "%d", execute_arithm_expr(shell, arithm_expr));
-	
-	if (shell->execution_error->error)
+	struct ParamExp* exp = word->expansion;
+	char** value = cached_get(shell->variables, exp->name, &word->cache);
+	struct Array* array = value ? value_array(value) : NULL;
+	size_t size = value ? 1 : 0;
+
+	*items = value;
+
+	if (array)
 	{
-		free(exp);
-		return NULL;		
+		*items = array->items;
+		size = array->size;
 	}
 
-	return exp;
+	if (exp->op == PARAM_SUBSTRING && exp->subscript == SUBSCRIPT_ALL) // ${name[@]:offset:length} selects items
+	{
+		size_t first = 0;
+
+		if (!get_slice(shell, exp, size, &first, &size))
+		{
+			return 0;
+		}
+
+		*items += first;
+	}
+
+	return size;
 }
 
-// The exit status of a for command shall be the exit status of the last command that executes
-static int exec_for_loop(struct Shell* shell, struct AstFor* ast_for)
+// ${name[@]} outside of argument lists and for loops, the items are joined by spaces
+static const char* join_items(struct Shell* shell, char** items, size_t size)
 {
-	const char* var_name = ast_for->variable->word.word.buffer;
-	char** value = get(shell->variables, var_name);
-	char* init_value = NULL;
-	int rc = 0;
+	size_t length = 1;
 
-	if (!value)
-	{
-		insert(shell->variables, var_name, "");
-	}
-	else
+	for (size_t i = 0; i < size; i++)
 	{
-		init_value = copy_string(*value);
+		length += strlen(items[i]) + 1;
 	}
 
-	for (struct Node* node = ast_for->wordlist->head; node; node = node->next)
+	char* result = reserve_expansion(shell, length);
+	char* p = result;
+
+	for (size_t i = 0; i < size; i++)
 	{
-		struct AstNode* expr = (struct AstNode*)node->data;
-	
-		if (expr->node_type == AST_WORD)
+		size_t item_length = strlen(items[i]);
+
+		if (i)
 		{
-			struct AstWord* word = expr->actual_data;
-			const char* token_value = expand_token(shell, &word->word);
-			set_variable(shell, var_name, token_value);
+			*p++ = ' ';
 		}
-		else // expr->node_type == AST_ARITHM_EXPR
-		{		
-			char* var_value = expand_arithm_expr(shell, (struct AstArithmExpr*)expr->actual_data);
-	
-			if (shell->execution_error->error)
-			{
-				return 1;
-			}
 
-			set_variable(shell, var_name, var_value);
-			free(var_value);
-		}
+		memcpy(p, items[i], item_length);
+		p += item_length;
+	}
 
-		rc = execute(shell, ast_for->body);
+	*p = '\0';
 
-		if (shell->execution_error->error)
-		{
-			return rc;
-		}
-	}
+	return result;
+}
 
-	if (!value)
-	{
-		erase(shell->variables, var_name);
-	}
-	else
+// adds text to the result of the expansion, the result is length characters long
+static void append_expansion(struct Shell* shell, size_t* length, const char* text, size_t size)
+{
+	if (*length + size + 1 > shell->expansion_capacity)
 	{
-		set_variable(shell, var_name, init_value);
-		free(init_value);
+		reserve_expansion(shell, (*length + size + 1) * 2);
 	}
 
-	return rc;
+	memcpy(shell->expansion + *length, text, size);
+	*length += size;
+	shell->expansion[*length] = '\0';
 }
 
-// The exit status of the while loop shall be the exit status of the last body commands list executed, or zero, if none was executed.
-static int exec_while_loop(struct Shell* shell, struct AstWhile* ast_while)
+// the number at indx of a range written backwards from end, returns its first character
+static const char* format_brace_number(const struct BraceExp* exp, size_t indx, char* end)
 {
-	int rc = 0;
-	int cond = 0;
+	long long number = (long long)((unsigned long long)exp->first + (unsigned long long)indx * (unsigned long long)exp->step);
+	unsigned long long magnitude = number < 0 ? -(unsigned long long)number : (unsigned long long)number;
+	char* p = end;
 
-	while ((cond = execute(shell, ast_while->condition)) == 0)
+	do
 	{
-		rc = execute(shell, ast_while->body);
+		*--p = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude);
 
-		if (shell->execution_error->error)
-		{
-			return rc;
-		}
+	while (end - p < exp->width - (number < 0))
+	{
+		*--p = '0';
 	}
 
-	if (shell->execution_error->error)
+	if (number < 0)
 	{
-		return cond;
+		*--p = '-';
 	}
 
-	return rc;
+	return p;
 }
 
-// The exit status of the if command shall be the exit status of the then or else commands list that was executed, or zero, if none was executed
-static int exec_if(struct Shell* shell, struct AstIf* ast_if)
+// {,a} gives a single word, items without text around them are dropped
+static int is_dropped_brace_item(const struct BraceExp* exp, size_t indx)
+{
+	return exp->items && !exp->sizes[indx] && !exp->prefix_size && !exp->suffix_size;
+}
+
+// the word at indx of a brace expansion, numbers are formatted on the stack and the word is built in shell->expansion
+static const char* expand_brace_item(struct Shell* shell, const struct BraceExp* exp, size_t indx)
 {
-	int rc = execute(shell, ast_if->condition);
+	size_t length = 0;
+	append_expansion(shell, &length, exp->prefix, exp->prefix_size);
 
-	if (!rc)
+	if (exp->items)
 	{
-		rc = execute(shell, ast_if->if_part);
+		append_expansion(shell, &length, exp->items[indx], exp->sizes[indx]);
 	}
 	else
 	{
-		if (shell->execution_error->error)
-		{
-			return rc;
-		}
-
-		rc = execute(shell, ast_if->else_part);
+		char number[BRACE_WIDTH_MAX + 24];
+		const char* begin = format_brace_number(exp, indx, number + sizeof(number));
+		append_expansion(shell, &length, begin, (size_t)(number + sizeof(number) - begin));
 	}
 
-	return rc;
+	append_expansion(shell, &length, exp->suffix, exp->suffix_size);
+
+	return shell->expansion;
 }
 
-static int exec_compound_cmd_list(struct Shell* shell, CompoundCommandsList* cmd_list)
+// the shortest or the longest prefix (suffix) of the item matching the pattern is removed
+static void remove_match(struct Shell* shell, enum ParamOp op, const struct Pattern* pattern, const char* item, size_t* length)
 {
-	int rc = 0;
+	size_t size = strlen(item);
+	int prefix = op == PARAM_REMOVE_SHORT_PREFIX || op == PARAM_REMOVE_LONG_PREFIX;
+	int shortest = op == PARAM_REMOVE_SHORT_PREFIX || op == PARAM_REMOVE_SHORT_SUFFIX;
 
-	for (struct Node* node = cmd_list->head; node; node = node->next)
+	if (pattern->min_length <= size)
 	{
-		struct AstNode* ast_node = (struct AstNode*)node->data;
+		size_t longest = pattern->stars ? size : pattern->min_length; // without stars only the shortest length can match
 
-		switch (ast_node->node_type)
+		for (size_t i = 0; i <= longest - pattern->min_length; i++)
 		{
-			case AST_WHILE:
-			{
-				rc = exec_while_loop(shell, (struct AstWhile*)ast_node->actual_data);
-			} break;
-			case AST_IF:
-			{
-				rc = exec_if(shell, (struct AstIf*)ast_node->actual_data);
-			} break;
-			case AST_FOR:
-			{
-				rc = exec_for_loop(shell ,(struct AstFor*)ast_node->actual_data);
-			} break;
-			default: break; // never executed
-		}
+			size_t removed = shortest ? pattern->min_length + i : longest - i;
 
-		if (shell->execution_error->error)
-		{
-			break;
+			if (match_pattern(pattern, prefix ? item : item + size - removed, removed))
+			{
+				append_expansion(shell, length, prefix ? item + removed : item, size - removed);
+				return;
+			}
 		}
 	}
 
-	return rc;
+	append_expansion(shell, length, item, size);
 }
 
-static void exec_assignment(struct Shell* shell, struct AstAssignment* assignment)
+// the length of the longest match at the beginning of the string, -1 if there's none
+static long match_longest(const struct Pattern* pattern, const char* string, size_t size)
 {
-	if (assignment->expression->node_type == AST_WORD)
+	if (size < pattern->min_length || (pattern->prefix_size && *string != *pattern->prefix))
 	{
-		struct AstWord* word = (struct AstWord*)assignment->expression->actual_data;
-		set_variable(shell, expand_token(shell, assignment->variable), expand_token(shell, &word->word));
+		return -1;
 	}
-	else // assignment->node_type == AST_ARITHM_EXPR
-	{
-		char* arithm_expr = expand_arithm_expr(shell, (struct AstArithmExpr*)assignment->expression->actual_data);
 
-		if (!shell->execution_error->error)
+	size_t longest = pattern->stars ? size : pattern->min_length;
+
+	for (size_t i = longest + 1; i-- > pattern->min_length; )
+	{
+		if (match_pattern(pattern, string, i))
 		{
-			set_variable(shell, expand_token(shell, assignment->variable), arithm_expr);
-			free(arithm_expr);
+			return (long)i;
 		}
 	}
+
+	return -1;
 }
 
-static void exec_assignments_list(struct Shell* shell, AssignmentsList* assignments_list)
+static void replace_matches(struct Shell* shell, struct ParamExp* exp, const struct Pattern* pattern, const char* replacement, const char* item, size_t* length)
 {
-	for (struct Node* node = assignments_list->head; node; node = node->next)
+	size_t size = strlen(item);
+	size_t replacement_size = strlen(replacement);
+
+	if (exp->anchor == '%') // the longest matching suffix
 	{
-		exec_assignment(shell, (struct AstAssignment*)node->data);
+		for (size_t start = 0; start <= size; start++)
+		{
+			if (match_pattern(pattern, item + start, size - start))
+			{
+				append_expansion(shell, length, item, start);
+				append_expansion(shell, length, replacement, replacement_size);
+				return;
+			}
+		}
+	}
+	else if (exp->anchor == '#')
+	{
+		long match = match_longest(pattern, item, size);
 
-		if (shell->execution_error->error)
+		if (match != -1)
 		{
+			append_expansion(shell, length, replacement, replacement_size);
+			append_expansion(shell, length, item + match, size - (size_t)match);
 			return;
 		}
 	}
-}
-
-// if fd is INPUT_FILENO or OUTPUT_FILENO or ins't valid file descriptor won't close it 
-static void close_fd_safely(int fd)
-{
-	if (fd != 0 && fd != 1 && fd != -1)
+	else if (pattern->size)
 	{
-		close(fd);
+		size_t copied = 0;
+
+		for (size_t start = 0; start < size; )
+		{
+			if (pattern->prefix_size) // skip to the next possible beginning of a match
+			{
+				const char* next = memchr(item + start, *pattern->prefix, size - start);
+
+				if (!next)
+				{
+					break;
+				}
+
+				start = (size_t)(next - item);
+			}
+
+			long match = match_longest(pattern, item + start, size - start);
+
+			if (match <= 0) // empty matches aren't replaced
+			{
+				start++;
+				continue;
+			}
+
+			append_expansion(shell, length, item + copied, start - copied);
+			append_expansion(shell, length, replacement, replacement_size);
+			start += (size_t)match;
+			copied = start;
+
+			if (exp->op == PARAM_REPLACE)
+			{
+				break;
+			}
+		}
+
+		append_expansion(shell, length, item + copied, size - copied);
+		return;
 	}
+
+	append_expansion(shell, length, item, size);
 }
 
-// puts pid in process group id and gives in control over the terminal if foregorund is set 
-static void put_in_pg(pid_t pid, pid_t* pgid, int foreground)
+static void apply_to_item(struct Shell* shell, struct ParamExp* exp, const struct Pattern* pattern, const char* replacement, const char* item, size_t* length)
 {
-	if (!*pgid)
+	switch (exp->op)
 	{
-		*pgid = pid;
-	}
-	
-	setpgid(pid, *pgid);
+		case PARAM_REMOVE_SHORT_PREFIX:
+		case PARAM_REMOVE_LONG_PREFIX:
+		case PARAM_REMOVE_SHORT_SUFFIX:
+		case PARAM_REMOVE_LONG_SUFFIX:
+		{
+			remove_match(shell, exp->op, pattern, item, length);
+		} break;
+		case PARAM_REPLACE:
+		case PARAM_REPLACE_ALL:
+		{
+			replace_matches(shell, exp, pattern, replacement, item, length);
+		} break;
+		case PARAM_SUBSTRING:
+		{
+			size_t first = 0;
+			size_t count = 0;
 
-	if (foreground)
-	{
-		tcsetpgrp(STDIN_FILENO, *pgid);
+			if (get_slice(shell, exp, strlen(item), &first, &count))
+			{
+				append_expansion(shell, length, item + first, count);
+			}
+		} break;
+		default: break;
 	}
 }
 
-static int start_process(const char* cmd_name, struct Job* job, struct Process* process, int infd, int outfd, int foreground)
+/*
+	The results for the items are joined by spaces in shell->expansion. A pattern that is a variable's value
+	is compiled into the scratch arena, literal patterns were compiled by the parser.
+*/
+static const char* apply_operator(struct Shell* shell, struct ParamExp* exp, char** items, size_t size)
 {
-	pid_t pid = fork();
+	const struct Pattern* pattern = exp->pattern.pattern;
+	const char* replacement = operand_value(shell, &exp->replacement);
+	size_t length = 0;
 
-	if (pid == -1)
+	if (exp->op != PARAM_SUBSTRING && !pattern)
 	{
-		return -1;
+		const char* value = operand_value(shell, &exp->pattern);
+		pattern = compile_pattern(shell->scratch, value, strlen(value));
+	}
+
+	append_expansion(shell, &length, "", 0);
+
+	for (size_t i = 0; i < size; i++)
+	{
+		if (i)
+		{
+			append_expansion(shell, &length, " ", 1);
+		}
+
+		apply_to_item(shell, exp, pattern, replacement, items[i], &length);
+	}
+
+	if (pattern != exp->pattern.pattern)
+	{
+		reset_arena(shell->scratch);
+	}
+
+	return shell->expansion;
+}
+
+// operators are applied to each item of ${name[@]}
+static const char* expand_param_exp(struct Shell* shell, struct AstWord* word)
+{
+	struct ParamExp* exp = word->expansion;
+	char** items = NULL;
+	size_t size = get_items(shell, word, &items);
+	char* item = size && exp->subscript == SUBSCRIPT_NONE ? items[0] : NULL;
+
+	if (exp->subscript == SUBSCRIPT_INDEX)
+	{
+		const char* index_value = exp->index_name ? get_variable(shell, exp->index_name) : NULL;
+		long index = index_value ? strtol(index_value, NULL, 10) : exp->index;
+
+		if (index < 0)
+		{
+			index += (long)size;
+		}
+
+		item = index >= 0 && (size_t)index < size ? items[index] : NULL;
+	}
+
+	if (exp->subscript != SUBSCRIPT_ALL)
+	{
+		items = &item;
+		size = item ? 1 : 0;
+	}
+
+	switch (exp->op)
+	{
+		case PARAM_LENGTH:
+		{
+			snprintf(reserve_expansion(shell, 24), 24, "%zu", exp->subscript == SUBSCRIPT_ALL ? size : item ? strlen(item) : 0);
+		} return shell->expansion;
+		case PARAM_DEFAULT:
+		{
+			if (!size || (item && !*item))
+			{
+				return operand_value(shell, &exp->pattern);
+			}
+		} // fall through
+		case PARAM_VALUE:
+		{
+			return exp->subscript == SUBSCRIPT_ALL ? join_items(shell, items, size) : item ? item : "";
+		}
+		case PARAM_SUBSTRING:
+		{
+			if (exp->subscript == SUBSCRIPT_ALL) // get_items() selected the items
+			{
+				return join_items(shell, items, size);
+			}
+		} break;
+		default: break;
+	}
+
+	return apply_operator(shell, exp, items, size);
+}
+
+// ${name[@]} becomes a separate word for each item, the operator is applied to each word by expand_item()
+static int is_items_expansion(struct AstWord* word)
+{
+	return word->expansion && word->expansion->subscript == SUBSCRIPT_ALL &&
+		word->expansion->op != PARAM_LENGTH && word->expansion->op != PARAM_DEFAULT;
+}
+
+// an item of ${name[@]}, get_items() already selected the items of ${name[@]:offset:length}
+static const char* expand_item(struct Shell* shell, struct AstWord* word, char* item)
+{
+	if (word->expansion->op == PARAM_VALUE || word->expansion->op == PARAM_SUBSTRING)
+	{
+		return item;
+	}
+
+	return apply_operator(shell, word->expansion, &item, 1);
+}
+
+static const char* expand_word(struct Shell* shell, struct AstWord* word)
+{
+	if (word->expansion)
+	{
+		return expand_param_exp(shell, word);
+	}
+
+	if (word->word.type == PARAMETER_EXPANSION)
+	{
+		char** value = cached_get(shell->variables, word->word.word.buffer, &word->cache);
+		return value ? *value : "";
+	}
+
+	return expand_token(shell, &word->word);
+}
+
+static int is_integer(const char* string)
+{
+	if (*string == '-' || (*string >= '0' && *string <= '9'))
+	{
+		string++;
+
+		for (; *string; string++)
+		{
+			if (*string < '0' || *string > '9')
+			{
+				return 0;
+			}
+		}
+
+		return 1;
+	}
+
+	return 0;
+}
+
+static int arithm_error(struct Shell* shell, const char* message)
+{
+	if (!shell->execution_error->error)
+	{
+		set_error(shell->execution_error, message);
+	}
+
+	return 0;
+}
+
+// returns 0 if an error occurred
+static int execute_arithm_expr(struct Shell* shell, struct ArithmProgram* program, int64_t* result)
+{
+	int64_t stack[program->depth];
+	size_t top = 0;
+
+	for (size_t i = 0; i < program->size; i++)
+	{
+		struct ArithmOp* op = program->ops + i;
+
+		switch (op->type)
+		{
+			case ARITHM_INTEGER:
+			{
+				stack[top++] = op->value;
+			} break;
+			case ARITHM_PARAMETER:
+			{
+				char** entry = cached_get(shell->variables, op->parameter, &op->cache);
+				const char* value = entry ? *entry : NULL;
+
+				if (!value || !is_integer(value))
+				{
+					return arithm_error(shell, "invalid parameter expansion inside arithmetic expansion!");
+				}
+
+				errno = 0;
+				stack[top++] = strtoll(value, NULL, 10);
+
+				if (errno == ERANGE)
+				{
+					return arithm_error(shell, "integer overflow in arithmetic expansion!");
+				}
+			} break;
+			case ARITHM_NEGATE:
+			{
+				if (__builtin_sub_overflow((int64_t)0, stack[top - 1], &stack[top - 1]))
+				{
+					return arithm_error(shell, "integer overflow in arithmetic expansion!");
+				}
+			} break;
+			case ARITHM_ADD:
+			{
+				top--;
+
+				if (__builtin_add_overflow(stack[top - 1], stack[top], &stack[top - 1]))
+				{
+					return arithm_error(shell, "integer overflow in arithmetic expansion!");
+				}
+			} break;
+			case ARITHM_SUBTRACT:
+			{
+				top--;
+
+				if (__builtin_sub_overflow(stack[top - 1], stack[top], &stack[top - 1]))
+				{
+					return arithm_error(shell, "integer overflow in arithmetic expansion!");
+				}
+			} break;
+			case ARITHM_MULTIPLY:
+			{
+				top--;
+
+				if (__builtin_mul_overflow(stack[top - 1], stack[top], &stack[top - 1]))
+				{
+					return arithm_error(shell, "integer overflow in arithmetic expansion!");
+				}
+			} break;
+			case ARITHM_DIVIDE:
+			{
+				top--;
+
+				if (!stack[top])
+				{
+					return arithm_error(shell, "division by zero in arithmetic expansion!");
+				}
+
+				if (stack[top - 1] == INT64_MIN && stack[top] == -1)
+				{
+					return arithm_error(shell, "integer overflow in arithmetic expansion!");
+				}
+
+				stack[top - 1] /= stack[top];
+			} break;
+		}
+	}
+
+	*result = stack[0];
+
+	return 1;
+}
+
+// the result is valid until the next arithmetic expansion, returns NULL if an error occurred
+static const char* expand_arithm_expr(struct Shell* shell, struct ArithmProgram* program)
+{
+	int64_t value = 0;
+
+	if (!execute_arithm_expr(shell, program, &value))
+	{
+		return NULL;
+	}
+
+	char* exp = shell->arithm_result + sizeof(shell->arithm_result) - 1;
+	uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+
+	*exp = '\0';
+
+	do
+	{
+		*--exp = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude);
+
+	if (value < 0)
+	{
+		*--exp = '-';
+	}
+
+	return exp;
+}
+
+static void exec_assignment(struct Shell* shell, struct AstAssignment* assignment)
+{
+	if (assignment->expression->node_type == AST_WORD)
+	{
+		struct AstWord* word = (struct AstWord*)assignment->expression->actual_data;
+		assign_variable(shell, assignment->variable->word.buffer, &assignment->cache, expand_word(shell, word));
+	}
+	else // assignment->node_type == AST_ARITHM_EXPR
+	{
+		const char* arithm_expr = expand_arithm_expr(shell, (struct ArithmProgram*)assignment->expression->actual_data);
+
+		if (arithm_expr)
+		{
+			assign_variable(shell, assignment->variable->word.buffer, &assignment->cache, arithm_expr);
+		}
+	}
+}
+
+static void exec_assignments_list(struct Shell* shell, AssignmentsList* assignments_list)
+{
+	for (struct Node* node = assignments_list->head; node; node = node->next)
+	{
+		exec_assignment(shell, (struct AstAssignment*)node->data);
+
+		if (shell->execution_error->error)
+		{
+			return;
+		}
+	}
+}
+
+// if fd is INPUT_FILENO or OUTPUT_FILENO or ins't valid file descriptor won't close it 
+static void close_fd_safely(int fd)
+{
+	if (fd != 0 && fd != 1 && fd != -1)
+	{
+		close(fd);
+	}
+}
+
+// puts pid in process group id and gives in control over the terminal if foregorund is set 
+static void put_in_pg(pid_t pid, pid_t* pgid, int foreground)
+{
+	if (!*pgid)
+	{
+		*pgid = pid;
+	}
+	
+	setpgid(pid, *pgid);
+
+	if (foreground)
+	{
+		tcsetpgrp(STDIN_FILENO, *pgid);
+	}
+}
+
+// the exit status of a command that couldn't be executed
+static int exec_error_status(int error)
+{
+	return error == ENOENT || error == ENOTDIR || error == ENAMETOOLONG || error == ELOOP ? 127 : 126;
+}
+
+// the file isn't an executable format, it's run by a new instance of the shell as a script
+static void exec_script(const char* cmd_name, char** argv)
+{
+	size_t argc = 0;
+
+	while (argv[argc])
+	{
+		argc++;
+	}
+
+	char** script_argv = calloc(argc + 2, sizeof(char*));
+	script_argv[0] = "smsh";
+	script_argv[1] = (char*)cmd_name;
+	memcpy(script_argv + 2, argv + 1, argc * sizeof(char*)); // with NULL
+
+	execv("/proc/self/exe", script_argv);
+}
+
+static int fork_process(const char* cmd_name, struct Job* job, struct Process* process, int infd, int outfd, int foreground);
+
+#ifndef NO_POSIX_SPAWN
+// launches cmd_name without duplicating the shell's address space: the child is put in the job's process group,
+// gets the default dispositions of the job control signals and (if foreground is set) takes control over the terminal
+static int spawn_process(const char* cmd_name, struct Job* job, struct Process* process, int infd, int outfd, int foreground)
+{
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t attr;
+	sigset_t sigdefault;
+	pid_t pid;
+
+	posix_spawn_file_actions_init(&actions);
+	posix_spawnattr_init(&attr);
+
+#ifdef HAVE_SPAWN_TCSETPGRP
+	if (foreground && isatty(STDIN_FILENO)) // a script's input or a loop's redirection may be a file
+	{
+		posix_spawn_file_actions_addtcsetpgrp_np(&actions, STDIN_FILENO); // must precede dup2() of the standart input
+	}
+#endif
+
+	if (infd != 0)
+	{
+		posix_spawn_file_actions_adddup2(&actions, infd, 0);
+		posix_spawn_file_actions_addclose(&actions, infd);
+	}
+
+	if (outfd != 1)
+	{
+		posix_spawn_file_actions_adddup2(&actions, outfd, 1);
+		posix_spawn_file_actions_addclose(&actions, outfd);
+	}
+
+	sigset_t sigmask;
+	child_sigmask(&sigmask);
+
+	sigemptyset(&sigdefault);
+	sigaddset(&sigdefault, SIGINT);
+	sigaddset(&sigdefault, SIGQUIT);
+	sigaddset(&sigdefault, SIGTSTP);
+	sigaddset(&sigdefault, SIGTTIN);
+	sigaddset(&sigdefault, SIGTTOU);
+
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+	posix_spawnattr_setpgroup(&attr, job->pgid); // 0 - the child becomes the leader of a new process group
+	posix_spawnattr_setsigdefault(&attr, &sigdefault);
+	posix_spawnattr_setsigmask(&attr, &sigmask); // SIGCHLD is blocked in the shell
+
+	int rc = posix_spawn(&pid, cmd_name, &actions, &attr, process->argv, environ);
+
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&actions);
+
+	if (rc == ENOEXEC) // a file without a shebang, the forked child runs it as a script
+	{
+		return fork_process(cmd_name, job, process, infd, outfd, foreground);
+	}
+
+	if (rc == EAGAIN || rc == ENOMEM)
+	{
+		return -1;
+	}
+
+	if (rc != 0)
+	{
+		fprintf(stderr, "%s: %s\n", cmd_name, strerror(rc));
+		return exec_error_status(rc);
+	}
+
+	put_in_pg(pid, &job->pgid, foreground);
+	process->pid = pid;
+
+	return 0;
+}
+#endif
+
+// the child gets infd and outfd as its standard input and output, is put in the job's process group
+// and gets the default dispositions of the job control signals, returns 0 in the child like fork()
+static pid_t fork_child(struct Job* job, int infd, int outfd, int foreground)
+{
+	pid_t pid = fork();
+
+	if (pid == -1)
+	{
+		return -1;
 	}
 
 	if (pid == 0)
@@ -479,32 +1075,215 @@ static int start_process(const char* cmd_name, struct Job* job, struct Process*
 
 		if (r1 == -1 || r2 == -1)
 		{
-			return 1; // If a command fails during word expansion or redirection, its exit status shall be greater than zero
+			_exit(1); // If a command fails during word expansion or redirection, its exit status shall be greater than zero
 		}
 
-	 	put_in_pg(getpid(), &job->pgid, foreground); // to avoid race conditions 
-		
-		signal(SIGINT, SIG_DFL);
-		signal(SIGQUIT, SIG_DFL);
-		signal(SIGTSTP, SIG_DFL);
-		signal(SIGTTIN, SIG_DFL);
-		signal(SIGTTOU, SIG_DFL);
+	 	put_in_pg(getpid(), &job->pgid, foreground); // to avoid race conditions 
+		
+		signal(SIGINT, SIG_DFL);
+		signal(SIGQUIT, SIG_DFL);
+		signal(SIGTSTP, SIG_DFL);
+		signal(SIGTTIN, SIG_DFL);
+		signal(SIGTTOU, SIG_DFL);
+
+		sigset_t sigmask;
+		child_sigmask(&sigmask);
+		sigprocmask(SIG_SETMASK, &sigmask, NULL);
+	}
+	else
+	{
+		put_in_pg(pid, &job->pgid, foreground); // puts new process id in process group id and gives in control over the terminal if foregorund is set 
+	}
+
+	return pid;
+}
+
+// fork() + exec() path, used when posix_spawn() can't hand the terminal over to the child
+static int fork_process(const char* cmd_name, struct Job* job, struct Process* process, int infd, int outfd, int foreground)
+{
+	pid_t pid = fork_child(job, infd, outfd, foreground);
+
+	if (pid == -1)
+	{
+		return -1;
+	}
+
+	if (pid == 0)
+	{
+		execv(cmd_name, process->argv);
+
+		if (errno == ENOEXEC)
+		{
+			exec_script(cmd_name, process->argv);
+			errno = ENOEXEC;
+		}
+
+		fprintf(stderr, "%s: %s\n", cmd_name, strerror(errno));
+		_exit(exec_error_status(errno)); // If a command is not found, the exit status shall be 127
+	}
+
+	process->pid = pid;
+
+	return 0;
+}
+
+// a builtin that isn't the last stage of a pipeline runs in a child, the shell would block writing to the pipe otherwise
+static int fork_builtin(struct Shell* shell, const struct Builtin* builtin, struct Job* job, struct Process* process, int infd, int outfd, int foreground)
+{
+	fflush(stdout); // the child would write the buffered output again
+
+	pid_t pid = fork_child(job, infd, outfd, foreground);
+
+	if (pid == -1)
+	{
+		return -1;
+	}
+
+	if (pid == 0)
+	{
+		drop_input(&shell->input); // the parent's read-ahead
+		destroy_job_control(&shell->job_control); // the parent's jobs aren't the child's children, wait and jobs see only its own
+		closefrom(3); // as exec() would, closes the pipe ends of the other stages, so the builtin's writes fail when its reader exits
+		shell->job_control = create_job_control(); // blocks SIGCHLD again for the builtins that start processes
+		int rc = builtin->exec(shell, process->argv + 1);
+		fflush(stdout);
+		_exit(rc);
+	}
+
+	process->pid = pid;
+
+	return 0;
+}
+
+// runs the builtin in the shell process with infd and outfd temporarily made its standard input and output
+static int run_builtin(struct Shell* shell, const struct Builtin* builtin, char** argv, int infd, int outfd)
+{
+	int saved_in = -1;
+	int saved_out = -1;
+	int owned = shell->input.owned;
+
+	if (outfd != 1)
+	{
+		fflush(stdout);
+		saved_out = fcntl(1, F_DUPFD_CLOEXEC, SAVED_FD_MIN);
+		dup2(outfd, 1);
+	}
+
+	if (infd != 0)
+	{
+		__fpurge(stdin); // buffered input belongs to the original standard input
+		release_input(&shell->input, 0);
+		shell->input.owned = 1; // infd is closed after the builtin
+		saved_in = fcntl(0, F_DUPFD_CLOEXEC, SAVED_FD_MIN);
+		dup2(infd, 0);
+	}
+
+	int rc = builtin->exec(shell, argv);
+	reset_arena(shell->scratch);
+	fflush(stdout); // commands that follow write to the descriptor directly
+
+	if (outfd != 1)
+	{
+		saved_out == -1 ? close(1) : dup2(saved_out, 1);
+		close_fd_safely(saved_out);
+	}
+
+	if (infd != 0)
+	{
+		__fpurge(stdin); // unread input of infd
+		clearerr(stdin);
+		drop_input(&shell->input);
+		shell->input.owned = owned;
+		saved_in == -1 ? close(0) : dup2(saved_in, 0);
+		close_fd_safely(saved_in);
+	}
+
+	return rc;
+}
+
+// returns 0 if the process was started, -1 if it couldn't be created, or the exit status of a command that couldn't be executed
+static int start_process(const char* cmd_name, struct Job* job, struct Process* process, int infd, int outfd, int foreground)
+{
+#ifndef NO_POSIX_SPAWN
+#ifndef HAVE_SPAWN_TCSETPGRP
+	if (!foreground) // without posix_spawn_file_actions_addtcsetpgrp_np() the child would read the terminal before the shell gives it control
+#endif
+	{
+		return spawn_process(cmd_name, job, process, infd, outfd, foreground);
+	}
+#endif
+
+	return fork_process(cmd_name, job, process, infd, outfd, foreground);
+}
+
+struct Job* start_background_job(struct Shell* shell, char** argv, int outfd)
+{
+	const char* path = find_executable(shell, argv[0]);
+
+	struct Process* process = calloc(1, sizeof(struct Process));
+	process->argv = argv;
+
+	struct Job* job = calloc(1, sizeof(struct Job));
+	job->processes = create_list(destroy_process);
+
+	if (!path || start_process(path, job, process, 0, outfd, 0) != 0)
+	{
+		destroy_process(process);
+		destroy_job(job);
+		return NULL;
+	}
+
+	add_process(shell->job_control, job, process);
+	add_job(shell->job_control, job);
+
+	return job;
+}
+
+// array keeps *capacity pointers including NULL after the last argument, it grows if pathname expansions add more
+static void add_arg(char*** array, size_t* capacity, size_t* indx, char* arg)
+{
+	if (*indx + 1 == *capacity)
+	{
+		*capacity <<= 1;
+		*array = realloc(*array, *capacity * sizeof(char*));
+	}
+
+	(*array)[(*indx)++] = arg;
+	(*array)[*indx] = NULL;
+}
+
+// SMSH_GLOB_THREADS is the number of threads walking the trees of '**', the default is the number of CPUs
+static size_t get_glob_threads(struct Shell* shell, const struct Glob* glob)
+{
+	if (!glob->recursive)
+	{
+		return 1;
+	}
+
+	const char* value = get_variable(shell, "SMSH_GLOB_THREADS");
+	long threads = value && *value ? strtol(value, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
 
-		if (execv(cmd_name, process->argv) == -1)
-		{
-			return 127; // If a command is not found, the exit status shall be 127
-		}
+	return threads > 0 ? (size_t)threads : 1;
+}
+
+// a pattern that matches nothing is kept as it is
+static void expand_pathname(struct Shell* shell, struct AstWord* ast_word, char*** array, size_t* capacity, size_t* indx)
+{
+	if (!expand_glob(&shell->directories, ast_word->glob, get_glob_threads(shell, ast_word->glob), &shell->paths))
+	{
+		add_arg(array, capacity, indx, copy_string(ast_word->word.word.buffer));
+		return;
 	}
-	else
+
+	for (size_t i = 0; i < shell->paths.size; i++)
 	{
-		put_in_pg(pid, &job->pgid, foreground); // puts new process id in process group id and gives in control over the terminal if foregorund is set 
-		process->pid = pid;
+		add_arg(array, capacity, indx, shell->paths.paths[i]);
 	}
 
-	return 0;
+	shell->paths.size = 0; // the paths belong to the array
 }
 
-static int wordlist_to_array(struct Shell* shell, char** array, Wordlist* wordlist, size_t indx)
+static int wordlist_to_array(struct Shell* shell, char*** array, size_t capacity, Wordlist* wordlist, size_t indx)
 {
 	if (wordlist)
 	{
@@ -512,34 +1291,96 @@ static int wordlist_to_array(struct Shell* shell, char** array, Wordlist* wordli
 		{
 			struct AstNode* ast_node = (struct AstNode*)node->data;
 
-			if (ast_node->node_type == AST_WORD)
+			if (ast_node->node_type == AST_WORD && is_items_expansion((struct AstWord*)ast_node->actual_data))
+			{
+				char** items = NULL;
+				size_t size = get_items(shell, (struct AstWord*)ast_node->actual_data, &items);
+
+				for (size_t i = 0; i < size; i++)
+				{
+					add_arg(array, &capacity, &indx, copy_string(expand_item(shell, (struct AstWord*)ast_node->actual_data, items[i])));
+				}
+			}
+			else if (ast_node->node_type == AST_WORD && ((struct AstWord*)ast_node->actual_data)->brace)
+			{
+				struct BraceExp* brace = ((struct AstWord*)ast_node->actual_data)->brace;
+
+				for (size_t i = 0; i < brace->count; i++)
+				{
+					if (is_dropped_brace_item(brace, i))
+					{
+						continue;
+					}
+
+					add_arg(array, &capacity, &indx, copy_string(expand_brace_item(shell, brace, i)));
+				}
+			}
+			else if (ast_node->node_type == AST_WORD && ((struct AstWord*)ast_node->actual_data)->glob)
+			{
+				expand_pathname(shell, (struct AstWord*)ast_node->actual_data, array, &capacity, &indx);
+			}
+			else if (ast_node->node_type == AST_WORD)
 			{
 				struct AstWord* ast_word = (struct AstWord*)ast_node->actual_data;
-				array[indx++] = copy_string(expand_token(shell, &ast_word->word));
+				add_arg(array, &capacity, &indx, copy_string(expand_word(shell, ast_word)));
 			}
 			else // ast_node->node_type == AST_ARITHM_EXPR
 			{
-				char* arithm_expr = expand_arithm_expr(shell, (struct AstArithmExpr*)ast_node->actual_data);
+				const char* arithm_expr = expand_arithm_expr(shell, (struct ArithmProgram*)ast_node->actual_data);
 		
-				if (shell->execution_error->error)
+				if (!arithm_expr)
 				{
-					free_cmd_args(array);
+					free_cmd_args(*array);
+					clear_directory_cache(&shell->directories);
 					return 0;
 				}
 
-				array[indx++] = arithm_expr;
+				add_arg(array, &capacity, &indx, copy_string(arithm_expr));
 			}
 		}
 	}
 
+	clear_directory_cache(&shell->directories);
+
 	return 1;
 }
 
+// the number of words after expansion, pathname expansions are counted as single words
+static size_t count_words(struct Shell* shell, Wordlist* wordlist)
+{
+	size_t count = 0;
+
+	if (wordlist)
+	{
+		for (struct Node* node = wordlist->head; node; node = node->next)
+		{
+			struct AstNode* ast_node = (struct AstNode*)node->data;
+			char** items = NULL;
+
+			if (ast_node->node_type == AST_WORD && is_items_expansion((struct AstWord*)ast_node->actual_data))
+			{
+				count += get_items(shell, (struct AstWord*)ast_node->actual_data, &items);
+			}
+			else if (ast_node->node_type == AST_WORD && ((struct AstWord*)ast_node->actual_data)->brace)
+			{
+				count += ((struct AstWord*)ast_node->actual_data)->brace->count;
+			}
+			else
+			{
+				count++;
+			}
+		}
+	}
+
+	return count;
+}
+
 static char** create_builtin_args(struct Shell* shell, Wordlist* command_args)
 {
-	char** argv = calloc(get_list_size(command_args) + 1, sizeof(char*));
+	size_t capacity = count_words(shell, command_args) + 1;
+	char** argv = calloc(capacity, sizeof(char*));
 
-	if (!wordlist_to_array(shell, argv, command_args, (size_t)0))
+	if (!wordlist_to_array(shell, &argv, capacity, command_args, (size_t)0))
 	{
 		return NULL;
 	}
@@ -549,10 +1390,11 @@ static char** create_builtin_args(struct Shell* shell, Wordlist* command_args)
 
 static char** create_cmd_args(struct Shell* shell, const char* cmd_name, Wordlist* command_args)
 {
-	char** argv = calloc(get_list_size(command_args) + 2, sizeof(char*));
+	size_t capacity = count_words(shell, command_args) + 2;
+	char** argv = calloc(capacity, sizeof(char*));
 	argv[0] = copy_string(cmd_name);
 
-	if (!wordlist_to_array(shell, argv, command_args, (size_t)1))
+	if (!wordlist_to_array(shell, &argv, capacity, command_args, (size_t)1))
 	{
 		return NULL;
 	}
@@ -562,7 +1404,7 @@ static char** create_cmd_args(struct Shell* shell, const char* cmd_name, Wordlis
 
 static int get_io_redir_fd(struct Shell* shell, struct AstIORedirect* ast_redirect)
 {
-	const char* path = expand_token(shell, &ast_redirect->file_name->word);
+	const char* path = expand_word(shell, ast_redirect->file_name);
 	int fd = -1;
 
 	if (ast_redirect->token->type == INPUT_REDIRECT)
@@ -590,13 +1432,9 @@ static void handle_unexisting_cmd_error(struct Shell* shell, const char* path)
 	free(error_mes);
 }
 
-static char* find_executable(struct Shell* shell, const char* exec_name)
+// searches PATH for exec_name, returns NULL if it isn't found
+static char* search_path(struct Shell* shell, const char* exec_name)
 {
-	if (strchr(exec_name, '/'))
-	{
-		return copy_string(exec_name);
-	}
-
 	const char* path = get_variable(shell, "PATH");
 	char* _path = NULL;
 
@@ -629,6 +1467,8 @@ static char* find_executable(struct Shell* shell, const char* exec_name)
 		full_path[len] = '/';
 		strcat(full_path, exec_name);
 
+		shell->commands_stats.probes++;
+
 		if (access(full_path, X_OK) == 0)
 		{
 			break;
@@ -644,6 +1484,35 @@ static char* find_executable(struct Shell* shell, const char* exec_name)
 	return full_path;
 }
 
+// PATH is searched once per command name, the result (including a miss) is remembered until PATH changes or 'hash -r' is executed
+const char* find_executable(struct Shell* shell, const char* exec_name)
+{
+	if (strchr(exec_name, '/'))
+	{
+		return exec_name;
+	}
+
+	shell->commands_stats.lookups++;
+
+	char** full_path = get(shell->commands, exec_name);
+
+	if (full_path)
+	{
+		shell->commands_stats.hits++;
+	}
+	else
+	{
+		char* path = search_path(shell, exec_name);
+
+		insert(shell->commands, exec_name, path ? path : "");
+		free(path);
+
+		full_path = get(shell->commands, exec_name);
+	}
+
+	return **full_path ? *full_path : NULL;
+}
+
 // new_fd is a pointer to stdandart input file descriptor, fd is standart output file descriptor or vice versa
 static int redirect_io(struct Shell* shell, struct AstIORedirect* ast_io_redir, int* new_fd, int fd)
 {
@@ -661,7 +1530,8 @@ static int redirect_io(struct Shell* shell, struct AstIORedirect* ast_io_redir,
 	return 0;
 }
 
-static int exec_simple_command(struct Shell* shell, struct AstSimpleCommand* simple_command, struct Job* job, int infd, int outfd, int foreground)
+// in_shell - a builtin may run in the shell process, otherwise it's forked like an external command
+static int exec_simple_command(struct Shell* shell, struct AstSimpleCommand* simple_command, struct Job* job, int infd, int outfd, int foreground, int in_shell)
 {	
 	if (simple_command->assignment_list)
 	{
@@ -675,7 +1545,7 @@ static int exec_simple_command(struct Shell* shell, struct AstSimpleCommand* sim
 
 	if (simple_command->command_name)
 	{
-		const char* cmd_name = expand_token(shell, &simple_command->command_name->word);
+		const char* cmd_name = expand_word(shell, simple_command->command_name);
 
 		struct Process* process = calloc(1, sizeof(struct Process));
 		process->completed = 1;
@@ -684,22 +1554,53 @@ static int exec_simple_command(struct Shell* shell, struct AstSimpleCommand* sim
 		const struct Builtin* const builtin = is_builtin(cmd_name);
 		if (builtin)
 		{
-			process->argv = create_builtin_args(shell, simple_command->command_args);
+			// a forked builtin keeps its name in argv[0] for jobs, the builtin gets the arguments after it
+			process->argv = in_shell ? create_builtin_args(shell, simple_command->command_args) : create_cmd_args(shell, cmd_name, simple_command->command_args);
 
-			if (!shell->execution_error->error)
+			if (shell->execution_error->error)
+			{
+				close_fd_safely(infd);
+				close_fd_safely(outfd);
+				destroy_process(process);
+				return 1;
+			}
+
+			if (redirect_io(shell, simple_command->input_redirect, &infd, outfd) == -1 ||
+				redirect_io(shell, simple_command->output_redirect, &outfd, infd) == -1)
+			{
+				destroy_process(process);
+				return 1;
+			}
+
+			shell->command = simple_command;
+
+			if (infd == 0 && (builtin->input == BUILTIN_READS_INPUT || (builtin->input == BUILTIN_BUFFERED_INPUT && !in_shell)))
+			{
+				release_input(&shell->input, 0);
+			}
+
+			if (in_shell)
+			{
+				process->rc = run_builtin(shell, builtin, process->argv, infd, outfd);
+			}
+			else if ((process->rc = fork_builtin(shell, builtin, job, process, infd, outfd, foreground)) == -1)
+			{
+				set_error(shell->execution_error, "can't create a child process");
+			}
+			else
 			{
-				process->rc = builtin->exec(shell, process->argv);
+				process->completed = 0;
 			}
 
 			close_fd_safely(infd);
 			close_fd_safely(outfd);
 
-			push_back(job->processes, process);
+			add_process(shell->job_control, job, process);
 
 			return process->rc;
 		} 
 
-		char* path = find_executable(shell, cmd_name);	
+		const char* path = find_executable(shell, cmd_name);
 		if (!path)
 		{
 			handle_unexisting_cmd_error(shell, cmd_name);
@@ -720,34 +1621,36 @@ static int exec_simple_command(struct Shell* shell, struct AstSimpleCommand* sim
 
 		if (redirect_io(shell, simple_command->input_redirect, &infd, outfd) == -1)
 		{
-			free(path);
 			destroy_process(process);
 			return 1;
 		}
 
 		if (redirect_io(shell, simple_command->output_redirect, &outfd, infd) == -1)
 		{
-			free(path);
 			destroy_process(process);
 			return 1;
 		}
 
-		process->rc = start_process(path, job, process, infd, outfd, foreground);
+		if (infd == 0)
+		{
+			release_input(&shell->input, 0); // the command reads the standard input from the first unread byte
+		}
+
+		process->rc = start_process(path, job, process, infd, outfd, foreground); // the exit status if the command couldn't be executed
 
 		if (process->rc == -1)
 		{
 			set_error(shell->execution_error, "can't create a child process");
 		}
-		else
+		else if (process->rc == 0)
 		{
 			process->completed = 0;
 		}
 
 		close_fd_safely(infd);
 		close_fd_safely(outfd);
-		free(path);
 
-		push_back(job->processes, process);
+		add_process(shell->job_control, job, process);
 	}
 
 	return 0;
@@ -757,127 +1660,501 @@ static int exec_pipeline(struct Shell* shell, struct AstPipeline* pipeline)
 {
 	if (pipeline) 
 	{
+		if (shell->job_control->notify)
+		{
+			reap_children(shell->job_control); // background jobs don't stay zombies until the next prompt
+		}
+		else
+		{
+			do_job_notification(shell->job_control); // frees completed background jobs
+		}
+
 		struct Job* job = calloc(1, sizeof(struct Job));
 		job->processes = create_list(destroy_process);
 
-		int rc = 0;
-		int pipefd[2] = { 0, 1 };
-		int foreground = pipeline->mode == FOREGROUND ? 1 : 0;
+		int rc = 0;
+		int pipefd[2] = { 0, 1 };
+		int foreground = pipeline->mode == FOREGROUND ? 1 : 0;
+
+		for (struct Node* node = pipeline->pipeline->head; node; node = node->next)
+		{
+			int infd = pipefd[0];
+
+			if (node->next) // if isn't the last command in the pipeline
+			{
+				pipe2(pipefd, O_CLOEXEC); // the commands started by the pipeline don't keep each other's pipes open
+			}
+			else
+			{
+				pipefd[1] = 1;
+			}
+
+			// the last stage runs after the others were started, so an in-shell builtin can't block them, builtins of
+			// a background pipeline are forked, so they don't block the shell and are in the job table
+			int in_shell = foreground && !node->next;
+
+			rc = exec_simple_command(shell, (struct AstSimpleCommand*)node->data, job, infd, pipefd[1], foreground, in_shell); // fds are closed
+
+			if (shell->execution_error->error)
+			{
+				break;
+			}
+		}
+
+		if (!shell->execution_error->error && get_list_size(job->processes))
+		{
+			add_job(shell->job_control, job);
+
+			if (foreground)
+			{ 
+				wait_for_job(shell->job_control, job);
+
+				if (job->pgid) // a child took the terminal, builtins run in the shell don't
+				{
+					tcsetpgrp(STDIN_FILENO, shell->pgid); // regain control of terminal
+				}
+
+				if (is_job_completed(job))
+				{
+					struct Process* process = (struct Process*)job->processes->tail->data;
+					rc = process->rc;
+					remove_job(shell->job_control, job);
+				}
+			}
+			else
+			{
+				struct Process* process = (struct Process*)job->processes->tail->data;
+
+				if (process->pid > 0) // $! is the pid of the last command in the background pipeline
+				{
+					char pid[24];
+					snprintf(pid, sizeof(pid), "%ld", (long)process->pid);
+					set_variable(shell, "!", pid);
+				}
+
+				if (shell->job_control->notify)
+				{
+					fprintf(stderr, "[%zu] %ld\n", job->id, (long)job->pgid);
+				}
+			}
+		}
+		else
+		{
+			remove_job(shell->job_control, job); // started processes aren't waited for
+		}
+
+		return rc; // the exit status shall be the exit status of the last command specified in the pipeline
+	}
+
+	return 0;
+}
+
+static int handle_error(struct Error* error, const char* prompt)
+{
+	if (error->error)
+	{
+		fprintf(stderr, "%s%s\n", prompt, error->error_message);
+		unset_error(error);
+		return 0;
+	}
+
+	return 1;
+}
+
+struct LoopState
+{
+	struct Node* next; // next word of the for loop's wordlist
+	size_t item; // next item of the ${name[@]} word, the next path of the pattern or the next word of the brace expansion in next
+	struct PathList paths; // the paths matching the pattern in next, expanded when the loop reaches it
+	char* init_value; // value of the for loop's variable before the loop
+	int defined; // 1 if the for loop's variable was defined before the loop
+	int rc;
+	int redirected[2]; // the while loop replaced the standard input, output
+	int saved_fds[2]; // descriptors replaced by the loop's redirections
+	int owned; // shell->input.owned before the loop
+};
+
+// the loop's redirections replace the standard input and output until the loop ends, the loop owns its input
+static void redirect_loop(struct Shell* shell, struct AstWhile* ast_while, struct LoopState* state)
+{
+	struct AstIORedirect* redirects[2] = { ast_while->input_redirect, ast_while->output_redirect };
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (!redirects[i])
+		{
+			continue;
+		}
+
+		int fd = get_io_redir_fd(shell, redirects[i]);
+
+		if (fd == -1)
+		{
+			set_error(shell->execution_error, IO_REDIRECT_ERROR_MES);
+			return;
+		}
+
+		if (i == 0)
+		{
+			__fpurge(stdin);
+			release_input(&shell->input, 0);
+			state->owned = shell->input.owned;
+			shell->input.owned = 1;
+		}
+		else
+		{
+			fflush(stdout);
+		}
+
+		state->redirected[i] = 1;
+		state->saved_fds[i] = fcntl(i, F_DUPFD_CLOEXEC, SAVED_FD_MIN);
+		dup2(fd, i);
+		close_fd_safely(fd);
+	}
+}
+
+static void restore_loop_io(struct Shell* shell, struct LoopState* state)
+{
+	for (int i = 0; i < 2; i++)
+	{
+		if (!state->redirected[i])
+		{
+			continue;
+		}
+
+		if (i == 0)
+		{
+			__fpurge(stdin);
+			clearerr(stdin);
+			drop_input(&shell->input); // unread data of the loop's input
+			shell->input.owned = state->owned;
+		}
+		else
+		{
+			fflush(stdout);
+		}
+
+		state->saved_fds[i] == -1 ? close(i) : dup2(state->saved_fds[i], i);
+		close_fd_safely(state->saved_fds[i]);
+		state->redirected[i] = 0;
+	}
+}
+
+static void begin_for_loop(struct Shell* shell, struct AstFor* ast_for, struct LoopState* state)
+{
+	const char* var_name = ast_for->variable->word.word.buffer;
+	char** value = get(shell->variables, var_name);
+
+	if (!value)
+	{
+		insert(shell->variables, var_name, "");
+		state->defined = 0;
+	}
+	else
+	{
+		state->init_value = copy_string(*value);
+		state->defined = 1;
+	}
+
+	state->next = ast_for->wordlist->head;
+	state->item = 0;
+}
+
+// returns 0 if the wordlist is exhausted
+static int next_for_loop(struct Shell* shell, struct AstFor* ast_for, struct LoopState* state)
+{
+	struct Node* node = state->next;
+
+	if (!node)
+	{
+		return 0;
+	}
+
+	const char* var_name = ast_for->variable->word.word.buffer;
+	struct AstNode* expr = (struct AstNode*)node->data;
+
+	if (expr->node_type == AST_WORD && is_items_expansion((struct AstWord*)expr->actual_data))
+	{
+		char** items = NULL;
+		size_t size = get_items(shell, (struct AstWord*)expr->actual_data, &items); // the array may change in the body
+
+		if (state->item >= size)
+		{
+			state->item = 0;
+			state->next = node->next;
+
+			return next_for_loop(shell, ast_for, state);
+		}
+
+		assign_variable(shell, var_name, &ast_for->variable->cache, expand_item(shell, (struct AstWord*)expr->actual_data, items[state->item++]));
+
+		return 1;
+	}
+
+	if (expr->node_type == AST_WORD && ((struct AstWord*)expr->actual_data)->brace)
+	{
+		struct BraceExp* brace = ((struct AstWord*)expr->actual_data)->brace; // the words are produced one at a time
+
+		while (state->item < brace->count && is_dropped_brace_item(brace, state->item))
+		{
+			state->item++;
+		}
+
+		if (state->item >= brace->count)
+		{
+			state->item = 0;
+			state->next = node->next;
+
+			return next_for_loop(shell, ast_for, state);
+		}
+
+		assign_variable(shell, var_name, &ast_for->variable->cache, expand_brace_item(shell, brace, state->item++));
+
+		return 1;
+	}
+
+	if (expr->node_type == AST_WORD && ((struct AstWord*)expr->actual_data)->glob)
+	{
+		struct AstWord* word = expr->actual_data;
 
-		for (struct Node* node = pipeline->pipeline->head; node; node = node->next)
+		if (!state->item)
 		{
-			int infd = pipefd[0];
+			size_t size = expand_glob(&shell->directories, word->glob, get_glob_threads(shell, word->glob), &state->paths);
+			clear_directory_cache(&shell->directories);
 
-			if (node->next) // if isn't the last command in the pipeline
-			{
-				pipe(pipefd);
-			}
-			else
+			if (!size) // a pattern that matches nothing is kept as it is
 			{
-				pipefd[1] = 1;
-			}
+				assign_variable(shell, var_name, &ast_for->variable->cache, word->word.word.buffer);
+				state->next = node->next;
 
-			rc = exec_simple_command(shell, (struct AstSimpleCommand*)node->data, job, infd, pipefd[1], foreground); // fds are closed
-
-			if (shell->execution_error->error)
-			{
-				break;
+				return 1;
 			}
 		}
 
-		if (!shell->execution_error->error && get_list_size(job->processes))
+		if (state->item >= state->paths.size)
 		{
-			push_forward(shell->jobs, job);
+			free_paths(&state->paths);
+			state->item = 0;
+			state->next = node->next;
 
-			if (foreground)
-			{ 
-				wait_for_job(shell->jobs, job);
-				tcsetpgrp(STDIN_FILENO, shell->pgid); // regain control of terminal
-
-				if (is_job_completed(job))
-				{
-					struct Process* process = (struct Process*)job->processes->tail->data;
-					rc = process->rc;
-					remove_node(shell->jobs, job);
-				}
-			}
+			return next_for_loop(shell, ast_for, state);
 		}
-		else
+
+		assign_variable(shell, var_name, &ast_for->variable->cache, state->paths.paths[state->item++]);
+
+		return 1;
+	}
+
+	if (expr->node_type == AST_WORD)
+	{
+		struct AstWord* word = expr->actual_data;
+		assign_variable(shell, var_name, &ast_for->variable->cache, expand_word(shell, word));
+	}
+	else // expr->node_type == AST_ARITHM_EXPR
+	{
+		const char* var_value = expand_arithm_expr(shell, (struct ArithmProgram*)expr->actual_data);
+
+		if (!var_value)
 		{
-			destroy_job(job);
+			return 1;
 		}
 
-		return rc; // the exit status shall be the exit status of the last command specified in the pipeline
+		assign_variable(shell, var_name, &ast_for->variable->cache, var_value);
 	}
 
-	return 0;
+	state->next = node->next;
+
+	return 1;
 }
 
-static int exec_pipeline_list(struct Shell* shell, PipelinesList* pipe_list)
+static void end_for_loop(struct Shell* shell, struct AstFor* ast_for, struct LoopState* state)
 {
-	// The exit status of an asynchronous list shall be zero
-	// The exit status of a sequential list shall be the exit status of the last command in the list
-	if (pipe_list)
+	const char* var_name = ast_for->variable->word.word.buffer;
+
+	if (!state->defined)
 	{
-		int rc = 0;
+		unset_variable(shell, var_name);
+	}
+	else
+	{
+		set_variable(shell, var_name, state->init_value);
+		free(state->init_value);
+		state->init_value = NULL;
+	}
+}
 
-		for (struct Node* node = pipe_list->head; node; node = node->next)
-		{
-			rc = exec_pipeline(shell, (struct AstPipeline*)node->data); // if pipeline is running in the background mode, exec_pipeline() returns 0
+/*
+	The automaton finds the first literal pattern that matches, only the parameter expansions before it
+	are compiled and tried. Without the automaton the literal patterns are tried one by one too.
+	Returns the index of the matching item, or the number of items if none matches.
+*/
+static size_t match_case(struct Shell* shell, struct AstCase* ast_case)
+{
+	const char* word = expand_word(shell, ast_case->word);
+	char* copy = word == shell->expansion ? copy_string(word) : NULL; // expanding a pattern reuses the buffer
+	size_t length = strlen(word);
+	size_t last = ast_case->pattern_count;
+	int compiled = 0;
 
-			if (shell->execution_error->error)
-			{
-				break;
-			}
-		}
+	if (copy)
+	{
+		word = copy;
+	}
 
-		return rc;
+	if (ast_case->automaton)
+	{
+		long found = match_pattern_set(ast_case->automaton, word, length);
+		last = found == -1 ? last : (size_t)found;
 	}
 
-	return 0;
-}
+	size_t item = last < ast_case->pattern_count ? ast_case->patterns[last].item : get_list_size(ast_case->items);
 
-static int handle_error(struct Error* error, const char* prompt)
-{
-	if (error->error)
+	for (size_t i = 0; i < last; i++)
 	{
-		fprintf(stderr, "%s%s\n", prompt, error->error_message);
-		unset_error(error);
-		return 0;
+		struct CasePattern* case_pattern = ast_case->patterns + i;
+		const struct Pattern* pattern = case_pattern->pattern;
+
+		if (!pattern)
+		{
+			const char* value = expand_word(shell, case_pattern->word);
+			pattern = compile_pattern(shell->scratch, value, strlen(value));
+			compiled = 1;
+		}
+		else if (ast_case->automaton)
+		{
+			continue;
+		}
+
+		if (match_pattern(pattern, word, length))
+		{
+			item = case_pattern->item;
+			break;
+		}
 	}
 
-	return 1;
+	if (compiled)
+	{
+		reset_arena(shell->scratch);
+	}
+
+	free(copy);
+
+	return item;
 }
 
-int execute(struct Shell* shell, CommandsList* program)
+// The exit status of a for and while loop shall be the exit status of the last body commands list executed, or zero, if none was executed.
+// The exit status of the if command shall be the exit status of the then or else commands list that was executed, or zero, if none was executed
+// The exit status of the case command shall be the exit status of the commands list of the matching item, or zero, if none matched
+static int run(struct Shell* shell, struct Bytecode* bytecode)
 {
-	if (program)
+	struct LoopState* states = calloc(bytecode->slots + 1, sizeof(struct LoopState));
+	const struct Instruction* code = bytecode->code;
+	size_t pc = 0;
+	size_t iterations = 0;
+	int rc = 0;
+
+	for (int running = 1; running && !shell->execution_error->error; )
 	{
-		int rc = 0;
+		const struct Instruction* instruction = code + pc++;
 
-		for (struct Node* node = program->head; node; node = node->next)
+		switch (instruction->op)
 		{
-			struct AstNode* ast_node = (struct AstNode*)node->data;
-
-			if (ast_node->node_type == AST_PIPELINE_LIST)
+			case OP_PIPELINE:
 			{
-				rc = exec_pipeline_list(shell, (PipelinesList*)ast_node->actual_data);
-			}
-			else // ast_node->node_type == AST_COMPOUND_COMMANDS_LIST
+				rc = exec_pipeline(shell, (struct AstPipeline*)instruction->data); // if pipeline is running in the background mode, exec_pipeline() returns 0
+			} break;
+			case OP_ASSIGN:
 			{
-				rc = exec_compound_cmd_list(shell, (CompoundCommandsList*)ast_node->actual_data);
-			}
+				exec_assignments_list(shell, (AssignmentsList*)instruction->data);
+				rc = shell->execution_error->error ? -1 : 0;
+			} break;
+			case OP_JUMP:
+			{
+				if (instruction->operand < pc && !(++iterations & REAP_INTERVAL)) // long loops don't leave background jobs as zombies
+				{
+					reap_children(shell->job_control);
+				}
 
-			if (shell->execution_error->error)
+				pc = instruction->operand;
+			} break;
+			case OP_JUMP_IF_FAILED:
 			{
-				return rc;
-			}
+				if (rc)
+				{
+					pc = instruction->operand;
+				}
+			} break;
+			case OP_SET_RC:
+			{
+				rc = (int)instruction->operand;
+			} break;
+			case OP_SAVE_RC:
+			{
+				states[instruction->slot].rc = rc;
+			} break;
+			case OP_LOAD_RC:
+			{
+				rc = states[instruction->slot].rc;
+			} break;
+			case OP_FOR_BEGIN:
+			{
+				begin_for_loop(shell, (struct AstFor*)instruction->data, states + instruction->slot);
+				rc = 0;
+			} break;
+			case OP_FOR_NEXT:
+			{
+				if (!next_for_loop(shell, (struct AstFor*)instruction->data, states + instruction->slot))
+				{
+					pc = instruction->operand;
+				}
+				else if (shell->execution_error->error)
+				{
+					rc = 1;
+				}
+			} break;
+			case OP_FOR_END:
+			{
+				end_for_loop(shell, (struct AstFor*)instruction->data, states + instruction->slot);
+			} break;
+			case OP_REDIRECT:
+			{
+				redirect_loop(shell, (struct AstWhile*)instruction->data, states + instruction->slot);
+			} break;
+			case OP_RESTORE_IO:
+			{
+				restore_loop_io(shell, states + instruction->slot);
+			} break;
+			case OP_CASE:
+			{
+				pc += match_case(shell, (struct AstCase*)instruction->data); // the jump table follows the instruction
+			} break;
+			case OP_HALT:
+			{
+				running = 0;
+			} break;
 		}
+	}
 
-		return rc;
+	for (size_t i = bytecode->slots; i-- > 0; ) // inner loops have greater slots
+	{
+		free(states[i].init_value); // loops interrupted by an error
+		free_paths(&states[i].paths);
+		restore_loop_io(shell, states + i);
 	}
 
-	return 0;
+	free(states);
+
+	return rc;
+}
+
+int execute(struct Shell* shell, CommandsList* program)
+{
+	struct Bytecode* bytecode = compile(program);
+	int rc = run(shell, bytecode);
+
+	destroy_bytecode(&bytecode);
+
+	return rc;
 }
 
 int shell_execute(struct Shell* shell, char* buffer)
@@ -893,72 +2170,256 @@ int shell_execute(struct Shell* shell, char* buffer)
 		handle_error(shell->execution_error, "Error: ");	
 	}
 
-	destroy_list(&shell->program);
+	// the whole AST lives in the parser arena
+	shell->program = NULL;
+	reset_arena(shell->parser->arena);
 
 	return rc;
 }
 
-int shell_execute_from_file(struct Shell* shell, const char* filename)
+// the script being run from a mapping, the range handle_sigbus() repairs
+static char* mapped_script;
+static size_t mapped_script_size;
+static size_t mapped_page_size;
+static volatile sig_atomic_t script_truncated;
+
+#ifdef __linux__
+/*
+	Pages of a mapped file that was truncated raise SIGBUS when they're touched. The pages from the faulting one
+	to the end are replaced with zeros, and the faulting read is repeated: the scanner sees the end of the script
+	where the file ends now. Bus errors outside of the mapping get the default action when they're repeated.
+
+	POSIX doesn't list mmap() as async-signal-safe, so the handler is installed only on Linux, where mmap() is
+	a plain system call that takes no locks of the C library. The signal is synchronous, it comes from a read
+	of the script's text, and the read can't be abandoned with siglongjmp(): words of the AST are slices of the
+	mapping, so it may happen anywhere in the executor, with descriptors redirected and processes started.
+*/
+static void handle_sigbus(int signo, siginfo_t* info, void* context)
 {
-	int fd = open(filename, O_RDONLY);
-	if (fd == -1)
+	char* address = info->si_addr;
+	int saved_errno = errno;
+
+	if (!mapped_script || address < mapped_script || address >= mapped_script + mapped_script_size)
 	{
-		fprintf(stderr, "Failed to open %s\n", filename);
-		return 1;
+		signal(SIGBUS, SIG_DFL);
+		return;
+	}
+
+	char* page = mapped_script + ((size_t)(address - mapped_script) & ~(mapped_page_size - 1));
+
+	if (mmap(page, (size_t)(mapped_script + mapped_script_size - page), PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+	{
+		signal(SIGBUS, SIG_DFL);
+		return;
+	}
+
+	script_truncated = 1;
+	errno = saved_errno; // the interrupted code may be between a call and its errno check
+}
+#endif
+
+/*
+	maps the file followed by at least one zero byte: the reservation is anonymous memory,
+	the file is mapped over its beginning, and the tail of the last page of a file mapping is zero-filled
+*/
+static char* map_script(int fd, size_t size, size_t* mapping_size)
+{
+	size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	*mapping_size = (size + 1 + page_size - 1) & ~(page_size - 1);
+
+	char* mapping = mmap(NULL, *mapping_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	if (size && mmap(mapping, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+	{
+		munmap(mapping, *mapping_size);
+		return NULL;
+	}
+
+	madvise(mapping, *mapping_size, MADV_SEQUENTIAL);
+
+	return mapping;
+}
+
+// drops the pages that were already parsed, they are read from the file again if something still refers to them
+static void release_parsed_pages(char* mapping, size_t* released, size_t position)
+{
+	size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	size_t parsed = position & ~(page_size - 1);
+
+	if (parsed >= *released + SCRIPT_RELEASE_SIZE)
+	{
+		madvise(mapping + *released, parsed - *released, MADV_DONTNEED);
+		*released = parsed;
 	}
+}
+
+// runs the commands stored in a valid script cache, the script isn't scanned nor parsed; count is the number of commands run
+static int execute_cached(struct Shell* shell, struct ScriptCache* cache, size_t* count)
+{
+	int rc = 0;
 
-	// skip schebang
-	while (1)
+	while ((shell->program = load_command(cache, shell->parser->arena)))
 	{
-		char c;
+		rc = execute(shell, shell->program);
+		(*count)++;
 
-		ssize_t n = read(fd, &c, 1);
-		if (n != 1)
+		shell->program = NULL;
+		reset_arena(shell->parser->arena);
+		do_job_notification(shell->job_control); // frees completed background jobs
+
+		if (!handle_error(shell->execution_error, "Error: "))
 		{
-			close(fd);
-			return 1;
+			break;
 		}
+	}
+
+	return rc;
+}
+
+// top-level commands are parsed and executed one at a time, so memory doesn't depend on the script's length
+static int execute_mapped(struct Shell* shell, char* buffer, struct ScriptCache* cache)
+{
+	size_t position = 0;
+
+	if (buffer[0] == '#' && buffer[1] == '!') // skip shebang
+	{
+		const char* newline = strchrnul(buffer, '\n');
+		position = (size_t)(newline - buffer);
+	}
+
+	init_parser(shell, buffer + position);
+
+	size_t released = 0;
+	int rc = 0;
+	int finished = 1;
+
+	while ((shell->program = complete_command(shell->parser)))
+	{
+		save_command(cache, shell->program);
+		rc = execute(shell, shell->program);
 
-		if (c == ' ' || c == '\t' || c == '\n')
+		shell->program = NULL;
+		reset_arena(shell->parser->arena);
+		do_job_notification(shell->job_control); // frees completed background jobs
+
+		if (!handle_error(shell->execution_error, "Error: "))
 		{
+			finished = 0;
 			break;
 		}
+
+		release_parsed_pages(buffer, &released, position + shell->scanner->position);
 	}
 
-	off_t beg = lseek(fd, 0, SEEK_CUR);
-	if (beg == -1)
+	if (!handle_error(shell->parser->error, "Syntax error: "))
 	{
-		close(fd);
-		return 1;
+		rc = 1;
+	}
+	else if (finished && !script_truncated) // the cache is written only for a whole script
+	{
+		commit_script_cache(cache);
 	}
 
-	off_t end = lseek(fd, 0, SEEK_END);
-	if (end == -1)
+	reset_arena(shell->parser->arena);
+
+	return rc;
+}
+
+int shell_execute_from_file(struct Shell* shell, const char* filename)
+{
+	int fd = open(filename, O_RDONLY);
+	if (fd == -1)
 	{
-		close(fd);
+		fprintf(stderr, "Failed to open %s\n", filename);
 		return 1;
 	}
 
-	if (lseek(fd, beg, SEEK_SET) == -1)
+	struct stat st;
+	if (fstat(fd, &st) == -1)
 	{
 		close(fd);
 		return 1;
 	}
 
-	size_t buf_size = (size_t)(end - beg + 1);
-	char* buffer = calloc(end - beg + 1, sizeof(char));
+	struct ScriptCache cache = { 0 };
+	int rc = 1;
+	int cached = shell->use_script_cache && open_script_cache(&cache, filename, &st);
+
+	if (cached)
+	{
+		size_t count = 0;
+		rc = execute_cached(shell, &cache, &count);
+
+		if (cache.failed) // the script is parsed unless some of its commands have already run
+		{
+			remove_script_cache(&cache);
+			reset_arena(shell->parser->arena);
+
+			if (count)
+			{
+				fprintf(stderr, "The cache of %s is damaged, it was removed\n", filename);
+				rc = 1;
+			}
+			else
+			{
+				cached = open_script_cache(&cache, filename, &st); // prepares a new cache file
+			}
+		}
+	}
 
-	ssize_t n = read(fd, buffer, buf_size - 1);
-	if (n == -1)
+	if (cached)
 	{
 		close(fd);
-		return 1;
 	}
+	else
+	{
+		size_t mapping_size = 0;
+		char* buffer = map_script(fd, (size_t)st.st_size, &mapping_size);
+		close(fd);
+
+		if (buffer)
+		{
+#ifdef __linux__ // see handle_sigbus()
+			struct sigaction action = { 0 };
+			struct sigaction saved_action;
+			action.sa_sigaction = handle_sigbus;
+			action.sa_flags = SA_SIGINFO;
+			sigemptyset(&action.sa_mask);
+			sigaction(SIGBUS, &action, &saved_action);
+#endif
+
+			char* saved_script = mapped_script;
+			size_t saved_script_size = mapped_script_size;
+			mapped_script = buffer;
+			mapped_script_size = mapping_size;
+			mapped_page_size = (size_t)sysconf(_SC_PAGESIZE);
+			script_truncated = 0;
+
+			rc = execute_mapped(shell, buffer, &cache);
+
+			if (script_truncated)
+			{
+				fprintf(stderr, "%s was truncated while it ran, the rest of it was ignored\n", filename);
+			}
 
-	int rc = shell_execute(shell, buffer);
+			mapped_script = saved_script;
+			mapped_script_size = saved_script_size;
+#ifdef __linux__
+			sigaction(SIGBUS, &saved_action, NULL);
+#endif
+			munmap(buffer, mapping_size);
+		}
+		else
+		{
+			fprintf(stderr, "Failed to map %s\n", filename);
+		}
+	}
 
-	close(fd);
-	free(buffer);
+	close_script_cache(&cache);
 
 	return rc;
 }
@@ -1014,7 +2475,7 @@ void execute_print(struct Shell* shell, CommandsList* program)
 
 										struct AstNode* expr = a->expression;
 										struct AstWord* word = NULL;
-										struct AstArithmExpr* arithm_expr = NULL;
+										struct ArithmProgram* arithm_expr = NULL;
 
 										switch (expr->node_type)
 										{
@@ -1050,7 +2511,7 @@ void execute_print(struct Shell* shell, CommandsList* program)
 											case AST_ARITHM_EXPR:
 											{
 												arithm_expr = expr->actual_data;
-												char* str = expand_arithm_expr(shell, arithm_expr);
+												const char* str = expand_arithm_expr(shell, arithm_expr);
 
 												if (!handle_error(shell->execution_error, "Error: "))
 												{
@@ -1059,7 +2520,6 @@ void execute_print(struct Shell* shell, CommandsList* program)
 
 												set_variable(shell, a->variable->word.buffer, str);
 												printf("Expression(Arithmetic expansion): %s\n", str);
-												free(str);
 											} break;
 											default: printf("error\n"); break;
 										}
@@ -1086,13 +2546,14 @@ void execute_print(struct Shell* shell, CommandsList* program)
 										}
 										else
 										{
-											struct AstArithmExpr* arithm_expr = node->actual_data;
-											printf("(Arithmetic expansion) %d\n", execute_arithm_expr(shell, arithm_expr));
+											const char* str = expand_arithm_expr(shell, node->actual_data);
 
 											if (!handle_error(shell->execution_error, "Error: "))
 											{
 												return;
 											}
+
+											printf("(Arithmetic expansion) %s\n", str);
 										}
 									}
 								}
@@ -1153,6 +2614,16 @@ void execute_print(struct Shell* shell, CommandsList* program)
 
 								printf("Body: ");
 								execute_print(shell, ast_while->body);
+
+								if (ast_while->input_redirect)
+								{
+									printf("Input redirection to: %s\n", expand_token(shell, &ast_while->input_redirect->file_name->word));
+								}
+
+								if (ast_while->output_redirect)
+								{
+									printf("Output redirection to: %s\n", expand_token(shell, &ast_while->output_redirect->file_name->word));
+								}
 							} break;
 							case AST_FOR:
 							{
@@ -1189,9 +2660,9 @@ void execute_print(struct Shell* shell, CommandsList* program)
 											} break;
 											case AST_ARITHM_EXPR:
 											{
-												char* str = expand_arithm_expr(shell, expr->actual_data);
+												const char* str = expand_arithm_expr(shell, expr->actual_data);
 
-												if (shell->execution_error->error)
+												if (!str)
 												{
 													fprintf(stderr, "%s\n", shell->execution_error->error_message);
 													return;
@@ -1200,7 +2671,6 @@ void execute_print(struct Shell* shell, CommandsList* program)
 												printf("(Arithmetic expansion): %s\n", str);
 
 												set_variable(shell, ast_for->variable->word.word.buffer, str);
-												free(str);
 											} break;
 											default: break;
 										}
@@ -1215,6 +2685,26 @@ void execute_print(struct Shell* shell, CommandsList* program)
 									erase(shell->variables, ast_for->variable->word.word.buffer);
 								}
 							} break;
+							case AST_CASE:
+							{
+								struct AstCase* ast_case = (struct AstCase*)ast_node->actual_data;
+
+								printf("Case statement:\n");
+								printf("Word: %s\n", expand_token(shell, &ast_case->word->word));
+
+								for (struct Node* item = ast_case->items->head; item; item = item->next)
+								{
+									printf("Patterns:");
+
+									for (struct Node* word = ((struct AstCaseItem*)item->data)->patterns->head; word; word = word->next)
+									{
+										printf(" %s", ((struct AstWord*)((struct AstNode*)word->data)->actual_data)->word.word.buffer);
+									}
+
+									printf("\nBody: ");
+									execute_print(shell, ((struct AstCaseItem*)item->data)->body);
+								}
+							} break;
 							default: break;
 						}
 					}
@@ -58,10 +58,10 @@ char* concat_strings(const char* str1, const char* str2)
 	size_t len1 = strlen(str1);
 	size_t len2 = strlen(str2);
 
-	char* result = calloc(len1 + len2 + 1, sizeof(char));
+	char* result = malloc(sizeof(char) * (len1 + len2 + 1));
 
-	strncat(result, str1, len1);
-	strncat(result, str2, len2);
+	memcpy(result, str1, len1);
+	memcpy(result + len1, str2, len2 + 1);
 
 	return result;
 }
\ No newline at end of file
@@ -0,0 +1,340 @@
+#include "walker.h"
+#include "utility.h"
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+// directories waiting to be read, the owner works at the bottom and the other threads steal from the top
+struct Deque
+{
+	pthread_mutex_t lock;
+	char** paths;
+	size_t top;
+	size_t bottom;
+	size_t capacity;
+};
+
+struct Walk;
+
+struct Worker
+{
+	struct Walk* walk;
+	struct Deque deque;
+	struct PathList matches; // merged when all the workers are done
+	char* batch; // getdents64 buffer
+	size_t indx;
+	pthread_t thread;
+	int started;
+};
+
+struct Walk
+{
+	const struct Pattern* pattern;
+	int directories_only;
+	int hidden; // the pattern begins with '.', hidden entries match it
+	struct Worker* workers;
+	size_t count;
+	atomic_size_t pending; // directories pushed but not read yet, the walk ends when there are none
+	atomic_size_t queued; // directories in the deques
+	atomic_size_t idle; // workers waiting for work
+	pthread_mutex_t idle_lock;
+	pthread_cond_t work; // signaled when a directory is pushed or the walk ends
+};
+
+static void push_path(struct Deque* deque, char* path)
+{
+	pthread_mutex_lock(&deque->lock);
+
+	if (deque->bottom == deque->capacity)
+	{
+		if (deque->top) // the stolen slots are reused
+		{
+			memmove(deque->paths, deque->paths + deque->top, (deque->bottom - deque->top) * sizeof(char*));
+			deque->bottom -= deque->top;
+			deque->top = 0;
+		}
+		else
+		{
+			deque->capacity = deque->capacity ? deque->capacity << 1 : DEQUE_CAP;
+			deque->paths = realloc(deque->paths, deque->capacity * sizeof(char*));
+		}
+	}
+
+	deque->paths[deque->bottom++] = path;
+
+	pthread_mutex_unlock(&deque->lock);
+}
+
+// the owner takes the directory pushed last, its entries are likely still cached
+static char* pop_path(struct Deque* deque)
+{
+	char* path = NULL;
+
+	pthread_mutex_lock(&deque->lock);
+
+	if (deque->bottom > deque->top)
+	{
+		path = deque->paths[--deque->bottom];
+	}
+
+	pthread_mutex_unlock(&deque->lock);
+
+	return path;
+}
+
+// thieves take the directory pushed first, it's usually the root of the largest untouched subtree
+static char* steal_path(struct Deque* deque)
+{
+	char* path = NULL;
+
+	pthread_mutex_lock(&deque->lock);
+
+	if (deque->bottom > deque->top)
+	{
+		path = deque->paths[deque->top++];
+	}
+
+	pthread_mutex_unlock(&deque->lock);
+
+	return path;
+}
+
+static char* find_work(struct Worker* worker)
+{
+	char* path = pop_path(&worker->deque);
+
+	for (size_t i = 1; !path && i < worker->walk->count; i++)
+	{
+		path = steal_path(&worker->walk->workers[(worker->indx + i) % worker->walk->count].deque);
+	}
+
+	if (path)
+	{
+		atomic_fetch_sub(&worker->walk->queued, 1);
+	}
+
+	return path;
+}
+
+// an idle worker checks queued after it's counted in idle, so a push either is seen or wakes it
+static void add_work(struct Worker* worker, char* path)
+{
+	struct Walk* walk = worker->walk;
+
+	atomic_fetch_add(&walk->pending, 1); // before it can be stolen and finished
+	atomic_fetch_add(&walk->queued, 1);
+	push_path(&worker->deque, path);
+
+	if (atomic_load(&walk->idle))
+	{
+		pthread_mutex_lock(&walk->idle_lock);
+		pthread_cond_signal(&walk->work);
+		pthread_mutex_unlock(&walk->idle_lock);
+	}
+}
+
+// the worker sleeps until a directory is pushed, returns 0 when the walk is over
+static int wait_for_work(struct Walk* walk)
+{
+	pthread_mutex_lock(&walk->idle_lock);
+	atomic_fetch_add(&walk->idle, 1);
+
+	while (!atomic_load(&walk->queued) && atomic_load(&walk->pending))
+	{
+		pthread_cond_wait(&walk->work, &walk->idle_lock);
+	}
+
+	atomic_fetch_sub(&walk->idle, 1);
+	pthread_mutex_unlock(&walk->idle_lock);
+
+	return atomic_load(&walk->pending) != 0;
+}
+
+static void finish_work(struct Walk* walk)
+{
+	if (atomic_fetch_sub(&walk->pending, 1) == 1) // the last directory, the idle workers exit
+	{
+		pthread_mutex_lock(&walk->idle_lock);
+		pthread_cond_broadcast(&walk->work);
+		pthread_mutex_unlock(&walk->idle_lock);
+	}
+}
+
+// d_type is DT_UNKNOWN on some file systems, the entry is examined without following links
+static unsigned char get_type(int fd, const char* name)
+{
+	struct stat sb;
+
+	if (fstatat(fd, name, &sb, AT_SYMLINK_NOFOLLOW) == -1)
+	{
+		return DT_UNKNOWN;
+	}
+
+	return S_ISDIR(sb.st_mode) ? DT_DIR : S_ISLNK(sb.st_mode) ? DT_LNK : DT_REG;
+}
+
+static int is_directory_link(int fd, const char* name)
+{
+	struct stat sb;
+
+	return fstatat(fd, name, &sb, 0) == 0 && S_ISDIR(sb.st_mode);
+}
+
+static void read_tree_directory(struct Worker* worker, const char* path)
+{
+	struct Walk* walk = worker->walk;
+	int fd = open(*path ? path : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	if (fd == -1)
+	{
+		return;
+	}
+
+	long size;
+
+	while ((size = syscall(SYS_getdents64, fd, worker->batch, DIRENT_BATCH_SIZE)) > 0)
+	{
+		for (long position = 0; position < size; )
+		{
+			struct LinuxDirent64* entry = (struct LinuxDirent64*)(worker->batch + position);
+			const char* name = entry->d_name;
+
+			position += entry->d_reclen;
+
+			if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2])))
+			{
+				continue;
+			}
+
+			size_t length = strlen(name);
+			unsigned char type = entry->d_type == DT_UNKNOWN ? get_type(fd, name) : entry->d_type;
+			int descend = type == DT_DIR && *name != '.';
+			int match = (*name != '.' || walk->hidden) && (!walk->pattern || match_pattern(walk->pattern, name, length));
+
+			if (match && walk->directories_only)
+			{
+				match = type == DT_DIR || (type == DT_LNK && is_directory_link(fd, name));
+			}
+
+			if (!match && !descend)
+			{
+				continue;
+			}
+
+			char* child = join_path(path, name, length);
+
+			if (match)
+			{
+				add_path(&worker->matches, descend ? copy_string(child) : child);
+			}
+
+			if (descend)
+			{
+				add_work(worker, child);
+			}
+		}
+	}
+
+	close(fd);
+}
+
+static void* run_worker(void* data)
+{
+	struct Worker* worker = data;
+
+	while (1)
+	{
+		char* path = find_work(worker);
+
+		if (!path)
+		{
+			if (!wait_for_work(worker->walk)) // other workers are reading directories that may have subdirectories
+			{
+				break;
+			}
+
+			continue;
+		}
+
+		read_tree_directory(worker, path);
+		free(path);
+		finish_work(worker->walk);
+	}
+
+	return NULL;
+}
+
+void walk_trees(const char** bases, size_t count, const struct Pattern* pattern, int directories_only, size_t threads, struct PathList* matches)
+{
+	struct Walk walk = { .pattern = pattern, .directories_only = directories_only };
+	walk.hidden = pattern && pattern->prefix_size && *pattern->prefix == '.';
+	walk.count = threads < 1 ? 1 : threads > WALKER_MAX_THREADS ? WALKER_MAX_THREADS : threads;
+	walk.workers = calloc(walk.count, sizeof(struct Worker));
+	atomic_init(&walk.pending, count);
+	atomic_init(&walk.queued, count);
+	atomic_init(&walk.idle, 0);
+	pthread_mutex_init(&walk.idle_lock, NULL);
+	pthread_cond_init(&walk.work, NULL);
+
+	for (size_t i = 0; i < walk.count; i++)
+	{
+		walk.workers[i].walk = &walk;
+		walk.workers[i].indx = i;
+		walk.workers[i].batch = malloc(DIRENT_BATCH_SIZE);
+		pthread_mutex_init(&walk.workers[i].deque.lock, NULL);
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		push_path(&walk.workers[i % walk.count].deque, copy_string(bases[i]));
+
+		if (!pattern && *bases[i]) // a/** matches a/ too
+		{
+			add_path(&walk.workers[0].matches, join_path(bases[i], "", 0));
+		}
+	}
+
+	// signals are handled by the shell's thread, the workers block them
+	sigset_t all, saved;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &saved);
+
+	for (size_t i = 1; i < walk.count; i++)
+	{
+		walk.workers[i].started = pthread_create(&walk.workers[i].thread, NULL, run_worker, walk.workers + i) == 0;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+	run_worker(walk.workers); // the directories of the workers that weren't started are stolen
+
+	for (size_t i = 0; i < walk.count; i++)
+	{
+		struct Worker* worker = walk.workers + i;
+
+		if (worker->started)
+		{
+			pthread_join(worker->thread, NULL);
+		}
+
+		for (size_t j = 0; j < worker->matches.size; j++)
+		{
+			add_path(matches, worker->matches.paths[j]);
+		}
+
+		free(worker->matches.paths);
+		free(worker->deque.paths);
+		free(worker->batch);
+		pthread_mutex_destroy(&worker->deque.lock);
+	}
+
+	free(walk.workers);
+	pthread_mutex_destroy(&walk.idle_lock);
+	pthread_cond_destroy(&walk.work);
+}
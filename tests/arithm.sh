@@ -0,0 +1,19 @@
+x=5
+echo $((1 + 2 * 3)) $(((1 + 2) * 3)) $((7 / 2)) $((-7 / 2)) $((7 / -2))
+echo $(($x * $x - 1)) $((-$x)) $((2 - -3)) $((- (2 + 3) * 4))
+echo $((9223372036854775807)) $((-9223372036854775807 - 1)) $((4611686018427387904 * -2))
+y=$((3037000499 * 3037000499))
+echo $y
+printf 'echo $((9223372036854775807 + 1))\necho not reached\n' > add.sh
+printf 'echo $((-9223372036854775807 - 2))\n' > subtract.sh
+printf 'echo $((4611686018427387904 * 2))\n' > multiply.sh
+printf 'echo $((9223372036854775808))\n' > literal.sh
+printf 'echo $((-(-9223372036854775807 - 1)))\n' > negate.sh
+printf 'echo $(((-9223372036854775807 - 1) / -1))\n' > divide.sh
+printf 'echo $((10 / 0))\n' > zero.sh
+printf 'x=5\necho $(($x / (5 - $x)))\n' > variable.sh
+for script in add.sh subtract.sh multiply.sh literal.sh negate.sh divide.sh zero.sh variable.sh
+do
+$SMSH --no-cache $script
+done
+echo end
@@ -0,0 +1,25 @@
+echo {1..5}
+echo {5..1}
+echo {0..20..5}
+echo {20..0..-5}
+echo {-3..3}
+echo {01..10}
+echo {1..010}
+echo file{1..3}.txt
+echo {a,b,c}
+echo x{,.bak}
+echo a{,x}b
+echo {,x}
+echo {x,,y}
+echo {,} end
+echo {a}
+echo '{1..3}' "{a,b}"
+for i in {,x} {3..1}
+do
+echo item $i
+done
+for i in {1..100000}
+do
+n=$i
+done
+echo $n
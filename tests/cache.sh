@@ -0,0 +1,22 @@
+printf '%s\n' 'x=3' 'total=0' 'for i in 1 2 3 {4..6}' 'do' 'total=$(($total + $i * $x))' 'done' 'echo total $total' > loops.sh
+printf '%s\n' 'case abc in' '"a"*) echo matched ;;' 'esac' 'name=file.tar.gz' 'echo ${name%%.*} ${name#*.} ${#name}' > words.sh
+printf '%s\n' 'touch one.c two.c' 'echo *.c' 'if [ $total -gt 50 ]; then echo big; else echo small; fi' > files.sh
+printf '%s\n' 'echo a b | cat' 'while false' 'do' 'echo never' 'done' 'echo end' > end.sh
+cat loops.sh words.sh files.sh end.sh > prog.sh
+$SMSH --no-cache prog.sh > plain.out
+$SMSH prog.sh > cold.out
+ls cache/smsh | wc -l
+$SMSH prog.sh > warm.out
+cat warm.out
+cmp plain.out cold.out
+cmp plain.out warm.out
+printf '%s\n' 'echo changed' > prog.sh
+$SMSH prog.sh
+$SMSH prog.sh
+for file in cache/smsh/*
+do
+printf 'damaged' > $file
+done
+$SMSH prog.sh
+$SMSH prog.sh
+ls cache/smsh | wc -l
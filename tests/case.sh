@@ -0,0 +1,40 @@
+case abc in
+"*") echo quoted star ;;
+*) echo star ;;
+esac
+case a in
+"?") echo quoted question mark ;;
+a) echo a ;;
+esac
+case '?' in
+"?") echo literal question mark ;;
+esac
+case 'a*' in
+'a*') echo literal star ;;
+esac
+case abc in
+"a"*) echo quoted prefix ;;
+esac
+case ab in
+\?b) echo escaped ;;
+?b) echo unescaped ;;
+esac
+case '?b' in
+\?b) echo escaped question mark ;;
+esac
+case '[x]' in
+"[x]") echo literal class ;;
+esac
+p='b*'
+case bcd in
+"$p") echo quoted parameter ;;
+$p) echo parameter ;;
+esac
+for w in apple berry cherry x
+do
+case $w in
+a*|b*) echo $w ab ;;
+"c"herr?) echo $w c ;;
+*) echo $w other ;;
+esac
+done
@@ -0,0 +1,41 @@
+echo plain text
+echo
+echo -n no newline
+echo
+echo -e 'tab\there' 'new\nline'
+echo -E 'raw\tbackslash'
+echo 'default\tescapes'
+echo -e 'stop\c' after
+echo
+echo -ne 'x\x41\0101y\n'
+echo -x -n
+printf 'plain\n'
+printf '%s|%s|\n' a b c
+printf '%d %i %x %X %o %u\n' 42 -7 255 255 8 3
+printf '%5s|%-5s|%.2s|\n' ab ab abcdef
+printf '%05d|%-4d|%+d\n' 42 7 5
+printf '%c%c\n' hello world
+printf '%b|%s\n' 'a\tb' 'a\tb'
+printf '%%|%s\n'
+printf '%d\n' 0x1f 010 "'A"
+printf '%d\n' abc
+printf '%d\n' 12abc
+printf 'no arguments %s %d.\n'
+printf '%z\n' x
+printf '%s %z\n' x
+printf
+i=0
+while [ $i -lt 3 ]
+do
+printf 'row %d\n' $i
+echo -n .
+i=$(($i + 1))
+done
+echo
+printf '%s\n' one two > out.txt
+echo -n three > more.txt
+cat out.txt more.txt
+echo
+printf '%s-%s\n' a b c d | tr a-z A-Z
+echo -e 'p\tq' | cat -A
+echo end
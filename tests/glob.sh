@@ -0,0 +1,21 @@
+mkdir -p a/sub/deep b .hidden
+touch a/x.c a/y.txt a/sub/q.c a/sub/deep/w.c b/z.c .hidden/h.c .h.c
+echo *
+echo */
+echo a/*.c
+echo *.none
+echo [ab]/*.c
+echo .h*
+echo a/**
+echo a/**/
+echo **/*.c
+echo **/deep/
+for f in **/*.c
+do
+echo file $f
+done
+touch "a*x" ab.c
+echo "a*"*
+echo 'a'*.c
+echo "*"/*.c
+echo "[ab]"/*
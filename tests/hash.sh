@@ -0,0 +1,28 @@
+mkdir a b
+printf '#!/bin/sh\necho tool from a\n' > a/tool
+printf '#!/bin/sh\necho tool from b\n' > b/tool
+chmod +x a/tool b/tool
+PATH=a:/usr/bin:/bin
+tool
+hash -t tool
+hash -t missing
+hash -d tool
+hash -t tool
+tool
+echo b > path
+read PATH < path
+tool
+hash -t tool
+PATH=a
+tool
+mapfile -t PATH < path
+tool
+hash -t tool
+PATH=a
+hash tool
+hash -t tool
+hash -r
+hash -t tool
+unset PATH
+PATH=b
+tool
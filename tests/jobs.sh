@@ -0,0 +1,5 @@
+printf '%s\n' 'sleep 10 &' 'sleep 20 &' 'echo a b | sleep 30 &' 'jobs' 'kill %1' 'if wait %1; then echo status 0; else echo job 1 failed; fi' 'jobs' > kill.sh
+printf '%s\n' 'kill -s KILL %3' 'kill -9 %2' 'wait' 'jobs' 'echo none left' 'kill %1' 'kill %+' 'kill -l 143' 'kill -l 137' 'kill -s NOSUCH 1' > signals.sh
+printf '%s\n' 'sleep 1 &' 'fg %1' 'jobs' 'sleep 1 &' 'bg %1' 'parallel sleep ::: 1 &' 'jobs' 'wait' 'jobs' 'echo end' > foreground.sh
+cat kill.sh signals.sh foreground.sh > script.sh
+sh -c '"$SMSH" --no-cache script.sh 2>&1' | sed -e 's/^[0-9]*: Terminated/pid: Terminated/' -e 's|[^ ]*/sleep|sleep|'
@@ -0,0 +1,28 @@
+printf 'alpha\nbeta\n\ngamma\n' > lines.txt
+mapfile -t a < lines.txt
+echo ${#a[@]} - ${a[0]} - ${a[1]} - ${a[3]} -
+echo ${a[@]}
+mapfile b < lines.txt
+echo ${#b[@]}
+printf '%s' ${b[1]} | od -c | sed 's/  */ /g'
+readarray -t c < lines.txt
+echo ${#c[@]} - ${c[2]} - ${c[3]} -
+mapfile < lines.txt
+echo ${#MAPFILE[@]} - ${MAPFILE[0]}
+printf 'one\ntwo' > partial.txt
+mapfile -t d < partial.txt
+echo ${#d[@]} - ${d[1]} -
+mapfile -t e < /dev/null
+echo empty ${#e[@]}
+mapfile -t a < partial.txt
+echo replaced ${#a[@]} - ${a[@]} -
+echo missing - ${a[7]} -
+printf 'x\ny\nz\n' | mapfile -t f
+echo piped ${#f[@]} - ${f[2]} -
+for item in ${c[@]}
+do
+echo item $item
+done
+mapfile -t 1bad < lines.txt
+mapfile -x
+echo end
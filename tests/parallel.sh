@@ -0,0 +1,12 @@
+parallel -j 1 echo item ::: a b c
+parallel -j 3 echo ::: c a b | sort
+printf 'x\ny\nz\n' | parallel -j 2 echo line | sort
+parallel -j 2 -g sh -c 'echo $1 start; if [ $1 = a ]; then sleep 0.5; fi; echo $1 end' _ ::: a b
+if parallel sh -c 'exit $0' ::: 0 1 0 2; then echo all succeeded; else echo some failed; fi
+if parallel -j2 true ::: 1 2 3; then echo all succeeded; else echo some failed; fi
+parallel -j 0 echo ::: a
+parallel -x echo ::: a
+parallel
+parallel no_such_command ::: a
+parallel -j 1 echo nothing :::
+echo end
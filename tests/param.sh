@@ -0,0 +1,15 @@
+v=hello
+echo ${v:1}
+echo ${v:1:3}
+echo ${v: -3}
+echo ${v: -3:2}
+echo ${v:1:-1}
+echo ${v:0:-5}
+echo ${v:7:1}
+printf '%s\n' a b c d e > items
+mapfile -t a < items
+echo ${a[@]:1:2}
+echo ${a[@]: -2}
+echo ${a[@]:7}
+echo ${v:1:-10}
+echo not reached
@@ -0,0 +1,33 @@
+echo a b | cat
+printf '%s\n' 3 1 2 | sort
+echo one | cat | cat | cat
+echo hello > file.txt
+cat < file.txt
+read line < file.txt
+echo $line
+echo piped | read word
+echo $word
+printf '%s\n' x y z | mapfile -t lines
+echo ${lines[2]}
+echo to the file > redirected.txt | cat
+cat redirected.txt
+cat file.txt | read first
+echo $first
+i=0
+while [ $i -lt 10000 ]
+do
+echo line $i
+i=$(($i + 1))
+done > numbers.txt
+mapfile -t numbers < numbers.txt
+printf '%s\n' ${numbers[@]} | tail -1
+printf '%s\n' ${numbers[@]} | wc -l
+printf '%s\n' ${numbers[@]} | head -1
+echo first | cat > copy.txt
+cat copy.txt
+printf '%s\n' b a | sort > sorted.txt
+cat sorted.txt
+yes | head -1
+mapfile -t numbers < numbers.txt
+printf "%s\n" ${numbers[@]} | head -2
+echo finished
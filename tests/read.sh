@@ -0,0 +1,48 @@
+printf 'one two three four\n' > words.txt
+read a b < words.txt
+echo - $a - $b -
+read a b c d e < words.txt
+echo - $a - $b - $c - $d - $e -
+read < words.txt
+echo $REPLY
+printf '  lead  and  trail  \n' > spaces.txt
+read a b < spaces.txt
+echo - $a - $b -
+printf 'back\\slash line\\\ncontinued\n' > escapes.txt
+read a < escapes.txt
+echo $a
+read -r a < escapes.txt
+echo $a
+printf 'first:second:third\n' > colons.txt
+IFS=:
+read a b < colons.txt
+echo - $a - $b -
+IFS=' '
+read -d : a < colons.txt
+echo - $a -
+printf 'x\000y\n' > nul.txt
+read -d '' a < nul.txt
+echo - $a -
+printf 'alpha\nbeta\n\ngamma' > lines.txt
+while read line
+do
+echo - $line -
+done < lines.txt
+echo last - $line -
+printf 'piped words\n' | read a b
+echo - $a - $b -
+read a < /dev/null
+echo eof - $a -
+if read a < /dev/null
+then
+echo read succeeded
+else
+echo read failed
+fi
+if read a < lines.txt
+then
+echo read succeeded
+fi
+read 1bad < words.txt
+read -x
+echo end
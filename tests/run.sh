@@ -0,0 +1,31 @@
+#!/bin/sh
+# usage: tests/run.sh path/to/smsh.exe
+# runs every tests/*.sh (except this one) in an empty directory and compares its output with the .out file next to it
+# with $SMSH set to the shell's path, so a test can run the shell on the scripts it writes, and with
+# XDG_CACHE_HOME in that directory, so those runs don't touch the user's script cache
+
+shell=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+dir=$(cd "$(dirname "$0")" && pwd)
+failed=0
+
+for script in "$dir"/*.sh
+do
+	[ "$script" = "$dir/run.sh" ] && continue
+
+	name=$(basename "$script" .sh)
+	work=$(mktemp -d)
+
+	(cd "$work" && SMSH="$shell" XDG_CACHE_HOME="$work/cache" "$shell" --no-cache "$script" < /dev/null > "$work.out" 2>&1)
+
+	if diff -u "$dir/$name.out" "$work.out"
+	then
+		echo "PASS $name"
+	else
+		echo "FAIL $name"
+		failed=1
+	fi
+
+	rm -rf "$work" "$work.out"
+done
+
+exit $failed
@@ -0,0 +1,24 @@
+echo plain words	separated   by	tabs and spaces
+echo 'single quoted  text' "double quoted  text" mixed'quoted'"parts"word
+echo 'a;b|c&d' "<not a redirect>" '$not_expanded'
+echo one;echo two
+echo abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz
+echo a_very_long_word_that_crosses_the_thirty_two_and_sixty_four_byte_boundaries_of_the_vector_scan;echo end
+x=value
+echo $x;echo $x|cat
+echo '' "" end
+echo written>out.txt
+cat<out.txt
+echo "quoted=sign" "a=b"
+if true;then echo yes;else echo no;fi
+printf 'echo ' > head.sh
+i=0
+while [ $i -lt 300 ]
+do
+printf 'word%s\t' $i
+i=$(($i + 1))
+done > words.sh
+cat head.sh words.sh > long.sh
+$SMSH --no-cache long.sh | wc -w
+echo last line without a newline
+echo tail
\ No newline at end of file
@@ -0,0 +1,38 @@
+touch file
+mkdir dir
+x=abc
+if [ -f file ]; then echo file is a file; fi
+if [ -d dir ]; then echo dir is a directory; fi
+if [ -e missing ]; then echo wrong; else echo missing does not exist; fi
+if [ ! -d file ]; then echo file is not a directory; fi
+if [ -n $x ]; then echo x is not empty; fi
+if [ -z "" ]; then echo the empty string is empty; fi
+if [ $x = abc ]; then echo equal strings; fi
+if [ $x != abd ]; then echo different strings; fi
+if [ 10 -gt 9 ]; then echo 10 is greater; fi
+if [ 3 -le 3 ]; then echo 3 is less or equal; fi
+if [ -5 -lt 2 ]; then echo negative numbers; fi
+if [ 7 -eq 07 ]; then echo numeric equality; fi
+if [ 1 -ne 2 ]; then echo numeric inequality; fi
+if [ 2 -ge 3 ]; then echo wrong; else echo 2 is smaller; fi
+if [ a = a -a b = b ]; then echo and; fi
+if [ a = b -o b = b ]; then echo or; fi
+if [ ! a = b ]; then echo negation; fi
+if [ '(' a = a ')' ]; then echo parentheses; fi
+if [ a = b -o a = a -a b = c ]; then echo wrong; else echo and binds tighter; fi
+if test abc; then echo a single argument is true unless empty; fi
+if test; then echo wrong; else echo no arguments are false; fi
+if [ -x file ]; then echo wrong; else echo file is not executable; fi
+if true; then echo true; fi
+if false; then echo wrong; else echo false; fi
+if :; then echo colon; fi
+i=0
+while [ $i -lt 5 ]
+do
+i=$(($i + 1))
+done
+echo loop $i
+[ 1 -gt x ]
+[ a = a
+test a b c d e
+echo end
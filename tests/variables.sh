@@ -0,0 +1,21 @@
+v=first
+for round in 1 2 3
+do
+echo round $round v $v late $late gone $gone
+v=$round
+export gone $round
+echo exported $gone
+unset gone
+late=again
+done
+echo after the loop $v $late $gone
+i=0
+while [ $i -lt 2000 ]
+do
+printf 'name%s=%s\n' $i $i
+i=$(($i + 1))
+done > names.sh
+printf 'v=before\nfor round in 1 2\ndo\necho $round $v $created\n' > begin.sh
+printf 'created=yes\nv=$name1999\ndone\necho $name0 $name1000 $v\n' > end.sh
+cat begin.sh names.sh end.sh > grow.sh
+$SMSH --no-cache grow.sh
@@ -0,0 +1,25 @@
+sh -c 'exit 3' &
+p=$!
+sh -c 'sleep 1; exit 0' &
+q=$!
+if wait $p; then echo first succeeded; else echo first failed; fi
+if wait $q; then echo second succeeded; else echo second failed; fi
+if wait 1; then echo waited; else echo not a child; fi
+sleep 1 &
+sh -c 'exit 2' &
+if wait -n; then echo next succeeded; else echo next failed; fi
+if wait -n; then echo next succeeded; else echo next failed; fi
+if wait -n; then echo next succeeded; else echo no jobs left; fi
+sh -c 'exit 4' &
+if wait %1; then echo job succeeded; else echo job failed; fi
+if wait %1; then echo job succeeded; else echo no job; fi
+sleep 1 &
+sh -c 'exit 5' &
+wait
+echo waited on all jobs
+wait
+echo no jobs to wait on
+printf '%s\n' 'sh -c "exit 6" &' 'wait' > last.sh
+if $SMSH --no-cache last.sh; then echo the script succeeded; else echo the script failed; fi
+printf '%s\n' 'sh -c "exit 6" &' 'wait %1' > job.sh
+if $SMSH --no-cache job.sh; then echo the script succeeded; else echo the script failed; fi